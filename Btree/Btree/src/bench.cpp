@@ -0,0 +1,1616 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <vector>
+#include <chrono>
+#include <fstream>
+#include <cstdlib>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include "btree.h"
+#include "page.h"
+#include "filescan.h"
+#include "exceptions/insufficient_space_exception.h"
+#include "exceptions/index_scan_completed_exception.h"
+#include "exceptions/file_not_found_exception.h"
+#include "exceptions/no_such_key_found_exception.h"
+#include "exceptions/end_of_file_exception.h"
+
+using namespace badgerdb;
+
+// -----------------------------------------------------------------------------
+// Globals
+// -----------------------------------------------------------------------------
+const std::string relationName = "benchRel";
+
+// Same tuple layout as the relation built by main.cpp
+typedef struct tuple {
+	int i;
+	double d;
+	char s[64];
+} RECORD;
+
+// -----------------------------------------------------------------------------
+// Helpers
+// -----------------------------------------------------------------------------
+
+/**
+ * Wall clock time in milliseconds since the given start point.
+ */
+double elapsedMs(const std::chrono::steady_clock::time_point& start)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * Number of pages in a file on disk, read from the file size.
+ */
+long filePages(const std::string& fileName)
+{
+	std::ifstream in(fileName.c_str(), std::ios::binary | std::ios::ate);
+	return (long) in.tellg() / Page::SIZE;
+}
+
+/**
+ * Create a relation holding keys 0 .. numRecords-1 in random order, or, if numDistinct is
+ * given, keys 0 .. numDistinct-1 each repeated about numRecords / numDistinct times.
+ */
+void createRelation(int numRecords, int numDistinct = 0)
+{
+	try
+	{
+		File::remove(relationName);
+	}
+	catch(FileNotFoundException e)
+	{
+	}
+
+	PageFile relFile = PageFile::create(relationName);
+
+	std::vector<int> keys(numRecords);
+	for (int i = 0; i < numRecords; i++)
+	{
+		keys[i] = (numDistinct > 0) ? i % numDistinct : i;
+	}
+	for (int i = numRecords - 1; i > 0; i--)
+	{
+		std::swap(keys[i], keys[rand() % (i + 1)]);
+	}
+
+	RECORD record;
+	memset(record.s, ' ', sizeof(record.s));
+	PageId pageNo;
+	Page page = relFile.allocatePage(pageNo);
+	for (int i = 0; i < numRecords; i++)
+	{
+		sprintf(record.s, "%05d string record", keys[i]);
+		record.i = keys[i];
+		record.d = (double)keys[i];
+		std::string data(reinterpret_cast<char*>(&record), sizeof(record));
+
+		while (1)
+		{
+			try
+			{
+				page.insertRecord(data);
+				break;
+			}
+			catch(InsufficientSpaceException e)
+			{
+				relFile.writePage(pageNo, page);
+				page = relFile.allocatePage(pageNo);
+			}
+		}
+	}
+	relFile.writePage(pageNo, page);
+}
+
+// -----------------------------------------------------------------------------
+// benchFanout
+// -----------------------------------------------------------------------------
+
+/**
+ * Height an index over numRecords keys would have with the given leaf and
+ * non-leaf capacities, assuming nodes are on average half full after splits.
+ */
+int estimatedHeight(int numRecords, int leafSize, int nonLeafSize)
+{
+	long nodes = (numRecords + leafSize / 2) / std::max(1, leafSize / 2);
+	int height = 1;
+	while (nodes > 1)
+	{
+		nodes = (nodes + nonLeafSize / 2) / std::max(1, (nonLeafSize + 1) / 2);
+		height++;
+	}
+	return height;
+}
+
+/**
+ * Build an integer index with the page-derived node capacities and report its
+ * height, size and the buffer pool misses of random point lookups through a
+ * small pool, next to the height the old 3-key nodes would have had.
+ */
+void benchFanout(int numRecords, int numLookups)
+{
+	std::cout << "---------------------" << std::endl;
+	std::cout << "Fanout: " << numRecords << " keys, " << numLookups << " lookups" << std::endl;
+	std::cout << "leaf size:" << INTARRAYLEAFSIZE << " non-leaf size:" << INTARRAYNONLEAFSIZE << std::endl;
+
+	createRelation(numRecords);
+	BufMgr* bufMgr = new BufMgr(16);
+	std::string indexName;
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		BTreeIndex<int> index(relationName, indexName, bufMgr, offsetof(tuple,i), INTEGER);
+		double buildMs = elapsedMs(start);
+
+		std::cout << "build time (ms): " << buildMs << std::endl;
+		std::cout << "height: " << index.getHeight()
+			<< " (3-key nodes: ~" << estimatedHeight(numRecords, 3, 3) << ")" << std::endl;
+
+		bufMgr->clearBufStats();
+		start = std::chrono::steady_clock::now();
+		for (int i = 0; i < numLookups; i++)
+		{
+			int key = rand() % numRecords;
+			RecordId rid;
+			index.startScan(&key, GTE, &key, LTE);
+			index.scanNext(rid);
+			index.endScan();
+		}
+		double lookupMs = elapsedMs(start);
+		std::cout << "lookup time (us/lookup): " << lookupMs * 1000.0 / numLookups << std::endl;
+		std::cout << "disk reads per lookup: "
+			<< (double) bufMgr->getBufStats().diskreads / numLookups << std::endl;
+	}
+	std::cout << "index pages: " << filePages(indexName) << std::endl;
+
+	delete bufMgr;
+	File::remove(indexName);
+	File::remove(relationName);
+}
+
+// -----------------------------------------------------------------------------
+// benchStringFanout
+// -----------------------------------------------------------------------------
+
+/**
+ * Build a string index by inserting numRecords keys in random order and report
+ * its height, size and the buffer pool misses of random point lookups through a
+ * small pool, next to the height non-leaf nodes holding 119 whole keys would
+ * have had.
+ */
+void benchStringFanout(int numRecords, int numLookups)
+{
+	std::cout << "---------------------" << std::endl;
+	std::cout << "String fanout: " << numRecords << " keys, " << numLookups << " lookups" << std::endl;
+	std::cout << "leaf size:" << STRINGARRAYLEAFSIZE << " non-leaf size:" << STRINGARRAYNONLEAFSIZE << std::endl;
+
+	createRelation(0);
+	BufMgr* bufMgr = new BufMgr(16);
+	std::string indexName;
+	{
+		BTreeIndex<StringKey> index(relationName, indexName, bufMgr, offsetof(tuple,s), STRING);
+
+		std::vector<int> keys(numRecords);
+		for (int i = 0; i < numRecords; i++)
+		{
+			keys[i] = i;
+		}
+		for (int i = numRecords - 1; i > 0; i--)
+		{
+			std::swap(keys[i], keys[rand() % (i + 1)]);
+		}
+
+		char key[STRINGSIZE + 1];
+		RecordId rid;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (int i = 0; i < numRecords; i++)
+		{
+			sprintf(key, "%05d string record", keys[i]);
+			rid.page_number = keys[i] + 1;
+			rid.slot_number = 0;
+			index.insertEntry(key, rid);
+		}
+		double buildMs = elapsedMs(start);
+
+		std::cout << "build time (ms): " << buildMs << std::endl;
+		std::cout << "height: " << index.getHeight()
+			<< " (119-key nodes: ~" << estimatedHeight(numRecords, STRINGARRAYLEAFSIZE, 119) << ")" << std::endl;
+
+		bufMgr->clearBufStats();
+		start = std::chrono::steady_clock::now();
+		for (int i = 0; i < numLookups; i++)
+		{
+			sprintf(key, "%05d string record", rand() % numRecords);
+			index.lookup(key, rid);
+		}
+		double lookupMs = elapsedMs(start);
+		std::cout << "lookup time (us/lookup): " << lookupMs * 1000.0 / numLookups << std::endl;
+		std::cout << "disk reads per lookup: "
+			<< (double) bufMgr->getBufStats().diskreads / numLookups << std::endl;
+	}
+	std::cout << "index pages: " << filePages(indexName) << std::endl;
+
+	delete bufMgr;
+	File::remove(indexName);
+	File::remove(relationName);
+}
+
+// -----------------------------------------------------------------------------
+// benchBuild
+// -----------------------------------------------------------------------------
+
+/**
+ * Compare building an integer index over numRecords keys by bulk loading in the
+ * constructor against inserting the same keys one at a time into an index over
+ * an empty relation. Reports build time, pages written and the resulting size.
+ */
+void benchBuild(int numRecords)
+{
+	std::cout << "---------------------" << std::endl;
+	std::cout << "Build: " << numRecords << " keys" << std::endl;
+	std::cout << "method		time(ms)	disk writes	index pages	height" << std::endl;
+
+	std::vector<int> keys(numRecords);
+	for (int i = 0; i < numRecords; i++)
+	{
+		keys[i] = i;
+	}
+	for (int i = numRecords - 1; i > 0; i--)
+	{
+		std::swap(keys[i], keys[rand() % (i + 1)]);
+	}
+
+	// each build is timed until the index is closed and its pages are flushed
+	for (int bulk = 1; bulk >= 0; bulk--)
+	{
+		createRelation(bulk ? numRecords : 0);
+		BufMgr* bufMgr = new BufMgr(100);
+		std::string indexName;
+		int height;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		{
+			BTreeIndex<int> index(relationName, indexName, bufMgr, offsetof(tuple,i), INTEGER);
+			for (int i = 0; !bulk && i < numRecords; i++)
+			{
+				RecordId rid;
+				rid.page_number = 1 + i / 50;
+				rid.slot_number = i % 50;
+				index.insertEntry(&keys[i], rid);
+			}
+			height = index.getHeight();
+		}
+		double buildMs = elapsedMs(start);
+		std::cout << (bulk ? "bulk load" : "insertEntry") << "	" << buildMs << "		"
+			<< bufMgr->getBufStats().diskwrites << "		" << filePages(indexName) << "		" << height << std::endl;
+
+		delete bufMgr;
+		File::remove(indexName);
+		File::remove(relationName);
+	}
+}
+
+// -----------------------------------------------------------------------------
+// benchExternalBuild
+// -----------------------------------------------------------------------------
+
+/**
+ * Build an integer index over numRecords keys with the given options and print
+ * the phase timings reported by the build.
+ */
+void timeExternalBuild(BufMgr* bufMgr, const IndexBuildOptions& options)
+{
+	std::string indexName;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	{
+		BTreeIndex<int> index(relationName, indexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+		const IndexBuildStats& stats = index.getBuildStats();
+		std::cout << (options.memoryBudget >> 10) << "\t" << options.numThreads << "\t" << options.mergeFanIn
+			<< "\t" << stats.numRuns << "\t" << stats.mergePasses
+			<< "\t" << stats.runMs << "\t" << stats.scanMs << "\t" << stats.sortMs
+			<< "\t" << stats.mergeMs << "\t" << stats.loadMs;
+	}
+	std::cout << "\t" << elapsedMs(start) << std::endl;
+	File::remove(indexName);
+}
+
+/**
+ * Build an integer index over a relation that does not fit in the memory budget,
+ * varying the number of threads and the merge fan-in.
+ */
+void benchExternalBuild(int numRecords)
+{
+	std::cout << "---------------------" << std::endl;
+	std::cout << "External build: " << numRecords << " keys, times in ms" << std::endl;
+	std::cout << "KB\tthreads\tfan-in\truns\tpasses\trungen\tscan\tsort\tmerge\tload\ttotal" << std::endl;
+
+	createRelation(numRecords);
+	BufMgr* bufMgr = new BufMgr(100);
+
+	IndexBuildOptions options;
+	timeExternalBuild(bufMgr, options);
+
+	options.memoryBudget = 1 << 20;
+	const int threads[] = { 1, 2, 4, 8 };
+	for (size_t t = 0; t < sizeof(threads) / sizeof(threads[0]); t++)
+	{
+		options.numThreads = threads[t];
+		timeExternalBuild(bufMgr, options);
+	}
+
+	options.numThreads = DEFAULT_BUILD_THREADS;
+	options.memoryBudget = 256 << 10;
+	const int fanIns[] = { 4, 8, 32 };
+	for (size_t f = 0; f < sizeof(fanIns) / sizeof(fanIns[0]); f++)
+	{
+		options.mergeFanIn = fanIns[f];
+		timeExternalBuild(bufMgr, options);
+	}
+
+	delete bufMgr;
+	File::remove(relationName);
+}
+
+// -----------------------------------------------------------------------------
+// benchDelete
+// -----------------------------------------------------------------------------
+
+/**
+ * Delete most of the entries of an integer index in random order, then insert
+ * them again, reporting time per operation, height and the index file size.
+ */
+void benchDelete(int numRecords)
+{
+	std::cout << "---------------------" << std::endl;
+	std::cout << "Delete: " << numRecords << " keys" << std::endl;
+
+	createRelation(numRecords);
+	BufMgr* bufMgr = new BufMgr(100);
+	std::string indexName;
+
+	// the (key, rid) pairs to delete, in random order
+	std::vector< RIDKeyPair<int> > entries;
+	{
+		FileScan fileScanner(relationName, bufMgr);
+		try
+		{
+			RecordId rid;
+			RIDKeyPair<int> entry;
+			while (1)
+			{
+				fileScanner.scanNext(rid);
+				std::string recordStr = fileScanner.getRecord();
+				entry.set(rid, reinterpret_cast<const RECORD*>(recordStr.data())->i);
+				entries.push_back(entry);
+			}
+		}
+		catch(EndOfFileException e)
+		{
+		}
+	}
+	for (int i = numRecords - 1; i > 0; i--)
+	{
+		std::swap(entries[i], entries[rand() % (i + 1)]);
+	}
+	int numDeletes = numRecords - numRecords / 10;
+
+	{
+		BTreeIndex<int> index(relationName, indexName, bufMgr, offsetof(tuple,i), INTEGER);
+		std::cout << "height after build: " << index.getHeight() << std::endl;
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (int i = 0; i < numDeletes; i++)
+		{
+			index.deleteEntry(&entries[i].key, entries[i].rid);
+		}
+		double deleteMs = elapsedMs(start);
+		std::cout << "delete time (us/delete): " << deleteMs * 1000.0 / numDeletes << std::endl;
+		std::cout << "height after deleting " << numDeletes << ": " << index.getHeight() << std::endl;
+
+		start = std::chrono::steady_clock::now();
+		for (int i = 0; i < numDeletes; i++)
+		{
+			index.insertEntry(&entries[i].key, entries[i].rid);
+		}
+		double insertMs = elapsedMs(start);
+		std::cout << "reinsert time (us/insert): " << insertMs * 1000.0 / numDeletes << std::endl;
+		std::cout << "height after reinserting: " << index.getHeight() << std::endl;
+	}
+	// reinserted entries land in the pages freed by the deletes first
+	std::cout << "index pages: " << filePages(indexName) << std::endl;
+
+	delete bufMgr;
+	File::remove(indexName);
+	File::remove(relationName);
+}
+
+// -----------------------------------------------------------------------------
+// benchConcurrency
+// -----------------------------------------------------------------------------
+
+enum Workload { INSERT_ONLY, LOOKUP_ONLY, MIXED, READ_MOSTLY };
+
+const char* const workloadNames[] = { "insert", "lookup", "mixed", "95% lookup" };
+
+/**
+ * Percentage of the operations of each workload that are inserts.
+ */
+const int insertPercent[] = { 100, 0, 50, 5 };
+
+/**
+ * What one thread of a concurrent run does: numOps operations of the workload
+ * on index. Keys 0 .. numKeys-1 are in the index already, inserted keys are
+ * new and distinct across threads. With a globalMutex every operation holds
+ * it, as the index did before it could be shared between threads. The thread
+ * counts its inserts in numInserted and the lookups that did not find exactly
+ * one entry in numMissed.
+ */
+struct ConcurrentRun {
+	BTreeIndex<int>* index;
+	std::mutex* globalMutex;
+	Workload workload;
+	int thread;
+	int numThreads;
+	int numKeys;
+	int numOps;
+	int* numInserted;
+	int* numMissed;
+};
+
+/**
+ * Look up key with a one key scan and return how many entries it has.
+ */
+int pointLookup(BTreeIndex<int>* index, int key)
+{
+	int count = 0;
+	RecordId rid;
+	index->startScan(&key, GTE, &key, LTE);
+	try
+	{
+		while (1)
+		{
+			index->scanNext(rid);
+			count++;
+		}
+	}
+	catch(IndexScanCompletedException e)
+	{
+	}
+	index->endScan();
+	return count;
+}
+
+void concurrentWorker(ConcurrentRun run)
+{
+	unsigned int seed = run.thread * 2654435761u + 1;
+	int nextInsertKey = run.numKeys + run.thread;
+	for (int i = 0; i < run.numOps; i++)
+	{
+		seed = seed * 1103515245 + 12345;
+		bool insert = (int) ((seed >> 16) % 100) < insertPercent[run.workload];
+
+		std::unique_lock<std::mutex> guard;
+		if (run.globalMutex != NULL)
+		{
+			guard = std::unique_lock<std::mutex>(*run.globalMutex);
+		}
+		if (insert)
+		{
+			RecordId rid;
+			rid.page_number = nextInsertKey / 100 + 1;
+			rid.slot_number = nextInsertKey % 100;
+			run.index->insertEntry(&nextInsertKey, rid);
+			nextInsertKey += run.numThreads;
+			(*run.numInserted)++;
+		}
+		else if (pointLookup(run.index, (seed >> 8) % run.numKeys) != 1)
+		{
+			(*run.numMissed)++;
+		}
+	}
+}
+
+/**
+ * Run the workload with numThreads threads sharing a freshly built index and
+ * return the throughput in thousands of operations per second. Once the threads
+ * are done the index must hold the keys it was built with and every key inserted,
+ * each once, and every lookup must have found its key, or matching is cleared.
+ */
+double timeConcurrent(int numKeys, int numOps, Workload workload, int numThreads, bool globalMutex,
+		bool& matching, ReadMode readMode = LATCH_CRABBING)
+{
+	BufMgr* bufMgr = new BufMgr(2000);
+	std::string indexName;
+	double ms;
+	{
+		BTreeIndex<int> index(relationName, indexName, bufMgr, offsetof(tuple,i), INTEGER);
+		index.setReadMode(readMode);
+		std::mutex mutex;
+		std::vector<std::thread> threads;
+		std::vector<int> numInserted(numThreads, 0);
+		std::vector<int> numMissed(numThreads, 0);
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (int t = 0; t < numThreads; t++)
+		{
+			ConcurrentRun run = { &index, globalMutex ? &mutex : NULL, workload, t, numThreads, numKeys, numOps / numThreads,
+				&numInserted[t], &numMissed[t] };
+			threads.push_back(std::thread(concurrentWorker, run));
+		}
+		for (int t = 0; t < numThreads; t++)
+		{
+			threads[t].join();
+		}
+		ms = elapsedMs(start);
+
+		// a full scan counts every entry once, and each thread's inserts can be looked up
+		int expected = numKeys;
+		for (int t = 0; t < numThreads; t++)
+		{
+			expected += numInserted[t];
+			if (numMissed[t] > 0)
+			{
+				matching = false;
+			}
+			for (int i = 0; i < numInserted[t]; i++)
+			{
+				int key = numKeys + t + i * numThreads;
+				RecordId rid;
+				if (!index.lookup(&key, rid))
+				{
+					matching = false;
+				}
+			}
+		}
+		int low = 0;
+		int high = numKeys + numOps;
+		int count = 0;
+		std::vector<RecordId> rids;
+		index.startScan(&low, GTE, &high, LT);
+		while (index.scanNextBatch(rids, 256))
+		{
+			count += rids.size();
+		}
+		index.endScan();
+		if (count != expected)
+		{
+			matching = false;
+		}
+	}
+	delete bufMgr;
+	File::remove(indexName);
+	return (numOps / numThreads) * numThreads / ms;
+}
+
+/**
+ * Throughput of inserts, point lookups and an even mix of both from 1 to 32
+ * threads, with latch crabbing against one mutex around the whole index.
+ */
+void benchConcurrency(int numKeys, int numOps)
+{
+	std::cout << "---------------------" << std::endl;
+	std::cout << "Concurrency: " << numKeys << " keys, " << numOps << " operations per run, "
+		<< std::thread::hardware_concurrency() << " hardware threads" << std::endl;
+	std::cout << "throughput in Kops/s, crabbing / global mutex" << std::endl;
+	std::cout << "threads";
+	for (int w = INSERT_ONLY; w <= MIXED; w++)
+	{
+		std::cout << "\t" << workloadNames[w] << "\t\t";
+	}
+	std::cout << std::endl;
+
+	createRelation(numKeys);
+	const int threadCounts[] = { 1, 2, 4, 8, 16, 32 };
+	for (size_t t = 0; t < sizeof(threadCounts) / sizeof(threadCounts[0]); t++)
+	{
+		std::cout << threadCounts[t];
+		bool matching = true;
+		for (int w = INSERT_ONLY; w <= MIXED; w++)
+		{
+			double crabbing = timeConcurrent(numKeys, numOps, (Workload) w, threadCounts[t], false, matching);
+			double global = timeConcurrent(numKeys, numOps, (Workload) w, threadCounts[t], true, matching);
+			std::cout << "\t" << crabbing << " / " << global;
+		}
+		if (!matching)
+		{
+			std::cout << "\tMISMATCH";
+		}
+		std::cout << std::endl;
+	}
+	File::remove(relationName);
+}
+
+/**
+ * Throughput of lookups alone and with 5% inserts from 1 to 32 threads, with
+ * lookups latch crabbing against optimistic lock coupling.
+ */
+void benchOptimistic(int numKeys, int numOps)
+{
+	std::cout << "---------------------" << std::endl;
+	std::cout << "Optimistic lock coupling: " << numKeys << " keys, " << numOps << " operations per run" << std::endl;
+	std::cout << "throughput in Kops/s, crabbing / optimistic" << std::endl;
+	std::cout << "threads\t" << workloadNames[LOOKUP_ONLY] << "\t\t" << workloadNames[READ_MOSTLY] << std::endl;
+
+	createRelation(numKeys);
+	const int threadCounts[] = { 1, 2, 4, 8, 16, 32 };
+	const Workload workloads[] = { LOOKUP_ONLY, READ_MOSTLY };
+	for (size_t t = 0; t < sizeof(threadCounts) / sizeof(threadCounts[0]); t++)
+	{
+		std::cout << threadCounts[t];
+		bool matching = true;
+		for (int w = 0; w < 2; w++)
+		{
+			double crabbing = timeConcurrent(numKeys, numOps, workloads[w], threadCounts[t], false, matching, LATCH_CRABBING);
+			double optimistic = timeConcurrent(numKeys, numOps, workloads[w], threadCounts[t], false, matching, OPTIMISTIC_LOCK_COUPLING);
+			std::cout << "\t" << crabbing << " / " << optimistic;
+		}
+		if (!matching)
+		{
+			std::cout << "\tMISMATCH";
+		}
+		std::cout << std::endl;
+	}
+	File::remove(relationName);
+}
+
+/**
+ * Throughput of inserts and of an even mix of inserts and lookups from 1 to 32
+ * threads, with latch crabbing against the B-link mode.
+ */
+void benchBlink(int numKeys, int numOps)
+{
+	std::cout << "---------------------" << std::endl;
+	std::cout << "B-link: " << numKeys << " keys, " << numOps << " operations per run" << std::endl;
+	std::cout << "throughput in Kops/s, crabbing / B-link" << std::endl;
+	std::cout << "threads\t" << workloadNames[INSERT_ONLY] << "\t\t" << workloadNames[MIXED] << std::endl;
+
+	createRelation(numKeys);
+	const int threadCounts[] = { 1, 2, 4, 8, 16, 32 };
+	const Workload workloads[] = { INSERT_ONLY, MIXED };
+	for (size_t t = 0; t < sizeof(threadCounts) / sizeof(threadCounts[0]); t++)
+	{
+		std::cout << threadCounts[t];
+		bool matching = true;
+		for (int w = 0; w < 2; w++)
+		{
+			double crabbing = timeConcurrent(numKeys, numOps, workloads[w], threadCounts[t], false, matching, LATCH_CRABBING);
+			double blink = timeConcurrent(numKeys, numOps, workloads[w], threadCounts[t], false, matching, B_LINK);
+			std::cout << "\t" << crabbing << " / " << blink;
+		}
+		if (!matching)
+		{
+			std::cout << "\tMISMATCH";
+		}
+		std::cout << std::endl;
+	}
+	File::remove(relationName);
+}
+
+// -----------------------------------------------------------------------------
+// benchScan
+// -----------------------------------------------------------------------------
+
+/**
+ * Compare range scans of scanLength keys fetched one record id per scanNext
+ * call against batches of batchSize from scanNextBatch.
+ */
+void benchScan(int numRecords, int scanLength, int numScans)
+{
+	std::cout << "---------------------" << std::endl;
+	std::cout << "Range scan: " << numRecords << " keys, " << numScans << " scans of " << scanLength << " keys" << std::endl;
+	std::cout << "method	batch	ns/record" << std::endl;
+
+	createRelation(numRecords);
+	BufMgr* bufMgr = new BufMgr(1000);
+	std::string indexName;
+	{
+		BTreeIndex<int> index(relationName, indexName, bufMgr, offsetof(tuple,i), INTEGER);
+		std::vector<int> lows(numScans);
+		for (int i = 0; i < numScans; i++)
+		{
+			lows[i] = rand() % (numRecords - scanLength);
+		}
+
+		long count = 0;
+		RecordId rid;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (int i = 0; i < numScans; i++)
+		{
+			int high = lows[i] + scanLength;
+			index.startScan(&lows[i], GTE, &high, LT);
+			try
+			{
+				while (1)
+				{
+					index.scanNext(rid);
+					count++;
+				}
+			}
+			catch(IndexScanCompletedException e)
+			{
+			}
+			index.endScan();
+		}
+		std::cout << "scanNext\t1\t" << elapsedMs(start) * 1e6 / count << std::endl;
+
+		const int batchSizes[] = { 64, 1024 };
+		for (size_t b = 0; b < sizeof(batchSizes) / sizeof(batchSizes[0]); b++)
+		{
+			long batchCount = 0;
+			std::vector<RecordId> rids;
+			start = std::chrono::steady_clock::now();
+			for (int i = 0; i < numScans; i++)
+			{
+				int high = lows[i] + scanLength;
+				index.startScan(&lows[i], GTE, &high, LT);
+				while (index.scanNextBatch(rids, batchSizes[b]))
+				{
+					batchCount += rids.size();
+				}
+				index.endScan();
+			}
+			std::cout << "scanNextBatch\t" << batchSizes[b] << "\t" << elapsedMs(start) * 1e6 / batchCount;
+			if (batchCount != count)
+			{
+				std::cout << "\tMISMATCH";
+			}
+			std::cout << std::endl;
+		}
+
+		// the last k keys of each range, buffering a forward scan against a backward scan stopped after k
+		const int k = 10;
+		std::vector<RecordId> rids;
+		std::vector<RecordId> all;
+		start = std::chrono::steady_clock::now();
+		for (int i = 0; i < numScans; i++)
+		{
+			int high = lows[i] + scanLength;
+			all.clear();
+			index.startScan(&lows[i], GTE, &high, LT);
+			while (index.scanNextBatch(rids, 1024))
+			{
+				all.insert(all.end(), rids.begin(), rids.end());
+			}
+			index.endScan();
+		}
+		double forwardUs = elapsedMs(start) * 1000.0 / numScans;
+		start = std::chrono::steady_clock::now();
+		for (int i = 0; i < numScans; i++)
+		{
+			int high = lows[i] + scanLength;
+			index.startScan(&lows[i], GTE, &high, LT, BACKWARD);
+			index.scanNextBatch(rids, k);
+			index.endScan();
+		}
+		double backwardUs = elapsedMs(start) * 1000.0 / numScans;
+		std::cout << "last " << k << " keys (us/query): forward " << forwardUs << ", backward " << backwardUs << std::endl;
+	}
+
+	delete bufMgr;
+	File::remove(indexName);
+	File::remove(relationName);
+}
+
+// -----------------------------------------------------------------------------
+// benchCompressedLeaves
+// -----------------------------------------------------------------------------
+
+/**
+ * Compare integer indexes over numRecords dense keys built with plain and with compressed
+ * leaves: size, build time, then range scans of scanLength keys and random point lookups
+ * through a small buffer pool, reporting the pages read from disk per scan.
+ */
+void benchCompressedLeaves(int numRecords, int scanLength, int numScans, int numLookups)
+{
+	std::cout << "---------------------" << std::endl;
+	std::cout << "Compressed leaves: " << numRecords << " keys, " << numScans << " scans of " << scanLength
+		<< " keys, " << numLookups << " lookups" << std::endl;
+	std::cout << "leaves		build(ms)	index pages	scan(us)	reads/scan	lookup(us)" << std::endl;
+
+	createRelation(numRecords);
+	std::vector<int> lows(numScans);
+	for (int i = 0; i < numScans; i++)
+	{
+		lows[i] = rand() % (numRecords - scanLength);
+	}
+
+	for (int compress = 0; compress < 2; compress++)
+	{
+		BufMgr* bufMgr = new BufMgr(64);
+		std::string indexName;
+		{
+			IndexBuildOptions options;
+			options.compressLeaves = (compress == 1);
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			BTreeIndex<int> index(relationName, indexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+			double buildMs = elapsedMs(start);
+
+			std::vector<RecordId> rids;
+			bufMgr->clearBufStats();
+			start = std::chrono::steady_clock::now();
+			for (int i = 0; i < numScans; i++)
+			{
+				int high = lows[i] + scanLength;
+				index.startScan(&lows[i], GTE, &high, LT);
+				while (index.scanNextBatch(rids, 1024))
+				{
+				}
+				index.endScan();
+			}
+			double scanUs = elapsedMs(start) * 1000.0 / numScans;
+			double readsPerScan = (double) bufMgr->getBufStats().diskreads / numScans;
+
+			RecordId rid;
+			start = std::chrono::steady_clock::now();
+			for (int i = 0; i < numLookups; i++)
+			{
+				int key = rand() % numRecords;
+				index.lookup(&key, rid);
+			}
+			double lookupUs = elapsedMs(start) * 1000.0 / numLookups;
+
+			std::cout << (compress ? "compressed" : "plain") << "\t" << buildMs << "\t\t" << filePages(indexName)
+				<< "\t\t" << scanUs << "\t\t" << readsPerScan << "\t\t" << lookupUs << std::endl;
+		}
+		delete bufMgr;
+		File::remove(indexName);
+	}
+	File::remove(relationName);
+}
+
+// -----------------------------------------------------------------------------
+// benchDuplicates
+// -----------------------------------------------------------------------------
+
+/**
+ * Compare plain and compressed leaves on a column of numDistinct values over numRecords rows:
+ * index pages after the bulk load and after inserting as many duplicates again, then lookupAll
+ * of random values through a small buffer pool, per record id returned.
+ */
+void benchDuplicates(int numRecords, int numDistinct, int numLookups)
+{
+	std::cout << "---------------------" << std::endl;
+	std::cout << "Duplicates: " << numRecords << " rows, " << numDistinct << " distinct keys, "
+		<< numLookups << " lookups" << std::endl;
+	std::cout << "leaves		bulk pages	after inserts	lookupAll(ns/rid)	reads/lookup" << std::endl;
+
+	createRelation(numRecords, numDistinct);
+	for (int compress = 0; compress < 2; compress++)
+	{
+		BufMgr* bufMgr = new BufMgr(64);
+		std::string indexName;
+		{
+			IndexBuildOptions options;
+			options.compressLeaves = (compress == 1);
+			BTreeIndex<int> index(relationName, indexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+			long bulkPages = filePages(indexName);
+
+			for (int i = 0; i < numRecords; i++)
+			{
+				int key = rand() % numDistinct;
+				RecordId rid;
+				rid.page_number = i + 1;
+				rid.slot_number = 1;
+				index.insertEntry(&key, rid);
+			}
+			long insertPages = filePages(indexName);
+
+			std::vector<RecordId> rids;
+			long count = 0;
+			bufMgr->clearBufStats();
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			for (int i = 0; i < numLookups; i++)
+			{
+				int key = rand() % numDistinct;
+				count += index.lookupAll(&key, rids);
+			}
+			double lookupMs = elapsedMs(start);
+			std::cout << (compress ? "compressed" : "plain") << "\t" << bulkPages << "\t\t" << insertPages
+				<< "\t\t" << lookupMs * 1e6 / count << "\t\t\t" << (double) bufMgr->getBufStats().diskreads / numLookups << std::endl;
+		}
+		delete bufMgr;
+		File::remove(indexName);
+	}
+	File::remove(relationName);
+}
+
+// -----------------------------------------------------------------------------
+// benchReopen
+// -----------------------------------------------------------------------------
+
+/**
+ * Compare the startup time of an index over numRecords keys built from its relation with
+ * that of the same index reopened from its meta page, then time numLookups random lookups
+ * on a cold buffer pool to show the reopened index is ready to serve.
+ */
+void benchReopen(int numRecords, int numLookups)
+{
+	std::cout << "---------------------" << std::endl;
+	std::cout << "Reopen: " << numRecords << " keys, " << numLookups << " lookups" << std::endl;
+	std::cout << "startup	ms		lookup(us)" << std::endl;
+
+	createRelation(numRecords);
+	std::string indexName;
+	for (int reopen = 0; reopen < 2; reopen++)
+	{
+		BufMgr* bufMgr = new BufMgr(256);
+		{
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			BTreeIndex<int> index(relationName, indexName, bufMgr, offsetof(tuple,i), INTEGER);
+			double startupMs = elapsedMs(start);
+
+			int found = 0;
+			RecordId rid;
+			start = std::chrono::steady_clock::now();
+			for (int i = 0; i < numLookups; i++)
+			{
+				int key = rand() % numRecords;
+				found += index.lookup(&key, rid);
+			}
+			double lookupMs = elapsedMs(start);
+			if (found != numLookups)
+			{
+				std::cout << "lookups found " << found << " of " << numLookups << std::endl;
+			}
+			std::cout << (reopen ? "reopen" : "rebuild") << "\t" << startupMs << "\t\t" << lookupMs * 1000 / numLookups << std::endl;
+		}
+		delete bufMgr;
+	}
+	File::remove(indexName);
+	File::remove(relationName);
+}
+
+// -----------------------------------------------------------------------------
+// benchLookup
+// -----------------------------------------------------------------------------
+
+/**
+ * Compare equality lookups through a one key scan against lookup and
+ * lookupAll, in each read mode. Reports time per lookup.
+ */
+void benchLookup(int numRecords, int numLookups)
+{
+	std::cout << "---------------------" << std::endl;
+	std::cout << "Point lookup: " << numRecords << " keys, " << numLookups << " lookups" << std::endl;
+	std::cout << "mode\tscan(us)\tlookup(us)\tlookupAll(us)" << std::endl;
+
+	createRelation(numRecords);
+	BufMgr* bufMgr = new BufMgr(2000);
+	std::string indexName;
+	{
+		BTreeIndex<int> index(relationName, indexName, bufMgr, offsetof(tuple,i), INTEGER);
+		std::vector<int> keys(numLookups);
+		for (int i = 0; i < numLookups; i++)
+		{
+			keys[i] = rand() % numRecords;
+		}
+
+		const char* const modeNames[] = { "crabbing", "optimistic", "b-link" };
+		const ReadMode modes[] = { LATCH_CRABBING, OPTIMISTIC_LOCK_COUPLING, B_LINK };
+		for (int m = 0; m < 3; m++)
+		{
+			index.setReadMode(modes[m]);
+			long scanFound = 0, lookupFound = 0, lookupAllFound = 0;
+
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			for (int i = 0; i < numLookups; i++)
+			{
+				scanFound += pointLookup(&index, keys[i]);
+			}
+			double scanMs = elapsedMs(start);
+
+			RecordId rid;
+			start = std::chrono::steady_clock::now();
+			for (int i = 0; i < numLookups; i++)
+			{
+				lookupFound += index.lookup(&keys[i], rid);
+			}
+			double lookupMs = elapsedMs(start);
+
+			std::vector<RecordId> rids;
+			start = std::chrono::steady_clock::now();
+			for (int i = 0; i < numLookups; i++)
+			{
+				lookupAllFound += index.lookupAll(&keys[i], rids);
+			}
+			double lookupAllMs = elapsedMs(start);
+
+			std::cout << modeNames[m] << "\t" << scanMs * 1000.0 / numLookups << "\t\t"
+				<< lookupMs * 1000.0 / numLookups << "\t\t" << lookupAllMs * 1000.0 / numLookups;
+			if (scanFound != numLookups || lookupFound != numLookups || lookupAllFound != numLookups)
+			{
+				std::cout << "\tMISMATCH";
+			}
+			std::cout << std::endl;
+		}
+	}
+
+	delete bufMgr;
+	File::remove(indexName);
+	File::remove(relationName);
+}
+
+// -----------------------------------------------------------------------------
+// benchInsertBatch
+// -----------------------------------------------------------------------------
+
+/**
+ * Time inserting numInserts keys into an index over numRecords keys one
+ * insertEntry at a time, then through insertBatch in batches of each size, each
+ * into a freshly built index. The keys are either random among the existing
+ * ones or ascending past them, as for an index on arrival time. Reports time
+ * per insert and the resulting height.
+ */
+void benchInsertBatch(int numRecords, int numInserts)
+{
+	std::cout << "---------------------" << std::endl;
+	std::cout << "Batched insert: " << numInserts << " keys into " << numRecords << std::endl;
+	std::cout << "keys\t\tbatch\tus/insert\theight" << std::endl;
+
+	createRelation(numRecords);
+	const char* const orderNames[] = { "random", "ascending" };
+	for (int order = 0; order < 2; order++)
+	{
+		std::vector< RIDKeyPair<int> > entries(numInserts);
+		for (int i = 0; i < numInserts; i++)
+		{
+			RecordId rid;
+			rid.page_number = i + 1;
+			rid.slot_number = 1;
+			entries[i].set(rid, (order == 0) ? rand() % numRecords : numRecords + i);
+		}
+
+		const int batchSizes[] = { 1, 100, 1000, 10000 };
+		for (size_t b = 0; b < sizeof(batchSizes) / sizeof(batchSizes[0]); b++)
+		{
+			int batchSize = batchSizes[b];
+			BufMgr* bufMgr = new BufMgr(2000);
+			std::string indexName;
+			{
+				BTreeIndex<int> index(relationName, indexName, bufMgr, offsetof(tuple,i), INTEGER);
+				std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+				if (batchSize == 1)
+				{
+					for (int i = 0; i < numInserts; i++)
+					{
+						index.insertEntry(&entries[i].key, entries[i].rid);
+					}
+				}
+				else
+				{
+					for (int i = 0; i < numInserts; i += batchSize)
+					{
+						std::vector< RIDKeyPair<int> > batch(entries.begin() + i,
+							entries.begin() + std::min(numInserts, i + batchSize));
+						index.insertBatch(batch);
+					}
+				}
+				double insertMs = elapsedMs(start);
+				std::cout << orderNames[order] << "\t" << (order == 0 ? "\t" : "") << batchSize << "\t"
+					<< insertMs * 1000.0 / numInserts << "\t\t" << index.getHeight() << std::endl;
+			}
+			delete bufMgr;
+			File::remove(indexName);
+		}
+	}
+	File::remove(relationName);
+}
+
+// -----------------------------------------------------------------------------
+// benchMultiGet
+// -----------------------------------------------------------------------------
+
+/**
+ * Compare looking up batches of random keys one lookupAll at a time against
+ * one multiGet per batch, reporting time and buffer pool pins per key.
+ */
+void benchMultiGet(int numRecords, int numLookups)
+{
+	std::cout << "---------------------" << std::endl;
+	std::cout << "Multi-get: " << numRecords << " keys, " << numLookups << " lookups" << std::endl;
+
+	createRelation(numRecords);
+	BufMgr* bufMgr = new BufMgr(2000);
+	std::string indexName;
+	{
+		BTreeIndex<int> index(relationName, indexName, bufMgr, offsetof(tuple,i), INTEGER);
+		std::cout << "height: " << index.getHeight() << std::endl;
+		std::cout << "batch\tlookupAll(us/key)\tpins/key\tmultiGet(us/key)\tpins/key" << std::endl;
+
+		const int batchSizes[] = { 10, 100, 1000 };
+		for (size_t b = 0; b < sizeof(batchSizes) / sizeof(batchSizes[0]); b++)
+		{
+			int batchSize = batchSizes[b];
+			int numBatches = numLookups / batchSize;
+			std::vector< std::vector<int> > batches(numBatches, std::vector<int>(batchSize));
+			for (int i = 0; i < numBatches; i++)
+			{
+				for (int k = 0; k < batchSize; k++)
+				{
+					batches[i][k] = rand() % numRecords;
+				}
+			}
+			long numKeys = (long) numBatches * batchSize;
+
+			std::vector<RecordId> rids;
+			long singleFound = 0;
+			bufMgr->clearBufStats();
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			for (int i = 0; i < numBatches; i++)
+			{
+				for (int k = 0; k < batchSize; k++)
+				{
+					singleFound += index.lookupAll(&batches[i][k], rids);
+				}
+			}
+			double singleMs = elapsedMs(start);
+			double singlePins = (double) bufMgr->getBufStats().accesses / numKeys;
+
+			std::vector<int> counts;
+			long batchFound = 0;
+			bufMgr->clearBufStats();
+			start = std::chrono::steady_clock::now();
+			for (int i = 0; i < numBatches; i++)
+			{
+				batchFound += index.multiGet(batches[i], rids, counts);
+			}
+			double batchMs = elapsedMs(start);
+			double batchPins = (double) bufMgr->getBufStats().accesses / numKeys;
+
+			std::cout << batchSize << "\t" << singleMs * 1000.0 / numKeys << "\t\t\t" << singlePins
+				<< "\t\t" << batchMs * 1000.0 / numKeys << "\t\t\t" << batchPins;
+			if (singleFound != numKeys || batchFound != numKeys)
+			{
+				std::cout << "\tMISMATCH";
+			}
+			std::cout << std::endl;
+		}
+	}
+
+	delete bufMgr;
+	File::remove(indexName);
+	File::remove(relationName);
+}
+
+// -----------------------------------------------------------------------------
+// benchPinnedLevels
+// -----------------------------------------------------------------------------
+
+/**
+ * Look up every key in keys.
+ */
+void lookupWorker(BTreeIndex<int>* index, const std::vector<int>* keys)
+{
+	RecordId rid;
+	for (size_t i = 0; i < keys->size(); i++)
+	{
+		index->lookup(&(*keys)[i], rid);
+	}
+}
+
+/**
+ * Time random lookups, from one thread and from several at once, with none and then
+ * more and more of the upper levels of the tree pinned. Reports the buffer pool pins
+ * left per lookup and the wall time per lookup.
+ */
+void benchPinnedLevels(int numRecords, int numLookups, int numThreads)
+{
+	std::cout << "---------------------" << std::endl;
+	std::cout << "Pinned levels: " << numRecords << " keys, " << numLookups << " lookups per thread" << std::endl;
+
+	createRelation(numRecords);
+	BufMgr* bufMgr = new BufMgr(4000);
+	std::string indexName;
+	{
+		// sparse nodes give a tree of a few levels without a large relation
+		IndexBuildOptions options;
+		options.fillFactor = 0.1;
+		BTreeIndex<int> index(relationName, indexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+		int height = index.getHeight();
+		std::cout << "height: " << height << std::endl;
+		std::cout << "levels\tpins/lookup\t1 thread(us)\t" << numThreads << " threads(us)" << std::endl;
+
+		std::vector< std::vector<int> > keys(numThreads, std::vector<int>(numLookups));
+		for (int t = 0; t < numThreads; t++)
+		{
+			for (int i = 0; i < numLookups; i++)
+			{
+				keys[t][i] = rand() % numRecords;
+			}
+		}
+
+		for (int levels = 0; levels < height; levels++)
+		{
+			index.setPinnedLevels(levels, 1000 * Page::SIZE);
+
+			RecordId rid;
+			bufMgr->clearBufStats();
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			for (int i = 0; i < numLookups; i++)
+			{
+				index.lookup(&keys[0][i], rid);
+			}
+			double singleMs = elapsedMs(start);
+			double pins = (double) bufMgr->getBufStats().accesses / numLookups;
+
+			std::vector<std::thread> threads;
+			start = std::chrono::steady_clock::now();
+			for (int t = 0; t < numThreads; t++)
+			{
+				threads.push_back(std::thread(lookupWorker, &index, &keys[t]));
+			}
+			for (size_t t = 0; t < threads.size(); t++)
+			{
+				threads[t].join();
+			}
+			double threadedMs = elapsedMs(start);
+
+			std::cout << levels << "\t" << pins << "\t\t" << singleMs * 1000.0 / numLookups
+				<< "\t\t" << threadedMs * 1000.0 / ((double) numLookups * numThreads) << std::endl;
+		}
+	}
+
+	delete bufMgr;
+	File::remove(indexName);
+	File::remove(relationName);
+}
+
+// -----------------------------------------------------------------------------
+// benchSwizzle
+// -----------------------------------------------------------------------------
+
+/**
+ * Time random lookups through a tree held entirely in the buffer pool with no level
+ * pinned, in each read mode. Descents reach the nodes above the leaf through the frames
+ * they were last read into: optimistic lock coupling reads them there without pinning,
+ * the other modes pin them there without probing the buffer manager's hash table.
+ * Reports the buffer pool pins and hash table probes per lookup and the wall time per
+ * lookup from one thread and from several.
+ */
+void benchSwizzle(int numRecords, int numLookups, int numThreads)
+{
+	std::cout << "---------------------" << std::endl;
+	std::cout << "Swizzled descents: " << numRecords << " keys, " << numLookups << " lookups per thread" << std::endl;
+
+	createRelation(numRecords);
+	BufMgr* bufMgr = new BufMgr(4000);
+	std::string indexName;
+	{
+		// sparse nodes give a tree of a few levels without a large relation
+		IndexBuildOptions options;
+		options.fillFactor = 0.1;
+		BTreeIndex<int> index(relationName, indexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+		index.setPinnedLevels(0, 0);
+		std::cout << "height: " << index.getHeight() << std::endl;
+		std::cout << "mode\t\tpins/lookup\tprobes/lookup\t1 thread(us)\t" << numThreads << " threads(us)" << std::endl;
+
+		std::vector< std::vector<int> > keys(numThreads, std::vector<int>(numLookups));
+		for (int t = 0; t < numThreads; t++)
+		{
+			for (int i = 0; i < numLookups; i++)
+			{
+				keys[t][i] = rand() % numRecords;
+			}
+		}
+
+		const char* const modeNames[] = { "crabbing", "optimistic", "b-link\t" };
+		const ReadMode modes[] = { LATCH_CRABBING, OPTIMISTIC_LOCK_COUPLING, B_LINK };
+		for (int m = 0; m < 3; m++)
+		{
+			index.setReadMode(modes[m]);
+			lookupWorker(&index, &keys[0]);
+
+			bufMgr->clearBufStats();
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			lookupWorker(&index, &keys[0]);
+			double singleMs = elapsedMs(start);
+			double pins = (double) bufMgr->getBufStats().accesses / numLookups;
+			double probes = (double) bufMgr->getBufStats().hashlookups / numLookups;
+
+			std::vector<std::thread> threads;
+			start = std::chrono::steady_clock::now();
+			for (int t = 0; t < numThreads; t++)
+			{
+				threads.push_back(std::thread(lookupWorker, &index, &keys[t]));
+			}
+			for (size_t t = 0; t < threads.size(); t++)
+			{
+				threads[t].join();
+			}
+			double threadedMs = elapsedMs(start);
+
+			std::cout << modeNames[m] << "\t" << pins << "\t\t" << probes << "\t\t" << singleMs * 1000.0 / numLookups
+				<< "\t\t" << threadedMs * 1000.0 / ((double) numLookups * numThreads) << std::endl;
+		}
+	}
+
+	delete bufMgr;
+	File::remove(indexName);
+	File::remove(relationName);
+}
+
+// -----------------------------------------------------------------------------
+// benchCovering
+// -----------------------------------------------------------------------------
+
+/**
+ * Compare range scans of scanLength keys that need the double field of every matching record,
+ * read from the relation through a 100 frame buffer pool for each record id of a plain index
+ * against taken from the leaves of a covering index that includes it. Reports the build time,
+ * the index size and the time and pages read from disk per scan.
+ */
+void benchCovering(int numRecords, int scanLength, int numScans)
+{
+	std::cout << "---------------------" << std::endl;
+	std::cout << "Covering index: " << numRecords << " keys, " << numScans << " scans of " << scanLength << " keys" << std::endl;
+	std::cout << "index		build(ms)	index pages	scan(us)	reads/scan" << std::endl;
+
+	createRelation(numRecords);
+	std::vector<int> lows(numScans);
+	for (int i = 0; i < numScans; i++)
+	{
+		lows[i] = rand() % (numRecords - scanLength);
+	}
+
+	double sums[2] = { 0, 0 };
+	for (int covering = 0; covering < 2; covering++)
+	{
+		BufMgr* bufMgr = new BufMgr(100);
+		std::string indexName;
+		{
+			PageFile relFile = PageFile::open(relationName);
+			IndexBuildOptions options;
+			if (covering)
+			{
+				IncludedColumn column = { offsetof(tuple,d), sizeof(double) };
+				options.includedColumns.push_back(column);
+			}
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			BTreeIndex<int> index(relationName, indexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+			double buildMs = elapsedMs(start);
+
+			RecordId rid;
+			double d;
+			bufMgr->clearBufStats();
+			start = std::chrono::steady_clock::now();
+			for (int i = 0; i < numScans; i++)
+			{
+				int high = lows[i] + scanLength;
+				index.startScan(&lows[i], GTE, &high, LT);
+				try
+				{
+					while (1)
+					{
+						if (covering)
+						{
+							index.scanNext(rid, &d);
+						}
+						else
+						{
+							Page* page;
+							index.scanNext(rid);
+							bufMgr->readPage(&relFile, rid.page_number, page);
+							d = reinterpret_cast<const RECORD*>(page->getRecord(rid).data())->d;
+							bufMgr->unPinPage(&relFile, rid.page_number, false);
+						}
+						sums[covering] += d;
+					}
+				}
+				catch(IndexScanCompletedException e)
+				{
+				}
+				index.endScan();
+			}
+			double scanUs = elapsedMs(start) * 1000.0 / numScans;
+			double readsPerScan = (double) bufMgr->getBufStats().diskreads / numScans;
+			bufMgr->flushFile(&relFile);
+
+			std::cout << (covering ? "covering" : "plain") << "		" << buildMs << "		" << filePages(indexName)
+				<< "		" << scanUs << "		" << readsPerScan;
+			if (covering && sums[0] != sums[1])
+			{
+				std::cout << "	MISMATCH";
+			}
+			std::cout << std::endl;
+		}
+		delete bufMgr;
+		File::remove(indexName);
+	}
+	File::remove(relationName);
+}
+
+// -----------------------------------------------------------------------------
+// benchRidScan
+// -----------------------------------------------------------------------------
+
+/**
+ * Read the records of index range scans of growing length over a relation stored in
+ * random key order, once by fetching each record id in key order as the scan returns
+ * it and once through a RidScan that reads them in page order, through a 100-frame pool.
+ */
+void benchRidScan(int numRecords, int numScans)
+{
+	std::cout << "---------------------" << std::endl;
+	std::cout << "Rid scan: " << numRecords << " records in " << numScans << " scans per range" << std::endl;
+	std::cout << "range		key order(us)	reads/scan	page order(us)	reads/scan" << std::endl;
+
+	createRelation(numRecords);
+	BufMgr* bufMgr = new BufMgr(100);
+	std::string indexName;
+	{
+		PageFile relFile = PageFile::open(relationName);
+		BTreeIndex<int> index(relationName, indexName, bufMgr, offsetof(tuple,i), INTEGER);
+
+		const int ranges[] = { 100, 1000, 10000, 100000 };
+		for (size_t r = 0; r < sizeof(ranges) / sizeof(ranges[0]) && ranges[r] < numRecords; r++)
+		{
+			int range = ranges[r];
+			std::vector<int> lows(numScans);
+			for (int i = 0; i < numScans; i++)
+			{
+				lows[i] = rand() % (numRecords - range);
+			}
+
+			std::cout << range;
+			long sums[2] = { 0, 0 };
+			for (int pageOrder = 0; pageOrder < 2; pageOrder++)
+			{
+				bufMgr->clearBufStats();
+				std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+				for (int i = 0; i < numScans; i++)
+				{
+					int high = lows[i] + range;
+					std::vector<RecordId> rids;
+					std::vector<RecordId> batch;
+					index.startScan(&lows[i], GTE, &high, LT);
+					while (index.scanNextBatch(batch, 1024))
+					{
+						rids.insert(rids.end(), batch.begin(), batch.end());
+					}
+					index.endScan();
+
+					if (pageOrder)
+					{
+						RidScan rscan(relationName, bufMgr);
+						rscan.addRids(rids);
+						RecordId rid;
+						try
+						{
+							while (1)
+							{
+								rscan.scanNext(rid);
+								sums[pageOrder] += reinterpret_cast<const RECORD*>(rscan.getRecord().data())->i;
+							}
+						}
+						catch(EndOfFileException e)
+						{
+						}
+					}
+					else
+					{
+						for (size_t j = 0; j < rids.size(); j++)
+						{
+							Page* page;
+							bufMgr->readPage(&relFile, rids[j].page_number, page);
+							sums[pageOrder] += reinterpret_cast<const RECORD*>(page->getRecord(rids[j]).data())->i;
+							bufMgr->unPinPage(&relFile, rids[j].page_number, false);
+						}
+					}
+				}
+				double scanUs = elapsedMs(start) * 1000.0 / numScans;
+				double readsPerScan = (double) bufMgr->getBufStats().diskreads / numScans;
+				std::cout << "		" << scanUs << "		" << readsPerScan;
+			}
+			if (sums[0] != sums[1])
+			{
+				std::cout << "	MISMATCH";
+			}
+			std::cout << std::endl;
+		}
+		bufMgr->flushFile(&relFile);
+	}
+	delete bufMgr;
+	File::remove(indexName);
+	File::remove(relationName);
+}
+
+// -----------------------------------------------------------------------------
+// benchSearch
+// -----------------------------------------------------------------------------
+
+/**
+ * Time numSearches lower bound searches with the given function over numNodes
+ * sorted key arrays of fanout keys each, cycling through the nodes so that
+ * larger fanouts do not stay in L1. Returns nanoseconds per search.
+ */
+double timeSearch(NodeSearch<int>::SearchFn search, const std::vector<int>& nodes, int fanout,
+		const std::vector<int>& probes, long& checksum)
+{
+	int numNodes = nodes.size() / fanout;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < probes.size(); i++)
+	{
+		checksum += search(&nodes[(i % numNodes) * fanout], fanout, probes[i]);
+	}
+	return elapsedMs(start) * 1e6 / probes.size();
+}
+
+/**
+ * Compare the in-node search strategies at fanouts from a small node up to the
+ * page-derived int leaf and non-leaf capacities.
+ */
+void benchSearch(int numSearches)
+{
+	std::cout << "---------------------" << std::endl;
+	std::cout << "In-node search: " << numSearches << " searches, simd kernel: " << simdSearchIsa() << std::endl;
+	std::cout << "fanout\tlinear(ns)\tbinary(ns)\tsimd(ns)" << std::endl;
+
+	const int fanouts[] = { 16, 64, 256, INTARRAYLEAFSIZE, INTARRAYNONLEAFSIZE };
+	const int numNodes = 512;
+	for (size_t f = 0; f < sizeof(fanouts) / sizeof(fanouts[0]); f++)
+	{
+		int fanout = fanouts[f];
+		std::vector<int> nodes(numNodes * fanout);
+		for (int n = 0; n < numNodes; n++)
+		{
+			int key = rand() % 16;
+			for (int k = 0; k < fanout; k++)
+			{
+				key += 1 + rand() % 4;
+				nodes[n * fanout + k] = key;
+			}
+		}
+		std::vector<int> probes(numSearches);
+		for (int i = 0; i < numSearches; i++)
+		{
+			probes[i] = rand() % (fanout * 5 / 2 + 16);
+		}
+
+		long linearSum = 0, binarySum = 0, simdSum = 0;
+		double linearNs = timeSearch(NodeSearch<int>::lowerBound(LINEAR_SEARCH), nodes, fanout, probes, linearSum);
+		double binaryNs = timeSearch(NodeSearch<int>::lowerBound(BINARY_SEARCH), nodes, fanout, probes, binarySum);
+		double simdNs = timeSearch(NodeSearch<int>::lowerBound(SIMD_SEARCH), nodes, fanout, probes, simdSum);
+
+		std::cout << fanout << "\t" << linearNs << "\t\t" << binaryNs << "\t\t" << simdNs;
+		if (linearSum != binarySum || linearSum != simdSum)
+		{
+			std::cout << "\tMISMATCH";
+		}
+		std::cout << std::endl;
+	}
+}
+
+int main(int argc, char **argv)
+{
+	int numRecords = argc > 1 ? atoi(argv[1]) : 5000;
+	int numLookups = argc > 2 ? atoi(argv[2]) : 10000;
+
+	benchFanout(numRecords, numLookups);
+	benchStringFanout(numRecords * 8, numLookups * 10);
+	benchBuild(numRecords * 20);
+	benchExternalBuild(numRecords * 40);
+	benchDelete(numRecords * 40);
+	benchConcurrency(numRecords * 20, numLookups * 20);
+	benchOptimistic(numRecords * 20, numLookups * 20);
+	benchBlink(numRecords * 20, numLookups * 20);
+	benchScan(numRecords * 40, numRecords * 20, 20);
+	benchCompressedLeaves(numRecords * 40, numRecords * 2, 200, numLookups * 20);
+	benchDuplicates(numRecords * 40, 100, numLookups);
+	benchReopen(numRecords * 40, numLookups * 20);
+	benchLookup(numRecords * 20, numLookups * 20);
+	benchMultiGet(numRecords * 200, numLookups * 20);
+	benchPinnedLevels(numRecords * 40, numLookups * 20, 4);
+	benchSwizzle(numRecords * 40, numLookups * 20, 4);
+	benchCovering(numRecords * 40, numRecords * 2, 200);
+	benchRidScan(numRecords * 40, 10);
+	benchInsertBatch(numRecords * 40, numRecords * 40);
+	benchSearch(numLookups * 100);
+
+	return 0;
+}
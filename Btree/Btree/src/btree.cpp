@@ -5,7 +5,11 @@
  * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
  */
 
+#include <algorithm>
+#include <atomic>
+#include <limits>
 #include "btree.h"
+#include "index_builder.h"
 #include "filescan.h"
 #include "exceptions/bad_index_info_exception.h"
 #include "exceptions/bad_opcodes_exception.h"
@@ -22,81 +26,239 @@
 
 namespace badgerdb
 {
-	LeafNodeInt *BTreeIndex::CreateLeafNode(PageId &newPageId) {
+	// gives every index a distinct id, never reused, see lastThreadCursor
+	static std::atomic<unsigned long> indexCount(0);
+
+	// bytes that hold the included columns of the entries of a full leaf and one more
+	static const int LEAF_PAYLOAD_BYTES = NodeCapacity<int>::LEAF_BYTES + MAX_PAYLOAD_SIZE;
+
+	// orders entries by key alone, so that a stable sort keeps duplicates in the order given
+	template <class KeyT>
+	static bool keyLess(const RIDKeyPair<KeyT>& r1, const RIDKeyPair<KeyT>& r2)
+	{
+		return r1.key < r2.key;
+	}
+
+	template <class KeyT>
+	typename BTreeIndex<KeyT>::LeafNodeT *BTreeIndex<KeyT>::CreateLeafNode(PageId &newPageId) {
 		Page* newNode;
-		bufMgr->allocPage(file,newPageId, newNode);
-		((LeafNodeInt*) newNode)->numKeys = 0;
-  		return (LeafNodeInt*) newNode;
+		allocNodePage(newPageId, newNode);
+		leafFill((LeafNodeT*) newNode, NULL, NULL, NULL, 0);
+		((LeafNodeT*) newNode)->rightSibPageNo = Page::INVALID_NUMBER;
+		((LeafNodeT*) newNode)->leftSibPageNo = Page::INVALID_NUMBER;
+  		return (LeafNodeT*) newNode;
 	}
 
-	NonLeafNodeInt *BTreeIndex::CreateNonLeafNode(PageId &newPageId) {
+	template <class KeyT>
+	typename BTreeIndex<KeyT>::NonLeafNodeT *BTreeIndex<KeyT>::CreateNonLeafNode(PageId &newPageId) {
 		Page *newNode;
-		bufMgr->allocPage(file, newPageId,newNode);
-		((NonLeafNodeInt*) newNode)->numKeys = 0;
-		((NonLeafNodeInt*) newNode)->level = 0;
-		return (NonLeafNodeInt*) newNode;
+		allocNodePage(newPageId, newNode);
+		((NonLeafNodeT*) newNode)->numKeys = 0;
+		((NonLeafNodeT*) newNode)->level = 0;
+		((NonLeafNodeT*) newNode)->rightSibPageNo = Page::INVALID_NUMBER;
+		return (NonLeafNodeT*) newNode;
 	}
 	// -----------------------------------------------------------------------------
 	// BTreeIndex::BTreeIndex -- Constructor
 	// -----------------------------------------------------------------------------
 
-	BTreeIndex::BTreeIndex(const std::string & relationName,
+	template <class KeyT>
+	BTreeIndex<KeyT>::BTreeIndex(const std::string & relationName,
 			std::string & outIndexName,
 			BufMgr *bufMgrIn,
 			const int _attrByteOffset,
-			const Datatype attrType)
+			const Datatype attrType,
+			const IndexBuildOptions & options)
 	{
 		//sets the relation name (code copied from pp3.pdf)
 		std::ostringstream idxStr;
-		idxStr << relationName << '.' << attrByteOffset;
+		idxStr << relationName << '.' << _attrByteOffset;
 		outIndexName = idxStr.str();
 
-		//sets the information for the indexMetaInfo (first page of the index file)
-		strcpy(indexMetaInfo.relationName,relationName.c_str());
-		indexMetaInfo.attrByteOffset = attrByteOffset;
-		indexMetaInfo.attrType = attrType;
-		indexMetaInfo.isLeaf = true; //root is a leaf
+		//the key type is fixed by the template, the attribute must be stored as that type
+		if (attrType != KeyTraits<KeyT>::TYPE) {
+			throw BadIndexInfoException("Attribute type does not match the key type of the index");
+		}
 
 		//sets btree variables based on input variables
 		bufMgr = bufMgrIn;
 		attrByteOffset = _attrByteOffset;
 		attributeType = attrType;
-		rootPageNum = indexMetaInfo.rootPageNo;
+		leafOccupancy = NodeCapacity<KeyT>::LEAF;
+		compressLeaves = options.compressLeaves;
+		payloadBytes = 0;
+		relationFile = NULL;
+		nodeOccupancy = NodeCapacity<KeyT>::NONLEAF;
+		indexId = ++indexCount;
+		setSearchStrategy(SIMD_SEARCH);
+		readMode = LATCH_CRABBING;
+		setPinnedLevels(0, 0);
+		size_t numFrameSlots = 2;
+		while (numFrameSlots < 2 * (size_t) bufMgr->getNumBufs()) {
+			numFrameSlots *= 2;
+		}
+		std::vector< std::atomic<FrameId> >(numFrameSlots).swap(nodeFrames);
+
+		//opens an existing index file, which must have been built over the same attribute
+		if (File::exists(outIndexName)) {
+			file = new BlobFile(outIndexName, false);
+			headerPageNum = file->getFirstPageNo();
+			Page* headerPage;
+			bufMgr->readPage(file, headerPageNum, headerPage);
+			indexMetaInfo = *(IndexMetaInfo*) headerPage;
+			bufMgr->unPinPage(file, headerPageNum, false);
+
+			if (strncmp(indexMetaInfo.relationName, relationName.c_str(), sizeof(indexMetaInfo.relationName) - 1) != 0
+					|| indexMetaInfo.attrByteOffset != attrByteOffset
+					|| indexMetaInfo.attrType != attrType) {
+				bufMgr->flushFile(file);
+				delete file;
+				throw BadIndexInfoException("Meta page of " + outIndexName + " does not match the relation or attribute of the index");
+			}
+
+			//a leaf layout other than the default must be the one the file was built with
+			bool layoutDiffers = options.compressLeaves && !indexMetaInfo.compressLeaves;
+			if (!options.includedColumns.empty()) {
+				layoutDiffers = layoutDiffers || (int) options.includedColumns.size() != indexMetaInfo.numIncludedColumns;
+				for (size_t i = 0; !layoutDiffers && i < options.includedColumns.size(); i++) {
+					layoutDiffers = options.includedColumns[i].attrByteOffset != indexMetaInfo.includedColumns[i].attrByteOffset
+							|| options.includedColumns[i].width != indexMetaInfo.includedColumns[i].width;
+				}
+			}
+			if (layoutDiffers) {
+				bufMgr->flushFile(file);
+				delete file;
+				throw BadIndexInfoException("Meta page of " + outIndexName + " does not match the leaf layout asked for");
+			}
+			compressLeaves = indexMetaInfo.compressLeaves;
+			setIncludedColumns(relationName, indexMetaInfo.includedColumns, indexMetaInfo.numIncludedColumns);
+			rootPageNum = indexMetaInfo.rootPageNo;
+			setPinnedLevels(DEFAULT_PINNED_LEVELS, DEFAULT_PIN_MEMORY);
+			return;
+		}
+
+		//the leaves are laid out for the included columns before any is made
+		setIncludedColumns(relationName, options.includedColumns.data(), (int) options.includedColumns.size());
+
+		//sets the information for the indexMetaInfo (first page of the index file)
+		strncpy(indexMetaInfo.relationName,relationName.c_str(),sizeof(indexMetaInfo.relationName) - 1);
+		indexMetaInfo.attrByteOffset = attrByteOffset;
+		indexMetaInfo.attrType = attrType;
+		indexMetaInfo.isLeaf = true; //root is a leaf
+		indexMetaInfo.freePageNo = Page::INVALID_NUMBER;
+		indexMetaInfo.compressLeaves = compressLeaves;
+		indexMetaInfo.numIncludedColumns = (int) includedColumns.size();
+		std::copy(includedColumns.begin(), includedColumns.end(), indexMetaInfo.includedColumns);
 
-		//creates a new BlobFile using the indexName
+		//creates a new BlobFile using the indexName, its first page is the meta page
 		file = new BlobFile(outIndexName, true);
+		Page* headerPage;
+		bufMgr->allocPage(file, headerPageNum, headerPage);
+		bufMgr->unPinPage(file, headerPageNum, true);
+
+		//sorts the (key, rid) pair of every tuple and packs them into the tree from the leaves up
+		IndexBuilder<KeyT> builder(relationName, bufMgr, attrByteOffset, outIndexName, options);
+		BulkLoader loader(this, options.fillFactor);
+		builder.build(loader, buildStats);
+		loader.finish();
+		writeMetaPage();
+		setPinnedLevels(DEFAULT_PINNED_LEVELS, DEFAULT_PIN_MEMORY);
+	}
 
-		//creates a leaf node for the root of the index
-		LeafNodeInt* node = CreateLeafNode(indexMetaInfo.rootPageNo);
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::BulkLoader
+	// -----------------------------------------------------------------------------
 
-		//unPins the page that was pinned to create the leaf node
-  		bufMgr->unPinPage(file, indexMetaInfo.rootPageNo, true);
+	template <class KeyT>
+	BTreeIndex<KeyT>::BulkLoader::BulkLoader(BTreeIndex<KeyT>* indexIn, const double fillFactor)
+	{
+		index = indexIn;
+		this->fillFactor = fillFactor;
+
+		//the first leaf is the root until a second leaf is needed
+		PageId leafPageNo;
+		Page* leafPage = (Page*) index->CreateLeafNode(leafPageNo);
+		pageNos.push_back(leafPageNo);
+		pages.push_back(leafPage);
+	}
 
-		//creates a file scanner used to iterate through the record ids
-		FileScan fileScanner(relationName, bufMgr);
+	template <class KeyT>
+	void BTreeIndex<KeyT>::BulkLoader::append(const KeyT& key, const RecordId& rid)
+	{
+		LeafNodeT* leaf = (LeafNodeT*) pages[0];
+
+		// Case: the leaf being filled is at its target, start its right sibling
+		// and hand the new leaf to the level above before the full one is released
+		if (index->leafRoom(leaf, key, key, fillFactor) <= 0) {
+			PageId newPageNo;
+			LeafNodeT* newLeaf = index->CreateLeafNode(newPageNo);
+			KeyT separator = KeyTraits<KeyT>::separator(index->leafKey(leaf, leaf->numKeys-1), key);
+			leaf->rightSibPageNo = newPageNo;
+			leaf->highKey = separator;
+			newLeaf->leftSibPageNo = pageNos[0];
+			addChild(1, separator, newPageNo, (Page*) newLeaf);
+
+			index->bufMgr->unPinPage(index->file, pageNos[0], true);
+			pageNos[0] = newPageNo;
+			pages[0] = (Page*) newLeaf;
+			leaf = newLeaf;
+		}
 
-		try {
-			RecordId scanRid;
-			while (true) {
-				//gets the next record Id
-				fileScanner.scanNext(scanRid);
-				//gets the record using the record id
-				std::string recordStr = fileScanner.getRecord();
-				const char *record = recordStr.c_str();
-				//creates the key using the record and the byte offset
-				int key = *((int *)(record + attrByteOffset));
+		char payload[MAX_PAYLOAD_SIZE];
+		if (index->payloadBytes > 0) {
+			index->readPayload(rid, payload);
+		}
+		index->leafInsert(leaf, leaf->numKeys, key, rid, payload);
+	}
+
+	template <class KeyT>
+	void BTreeIndex<KeyT>::BulkLoader::addChild(const size_t level, const KeyT& key, PageId childPageNo, Page* childPage)
+	{
+		// Case: the level below just got its second node, so a new root is
+		// started above it with the node left of the child as its first child
+		if (level == pageNos.size()) {
+			PageId rootPageNo;
+			NonLeafNodeT* root = index->CreateNonLeafNode(rootPageNo);
+			root->level = level;
+			root->pageNoArray[0] = pageNos[level-1];
+			pageNos.push_back(rootPageNo);
+			pages.push_back((Page*) root);
+		}
 
-				std::cout << "INSERTING ENTRY: " << key << " ON CONTINUE";
-				//inserts the entry into the index
-				insertEntry(&key, scanRid);
+		NonLeafNodeT* node = (NonLeafNodeT*) pages[level];
+
+		// Case: the node at this level is at its target, the child becomes the
+		// first child of a new node and the key moves up to separate the two
+		if (!index->nodeHasRoom(node, &key, fillFactor)) {
+			PageId newPageNo;
+			NonLeafNodeT* newNode = index->CreateNonLeafNode(newPageNo);
+			newNode->level = node->level;
+			newNode->pageNoArray[0] = childPageNo;
+			node->rightSibPageNo = newPageNo;
+			node->highKey = key;
+			addChild(level+1, key, newPageNo, (Page*) newNode);
+
+			index->bufMgr->unPinPage(index->file, pageNos[level], true);
+			pageNos[level] = newPageNo;
+			pages[level] = (Page*) newNode;
+			return;
+		}
 
-				PrintTree(indexMetaInfo.rootPageNo, indexMetaInfo.isLeaf);
-			}
-		} catch (EndOfFileException e) {
-			bufMgrIn = bufMgr;
-			//LeafNodeInt* leaf = findLeafNode(1,indexMetaInfo.rootPageNo);
+		// Case: room left, the child is appended after the last key
+		index->nodeInsert(node, node->numKeys, key, childPageNo);
+	}
+
+	template <class KeyT>
+	void BTreeIndex<KeyT>::BulkLoader::finish()
+	{
+		// the rightmost node of every level is still pinned
+		for (size_t level = 0; level < pageNos.size(); level++) {
+			index->bufMgr->unPinPage(index->file, pageNos[level], true);
 		}
 
+		index->indexMetaInfo.rootPageNo = pageNos.back();
+		index->indexMetaInfo.isLeaf = (pageNos.size() == 1);
+		index->rootPageNum = pageNos.back();
 	}
 
 
@@ -104,130 +266,418 @@ namespace badgerdb
 	// BTreeIndex::~BTreeIndex -- destructor
 	// -----------------------------------------------------------------------------
 
-	BTreeIndex::~BTreeIndex()
+	template <class KeyT>
+	BTreeIndex<KeyT>::~BTreeIndex()
 	{
-		//ends any ongoing scans and flushes the file
-		if (scanExecuting) endScan();
+		//frees the cursors of the scans through startScan, saves the free list and flushes the file
+		for (size_t i = 0; i < threadScans.size(); i++) {
+			delete threadScans[i].second;
+		}
+		for (size_t i = 0; i < freeCursors.size(); i++) {
+			delete freeCursors[i];
+		}
+		unpinLevels();
+		writeMetaPage();
 		bufMgr->flushFile(file);
 		delete file;
+		if (relationFile != NULL) {
+			bufMgr->flushFile(relationFile);
+			delete relationFile;
+		}
 	}
 
 	// -----------------------------------------------------------------------------
 	// BTreeIndex::insertEntry
 	// -----------------------------------------------------------------------------
 
-	const void BTreeIndex::insertEntry(const void *key, const RecordId rid)
+	template <class KeyT>
+	const void BTreeIndex<KeyT>::insertEntry(const void *key, const RecordId rid)
 	{
-		// Begin searching for the place to insert at the root
-		Page* page;
-		bufMgr->readPage(file,indexMetaInfo.rootPageNo,page);
-
-		int keyInt = *(int*)key;
-
-		RecordId currRid = rid;
-
-		// Case: the root is a leaf (B+ tree has one node)
-		if(indexMetaInfo.isLeaf == true){
-			// In this case, we can safely cast the root page to a LeafNodeInt
-			LeafNodeInt* root = (LeafNodeInt*) page;
-			// This is a strange place to set the root's parent pointer but it works
-			root->parent = -1;
-			// std::cout << "KeyInt: " << keyInt << std::endl;
-			// std::cout << "rid: " << rid.page_number << "-" << rid.slot_number << std::endl;
-			// std::cout << "root->keyArray: " << root->keyArray << std::endl;
-			// std::cout << "root->numKeys: " << root->numKeys << std::endl;
-			// std::cout << "root->ridArray: " << root->ridArray << std::endl;
-			// Case: The root node is full during the insert
-			// perform leaf node split
-			if(root->numKeys == INTARRAYLEAFSIZE){
-				splitLeafNode(keyInt,rid, indexMetaInfo.rootPageNo);
-				indexMetaInfo.isLeaf = false;
-			}
-			else if (root->numKeys == 0) {
-				root->keyArray[0] = keyInt;
-				root->ridArray[0] = rid;
-				root->numKeys = 1;
-			}
-			// Case: root has space to insert
-			// bubble insert the key and rid into their places
-			else{
-				for(int i = 0; i < root->numKeys; i ++){
-					if(keyInt < root->keyArray[i]){
-						int key_temp = root->keyArray[i];
-						RecordId rid_temp = root->ridArray[i];
-
-						root->keyArray[i] = keyInt;
-						root->ridArray[i] = rid;
-
-						keyInt = key_temp;
-						currRid = rid_temp;
-					}
-				}
-				// after loop, insert i = root.numKeys, and
-				// key and rid need to be inserted at the end
-				root->keyArray[root->numKeys] = keyInt;
-				root->ridArray[root->numKeys] = currRid;
-				// also, numKeys gets a new friend :)
-				root->numKeys++;
+		KeyT keyVal = KeyTraits<KeyT>::read(key);
+		char payload[MAX_PAYLOAD_SIZE];
+		if (payloadBytes > 0) {
+			readPayload(rid, payload);
+		}
+		if (readMode == B_LINK) {
+			insertBlink(keyVal, rid, payload);
+			return;
+		}
+
+		// most inserts fit in their leaf, so only the leaf is latched exclusive
+		PageId leafPageNo;
+		LeafNodeT* node = findLeafNode(keyVal, leafPageNo, true, NULL);
+
+		// Case: leaf node has space
+		if(leafRoom(node, keyVal, keyVal) > 0){
+			insertIntoLeaf(node, keyVal, rid, payload);
+			bufMgr->pageLatch((Page*) node).unlock();
+			bufMgr->unPinPage(file,leafPageNo,true);
+			return;
+		}
+
+		// Case: leaf node is full
+		// start over from the root holding every node the split may reach
+		bufMgr->pageLatch((Page*) node).unlock();
+		bufMgr->unPinPage(file,leafPageNo,false);
+		insertPessimistic(keyVal, rid, payload);
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::insertBatch
+	// -----------------------------------------------------------------------------
+
+	template <class KeyT>
+	const void BTreeIndex<KeyT>::insertBatch(const std::vector< RIDKeyPair<KeyT> >& entries)
+	{
+		// equal keys keep the order they were given in, as with single inserts
+		std::vector< RIDKeyPair<KeyT> > sorted(entries);
+		std::stable_sort(sorted.begin(), sorted.end(), keyLess<KeyT>);
+		std::vector<char> payloads(sorted.size() * payloadBytes);
+		for (size_t i = 0; payloadBytes > 0 && i < sorted.size(); i++) {
+			readPayload(sorted[i].rid, &payloads[i * payloadBytes]);
+		}
+
+		size_t next = 0;
+		while (next < sorted.size()) {
+			PageId leafPageNo;
+			LeafNodeT* leaf;
+			if (readMode == B_LINK) {
+				leaf = (LeafNodeT*) descendBlink(sorted[next].key, 0, leafPageNo, true, NULL);
+			} else {
+				leaf = findLeafNode(sorted[next].key, leafPageNo, true, NULL);
+			}
+
+			// the entries up to the high key belong in this leaf, as many as fit
+			bool hasRight = (leaf->rightSibPageNo != Page::INVALID_NUMBER);
+			size_t last = next;
+			while (last < sorted.size() && (int) (last - next) < leafRoom(leaf, sorted[next].key, sorted[last].key)
+					&& !(hasRight && leaf->highKey < sorted[last].key)) {
+				last++;
 			}
-			//cause errors--taking out
-			try {
-				bufMgr->unPinPage(file,indexMetaInfo.rootPageNo,true);
+			if (last > next) {
+				mergeIntoLeaf(leaf, sorted, payloads.data(), next, last);
 			}
-			catch (PageNotPinnedException e) {
+			bufMgr->pageLatch((Page*) leaf).unlock();
+			bufMgr->unPinPage(file,leafPageNo,last > next);
 
+			// Case: leaf node is full
+			// split it with the first entry left, the rest follow into the halves
+			if (last == next) {
+				const char* payload = payloads.data() + next * payloadBytes;
+				if (readMode == B_LINK) {
+					insertBlink(sorted[next].key, sorted[next].rid, payload);
+				} else {
+					insertPessimistic(sorted[next].key, sorted[next].rid, payload);
+				}
+				last++;
 			}
+			next = last;
 		}
-		// Case: the root is not a leaf (i.e. tree level > 1)
-		else{
-			// keep track of root node
-			//NonLeafNodeInt* root = (NonLeafNodeInt*) &page;
-			// returns the leaf node where the data goes
-			LeafNodeInt* node = findLeafNode(keyInt, indexMetaInfo.rootPageNo);
+	}
 
-			Page* nodePage = (Page *) node;
+	//--------------------------------------------------------------------
+	// @brief	insertPessimistic inserts an entry whose leaf may have to
+	// 		split, latching exclusive from the root down and keeping
+	// 		every node that could split along with the first one above
+	// 		them that cannot
+	//--------------------------------------------------------------------
+	template <class KeyT>
+	void BTreeIndex<KeyT>::insertPessimistic(const KeyT& key, const RecordId rid, const char* payload){
+		std::vector<PageId> heldPageNos;
+		std::vector<Page*> heldPages;
+
+		// the root may split, which changes indexMetaInfo.rootPageNo
+		rootLatch.lock(true);
+		bool rootLatched = true;
+		PageId pageNo = indexMetaInfo.rootPageNo;
+		bool isLeaf = indexMetaInfo.isLeaf;
+
+		while (true) {
+			Page* page;
+			if (isLeaf) {
+				bufMgr->readPage(file,pageNo,page);
+			} else {
+				readNonLeaf(pageNo, page);
+			}
+			bufMgr->pageLatch(page).lock(true);
+
+			// a node with a free slot absorbs any split below it, so
+			// nothing above it can change and its ancestors are released
+			bool safe = isLeaf ? leafRoom((LeafNodeT*) page, key, key) > 0 : nodeHasRoom((NonLeafNodeT*) page, NULL);
+			if (safe) {
+				for (size_t i = 0; i < heldPages.size(); i++) {
+					bufMgr->pageLatch(heldPages[i]).unlock();
+					bufMgr->unPinFrame(heldPages[i],false);
+				}
+				heldPages.clear();
+				heldPageNos.clear();
+				if (rootLatched) {
+					rootLatch.unlock();
+					rootLatched = false;
+				}
+			}
+			heldPageNos.push_back(pageNo);
+			heldPages.push_back(page);
+			if (isLeaf) break;
+
+			NonLeafNodeT* node = (NonLeafNodeT*) page;
+			int i = nodeLowerBound(node, node->numKeys, key);
+			isLeaf = (node->level == 1);
+			pageNo = node->pageNoArray[i];
+		}
 
-			// Case: leaf node is full
-			// perform leaf node split
-			if(node->numKeys == INTARRAYLEAFSIZE){
-				splitLeafNode(keyInt,rid,foundLeafPageNo);
-			}
-			else if (node->numKeys == 0) {
-				node->keyArray[0] = keyInt;
-				node->ridArray[0] = rid;
-				node->numKeys = 1;
-			}
-			// Case: leaf node has space
-			// perform bubble insert of key and rid
-			else{
-				for(int i = 0; i < node->numKeys; i ++){
-					if(keyInt < node->keyArray[i]){
-						int key_temp = node->keyArray[i];
-						RecordId rid_temp = node->ridArray[i];
-
-						node->keyArray[i] = keyInt;
-						node->ridArray[i] = currRid;
-
-						keyInt = key_temp;
-						currRid = rid_temp;
-					}
+		// another insert may have split the leaf since the optimistic attempt,
+		// otherwise the split only reaches nodes held here, which are its path up
+		LeafNodeT* leaf = (LeafNodeT*) heldPages.back();
+		if (leafRoom(leaf, key, key) > 0) {
+			insertIntoLeaf(leaf, key, rid, payload);
+		} else {
+			std::vector<PageId> path(heldPageNos.begin(), heldPageNos.end() - 1);
+			splitLeafNode(key, rid, payload, heldPageNos.back(), path);
+		}
+
+		for (size_t i = 0; i < heldPages.size(); i++) {
+			bufMgr->pageLatch(heldPages[i]).unlock();
+			bufMgr->unPinFrame(heldPages[i],true);
+		}
+		if (rootLatched) {
+			rootLatch.unlock();
+		}
+	}
+
+	//--------------------------------------------------------------------
+	// @brief	insertBlink inserts an entry in B_LINK mode. A full leaf is
+	// 		split while only it is latched, then the separator goes to
+	// 		the parent, latched while still holding the child and found
+	// 		by moving right from the parent seen on the way down
+	//--------------------------------------------------------------------
+	template <class KeyT>
+	void BTreeIndex<KeyT>::insertBlink(const KeyT& key, const RecordId rid, const char* payload){
+		std::vector<PageId> path;
+		PageId pageNo;
+		LeafNodeT* leaf = (LeafNodeT*) descendBlink(key, 0, pageNo, true, &path);
+
+		// Case: leaf node has space
+		if (leafRoom(leaf, key, key) > 0) {
+			insertIntoLeaf(leaf, key, rid, payload);
+			bufMgr->pageLatch((Page*) leaf).unlock();
+			bufMgr->unPinPage(file,pageNo,true);
+			return;
+		}
+
+		// Case: leaf node is full
+		// the new leaf can be reached through the right link as soon as the
+		// old one is released, so the parent may take its time to learn of it
+		PageId newPageNo;
+		LeafNodeT* newLeaf;
+		KeyT separator = splitLeafContents(pageNo, leaf, key, rid, payload, newPageNo, newLeaf);
+		bufMgr->unPinPage(file,newPageNo,true);
+		Page* page = (Page*) leaf;
+		int level = 0;
+
+		// post the separator one level up at a time, holding the node that
+		// split until the node above it is latched
+		while (true) {
+			PageId parentPageNo;
+			if (!path.empty()) {
+				parentPageNo = path.back();
+				path.pop_back();
+			} else {
+				// Case: the node that split is the root
+				rootLatch.lock(true);
+				if (indexMetaInfo.rootPageNo == pageNo) {
+					growRoot(pageNo, separator, newPageNo, level + 1);
+					rootLatch.unlock();
+					bufMgr->pageLatch(page).unlock();
+					bufMgr->unPinPage(file,pageNo,true);
+					return;
 				}
-				// after insert, i = numKeys + 1 and key and rid need insertion
-				node->keyArray[node->numKeys] = keyInt;
-				node->ridArray[node->numKeys] = currRid;
-				// numKeys makes a new friend
-				node->numKeys++;
+				rootLatch.unlock();
+
+				// Case: the root split since this insert went down, so the level
+				// above has no node on the path yet
+				Page* parentPage = descendBlink(separator, level + 1, parentPageNo, false, NULL);
+				bufMgr->pageLatch(parentPage).unlock();
+				bufMgr->unPinPage(file,parentPageNo,false);
+			}
+
+			// the node may have moved right of the parent seen on the way down
+			Page* parentPage;
+			bufMgr->readPage(file,parentPageNo,parentPage);
+			bufMgr->pageLatch(parentPage).lock(true);
+			NonLeafNodeT* parent = (NonLeafNodeT*) parentPage;
+			int pos = childIndex(parent, pageNo);
+			while (parent->pageNoArray[pos] != pageNo) {
+				PageId rightPageNo = parent->rightSibPageNo;
+				Page* rightPage;
+				bufMgr->readPage(file,rightPageNo,rightPage);
+				bufMgr->pageLatch(rightPage).lock(true);
+				bufMgr->pageLatch(parentPage).unlock();
+				bufMgr->unPinPage(file,parentPageNo,false);
+				parentPageNo = rightPageNo;
+				parentPage = rightPage;
+				parent = (NonLeafNodeT*) parentPage;
+				pos = childIndex(parent, pageNo);
+			}
+
+			// nothing below the parent changes any more
+			bufMgr->pageLatch(page).unlock();
+			bufMgr->unPinPage(file,pageNo,true);
+
+			// Case: parent has space for the separator, right after the node that split
+			if (nodeHasRoom(parent, &separator)) {
+				nodeInsert(parent, pos, separator, newPageNo);
+				bufMgr->pageLatch(parentPage).unlock();
+				bufMgr->unPinPage(file,parentPageNo,true);
+				return;
+			}
+
+			// Case: parent is full and splits in turn
+			PageId newParentPageNo;
+			NonLeafNodeT* newParent;
+			separator = splitNonLeafContents(parent, pos, separator, newPageNo, newParentPageNo, newParent);
+			bufMgr->unPinPage(file,newParentPageNo,true);
+			newPageNo = newParentPageNo;
+			pageNo = parentPageNo;
+			page = parentPage;
+			level++;
+		}
+	}
+
+	//--------------------------------------------------------------------
+	// @brief	descendBlink finds the node at the given level that fits
+	// 		key, latching one node at a time and moving right past
+	// 		nodes that split since their parent was read
+	// level:	0 for a leaf, the node level otherwise
+	// pageNo:	the page number of the node is returned in this
+	// exclusive:	latch the node found exclusive instead of shared
+	// path:	if not NULL, the non-leaf nodes passed on the way down
+	// 		are appended to it
+	// returns:	the node, pinned and latched
+	//--------------------------------------------------------------------
+	template <class KeyT>
+	Page* BTreeIndex<KeyT>::descendBlink(const KeyT& key, const int level, PageId& pageNo, const bool exclusive, std::vector<PageId>* path){
+		// a root read here that splits before it is latched still covers
+		// key through its right links
+		rootLatch.lock(false);
+		pageNo = indexMetaInfo.rootPageNo;
+		bool isLeaf = indexMetaInfo.isLeaf;
+		rootLatch.unlock();
 
-				bufMgr->unPinPage(file,foundLeafPageNo,true);
+		Page* page;
+		bool pinned = readNode(pageNo, page, isLeaf);
+		int nodeLevel = isLeaf ? 0 : ((NonLeafNodeT*) page)->level;
+		bufMgr->pageLatch(page).lock(exclusive && nodeLevel == level);
+
+		while (true) {
+			page = moveRightBlink(key, pageNo, page, nodeLevel == 0, exclusive && nodeLevel == level, pinned);
+			if (nodeLevel == level) {
+				// the caller unpins the node it gets back
+				if (pinned) {
+					bufMgr->readPage(file,pageNo,page);
+				}
+				return page;
 			}
-			try {
-				bufMgr->unPinPage(file,indexMetaInfo.rootPageNo,true);
+
+			NonLeafNodeT* node = (NonLeafNodeT*) page;
+			if (path != NULL) {
+				path->push_back(pageNo);
 			}
-			catch (PageNotPinnedException e) {
+			int i = nodeLowerBound(node, node->numKeys, key);
+			PageId childPageNo = node->pageNoArray[i];
+
+			// the parent is released before the child is latched, a split of
+			// the child in between is caught by moving right
+			bufMgr->pageLatch(page).unlock();
+			releaseNode(page, pinned);
+			nodeLevel--;
+			pageNo = childPageNo;
+			pinned = readNode(pageNo, page, nodeLevel == 0);
+			bufMgr->pageLatch(page).lock(exclusive && nodeLevel == level);
+		}
+	}
 
+	//--------------------------------------------------------------------
+	// @brief	moveRightBlink follows right links from a latched node
+	// 		until reaching the one whose high key covers key, latching
+	// 		each before releasing the one left of it
+	//--------------------------------------------------------------------
+	template <class KeyT>
+	Page* BTreeIndex<KeyT>::moveRightBlink(const KeyT& key, PageId& pageNo, Page* page, const bool isLeaf, const bool exclusive, bool& pinned){
+		while (true) {
+			PageId rightPageNo;
+			bool covered;
+			if (isLeaf) {
+				LeafNodeT* node = (LeafNodeT*) page;
+				rightPageNo = node->rightSibPageNo;
+				covered = (rightPageNo == Page::INVALID_NUMBER || !(node->highKey < key));
+			} else {
+				NonLeafNodeT* node = (NonLeafNodeT*) page;
+				rightPageNo = node->rightSibPageNo;
+				covered = (rightPageNo == Page::INVALID_NUMBER || !(node->highKey < key));
 			}
+			if (covered) {
+				return page;
+			}
+
+			Page* rightPage;
+			bool rightPinned = readNode(rightPageNo, rightPage, isLeaf);
+			bufMgr->pageLatch(rightPage).lock(exclusive);
+			bufMgr->pageLatch(page).unlock();
+			releaseNode(page, pinned);
+			pageNo = rightPageNo;
+			page = rightPage;
+			pinned = rightPinned;
+		}
+	}
 
+	//--------------------------------------------------------------------
+	// @brief	insertIntoLeaf places a key and rid into a leaf that
+	// 		still has room, keeping its keys sorted
+	// node:	the pinned leaf receiving the entry
+	// payload:	the included columns of the entry
+	//--------------------------------------------------------------------
+	template <class KeyT>
+	void BTreeIndex<KeyT>::insertIntoLeaf(LeafNodeT* node, const KeyT& key, const RecordId rid, const char* payload){
+		// duplicates go after the keys already present
+		int pos = leafUpperBound(node, node->numKeys, key);
+		leafInsert(node, pos, key, rid, payload);
+	}
+
+	//--------------------------------------------------------------------
+	// @brief	mergeIntoLeaf places a sorted run of entries into a leaf
+	// 		that has room for all of them, moving every old entry at
+	// 		most once. Duplicates go after the keys already present
+	// node:	the pinned leaf receiving the entries
+	// payloads:	the included columns of every entry, in the same order
+	// first, last:	the run of entries to place
+	//--------------------------------------------------------------------
+	template <class KeyT>
+	void BTreeIndex<KeyT>::mergeIntoLeaf(LeafNodeT* node, const std::vector< RIDKeyPair<KeyT> >& entries, const char* payloads, size_t first, size_t last){
+		KeyT keys[NodeCapacity<KeyT>::LEAF_MAX];
+		RecordId rids[NodeCapacity<KeyT>::LEAF_MAX];
+		char leafPayload[LEAF_PAYLOAD_BYTES];
+		leafEntries(node, keys, rids, leafPayload);
+
+		// fill from the back, so nothing is overwritten before it has moved. Each
+		// new entry shifts the old ones above it in a single move per array
+		int oldEnd = node->numKeys;
+		int pos = node->numKeys + (int) (last - first);
+		for (size_t i = last; i > first; i--) {
+			const RIDKeyPair<KeyT>& entry = entries[i - 1];
+			int oldPos = upperBound(keys, oldEnd, entry.key);
+			int numToShift = oldEnd - oldPos;
+			pos -= numToShift;
+			memmove(&keys[pos], &keys[oldPos], numToShift * sizeof(KeyT));
+			memmove(&rids[pos], &rids[oldPos], numToShift * sizeof(RecordId));
+			memmove(&leafPayload[pos * payloadBytes], &leafPayload[oldPos * payloadBytes], numToShift * payloadBytes);
+			pos--;
+			keys[pos] = entry.key;
+			rids[pos] = entry.rid;
+			memcpy(&leafPayload[pos * payloadBytes], &payloads[(i - 1) * payloadBytes], payloadBytes);
+			oldEnd = oldPos;
 		}
+		leafFill(node, keys, rids, leafPayload, node->numKeys + (int) (last - first));
 	}
 
 	// -------------------------------------------------------------
@@ -235,562 +685,2716 @@ namespace badgerdb
 	// 	  when an insertion is performed on a full node
 	// key:		the key being inserted
 	// rid:		the rid being inserted
+	// payload:	the included columns of the entry being inserted
 	// pageNo:	the pointer to the node being split
+	// path:	the non-leaf nodes the split may reach, from the top
+	// 		down to the parent of the node, empty if it is the root
 	// returns:	void
 	// -------------------------------------------------------------
-	const void BTreeIndex::splitLeafNode(int key, const RecordId rid,  PageId pageNo){
+	template <class KeyT>
+	const void BTreeIndex<KeyT>::splitLeafNode(const KeyT& key, const RecordId rid, const char* payload, PageId pageNo, std::vector<PageId>& path){
 		// cast node being split into a leaf node struct
 		Page* bufMgrPage;
 		bufMgr->readPage(file,pageNo,bufMgrPage);
-		Page* page = bufMgrPage;//&file->readPage(pageNo);
-		LeafNodeInt* node = (LeafNodeInt*) page;
+		LeafNodeT* oldNode = (LeafNodeT*) bufMgrPage;
 
-		int keyInt = key;
-		RecordId currRid = rid;
+		PageId newPageNo;
+		LeafNodeT* newNode;
+		KeyT separator = splitLeafContents(pageNo, oldNode, key, rid, payload, newPageNo, newNode);
+		bufMgr->unPinPage(file,pageNo,true);
+		bufMgr->unPinPage(file,newPageNo,true);
 
-		// initialize temporary arrays for key and rid storage
-		// size = num of records in full array + 1 being added
-		int arr1[INTARRAYLEAFSIZE+1];
-		RecordId arr2[INTARRAYLEAFSIZE+1];
-		// following code block inserts everything into arr1[] and arr2[]
-		int offset = 0;
-		for(int i = 0; i < node->numKeys; i++){
-			if(keyInt < node->keyArray[i] && offset == 0){
-				arr1[i] = keyInt;
-				arr2[i] = currRid;
-				offset = 1;
-				i--;
-			}
-			else{
-				arr1[i+offset] = node->keyArray[i];
-				arr2[i+offset] = node->ridArray[i];
-			}
+		// Case: oldNode was the root (and also a leaf)
+		if (path.empty()) {
+			growRoot(pageNo, separator, newPageNo, 1);
 		}
-		//key and rid were never entered!
-		if (offset == 0) {
-			arr1[node->numKeys] = keyInt;
-			arr2[node->numKeys] = currRid;
+		// Case: oldNode was NOT the root
+		else{
+			insertIntoNonLeaf(separator, path, pageNo, newPageNo);
 		}
+	}
+
+	//--------------------------------------------------------------------
+	// @brief	splitLeafContents moves the upper half of a full pinned
+	// 		leaf, with the new entry in place, to a new right sibling,
+	// 		linking it in and passing on the high key
+	// newPageNo, newNode:	the new leaf is returned in these, still
+	// 		pinned
+	// returns:	the separator between the two halves
+	//--------------------------------------------------------------------
+	template <class KeyT>
+	KeyT BTreeIndex<KeyT>::splitLeafContents(PageId pageNo, LeafNodeT* node, const KeyT& key, const RecordId rid, const char* payload,
+			PageId& newPageNo, LeafNodeT*& newNode){
+		// initialize temporary arrays for key, rid and payload storage
+		// size = num of records in full array + 1 being added
+		KeyT arr1[NodeCapacity<KeyT>::LEAF_MAX+1];
+		RecordId arr2[NodeCapacity<KeyT>::LEAF_MAX+1];
+		char arr3[LEAF_PAYLOAD_BYTES];
+		// copy everything into arr1[], arr2[] and arr3[] with the new entry at its place
+		leafEntries(node, arr1, arr2, arr3);
+		int pos = upperBound(arr1, node->numKeys, key);
+		int numAfter = node->numKeys - pos;
+		memmove(&arr1[pos+1], &arr1[pos], numAfter * sizeof(KeyT));
+		memmove(&arr2[pos+1], &arr2[pos], numAfter * sizeof(RecordId));
+		memmove(&arr3[(pos+1) * payloadBytes], &arr3[pos * payloadBytes], numAfter * payloadBytes);
+		arr1[pos] = key;
+		arr2[pos] = rid;
+		memcpy(&arr3[pos * payloadBytes], payload, payloadBytes);
+		int totalKeys = node->numKeys + 1;
 
 		// splitIndex is the index of the median key, and it points to
 		// the first element in the new node
-		int splitIndex = (node->numKeys + 1) / 2;
+		int splitIndex = totalKeys / 2;
+
+		// a run of duplicates across the middle goes whole to one side when both
+		// halves stay at least half full, so long runs end up in leaves of their own
+		if (arr1[splitIndex-1] == arr1[splitIndex]) {
+			int runBegin = lowerBound(arr1, splitIndex, arr1[splitIndex]);
+			int runEnd = upperBound(arr1, totalKeys, arr1[splitIndex]);
+			int candidates[2] = { runBegin, runEnd };
+			if (runEnd - splitIndex < splitIndex - runBegin) std::swap(candidates[0], candidates[1]);
+			for (int c = 0; c < 2; c++) {
+				int at = candidates[c];
+				if (at >= leafOccupancy / 2 && totalKeys - at >= leafOccupancy / 2
+						&& leafFits(arr1, at) && leafFits(&arr1[at], totalKeys - at)) {
+					splitIndex = at;
+					break;
+				}
+			}
+		}
 
 		// create the new node, a sibling page to the right of "node"
-		PageId newPageNo;
-		LeafNodeInt* newNode = CreateLeafNode(newPageNo);
-		//std::cout << "hello" << std::endl;
-		//unpin page ASAP
-		// TODO: WHEN TO UNPIN PAGES ----- bufMgr->unPinPage(file, newPageNo, true);
-
-		LeafNodeInt* oldNode = node;
+		newNode = CreateLeafNode(newPageNo);
+		LeafNodeT* oldNode = node;
 
-		// set numKeys of each node to proper value
-		int numKeysNewNode = (INTARRAYLEAFSIZE + 1) - splitIndex;
-		newNode->numKeys = numKeysNewNode;
-		oldNode->numKeys = splitIndex;
+		// refill the old node and fill the new one. Split at the median, neither
+		// half holds more than about half of LEAF_MAX entries, which fit at any
+		// widths, and a split at the end of a run was checked to fit
+		leafFill(oldNode, arr1, arr2, arr3, splitIndex);
+		leafFill(newNode, &arr1[splitIndex], &arr2[splitIndex], &arr3[splitIndex * payloadBytes], totalKeys - splitIndex);
 
-		// fill entries of newNode arrays
-		for (int i = 0; i < numKeysNewNode; i++){
-			newNode->keyArray[i] = arr1[splitIndex + i];
-			newNode->ridArray[i] = arr2[splitIndex + i];
-		}
+		// the shortest key between the two halves separates them
+		KeyT separator = KeyTraits<KeyT>::separator(arr1[splitIndex-1], arr1[splitIndex]);
 
 		// update sibling pointers
-		// newNode goes to the right of oldNode
+		// newNode goes to the right of oldNode and takes over its high key
 		newNode->rightSibPageNo = oldNode->rightSibPageNo;
+		newNode->highKey = oldNode->highKey;
+		newNode->leftSibPageNo = pageNo;
 		oldNode->rightSibPageNo = newPageNo;
-		// give newNode a parent
-		newNode->parent = oldNode->parent;
-
-		// At this point, we have two leaf nodes
-		// the split index needs to be inserted into the parent
-		//
-		// Case: oldNode was the root (and also a leaf)
-		if (oldNode->parent == -1) {
-			// create a new NonLeafNode
-			PageId newRootPageNo;
-			NonLeafNodeInt* newRoot = CreateNonLeafNode(newRootPageNo);
-			// set the info that makes it a root
-			newRoot->parent = -1;
-			newRoot->level = 1;
-			//std::cout << "Printing newRootPageNo: " << newRootPageNo << std::endl;
-			indexMetaInfo.rootPageNo = newRootPageNo;
-			// set each child's parent field
-			newNode->parent = newRootPageNo;
-			oldNode->parent = newRootPageNo;
-
-			// insert new key and children pageNo's
-			newRoot->keyArray[0] = arr1[splitIndex];
-			newRoot->numKeys = 1;
-			newRoot->pageNoArray[0] = pageNo;
-			newRoot->pageNoArray[1] = newPageNo;
-
-			bufMgr->unPinPage(file,pageNo,true);
+		oldNode->highKey = separator;
+
+		// the old right sibling now has newNode on its left. It is latched after
+		// oldNode, in the left to right order every other thread latches leaves in
+		if (newNode->rightSibPageNo != Page::INVALID_NUMBER) {
+			Page* rightPage;
+			bufMgr->readPage(file,newNode->rightSibPageNo,rightPage);
+			bufMgr->pageLatch(rightPage).lock(true);
+			((LeafNodeT*) rightPage)->leftSibPageNo = newPageNo;
+			bufMgr->pageLatch(rightPage).unlock();
+			bufMgr->unPinPage(file,newNode->rightSibPageNo,true);
+		}
 
-			bufMgr->unPinPage(file,newPageNo,true);
+		return separator;
+	}
 
-			bufMgr->unPinPage(file,newRootPageNo,true);
+	//--------------------------------------------------------------------
+	// @brief	growRoot puts a new root above the old one and the node
+	// 		split off it
+	// level:	the level of the new root
+	//--------------------------------------------------------------------
+	template <class KeyT>
+	void BTreeIndex<KeyT>::growRoot(PageId leftPageNo, const KeyT& key, PageId rightPageNo, int level){
+		// create a new NonLeafNode
+		PageId newRootPageNo;
+		NonLeafNodeT* newRoot = CreateNonLeafNode(newRootPageNo);
+		newRoot->level = level;
+
+		// insert new key and children pageNo's
+		newRoot->pageNoArray[0] = leftPageNo;
+		nodeInsert(newRoot, 0, key, rightPageNo);
+		bufMgr->unPinPage(file,newRootPageNo,true);
+
+		// set the info that makes it a root
+		indexMetaInfo.rootPageNo = newRootPageNo;
+		indexMetaInfo.isLeaf = false;
+		rootPageNum = newRootPageNo;
+		writeMetaPage();
+
+		// the new root joins the pinned levels above the old one
+		if (pinnedLevels > 0 && pinNode(newRootPageNo) && level < lowestPinnedLevel) {
+			lowestPinnedLevel = level;
 		}
-		// Case: oldNode was NOT the root
-		else{
-			// call out parent
-			PageId parentPageId = oldNode->parent;
-			Page* bufMgrPage;
-			bufMgr->readPage(file,parentPageId,bufMgrPage);
-			NonLeafNodeInt* parent = (NonLeafNodeInt*)bufMgrPage;//&file->readPage(parentPageId);
-			// Case: parent has space for new key
-			if (parent->numKeys < INTARRAYNONLEAFSIZE) {
-				// create variable for PageNo
-				//PageId* newPageNo = (PageId*) newNode;
-				// perform a bubble insert of the key
-				PageId tempNewPageNo = newPageNo;
-
-				for (int i = 0; i < parent->numKeys; i++){
-
-					if (keyInt < parent->keyArray[i]) {
-						int key_temp = parent->keyArray[i];
-						PageId page_temp = parent->pageNoArray[i];
-
-						parent->keyArray[i] = keyInt;
-						parent->pageNoArray[i] = tempNewPageNo;
-
-						keyInt = key_temp;
-						tempNewPageNo = page_temp;
-					}
-
-				}
-				parent->keyArray[parent->numKeys] = keyInt;
-				PageId lostPage = parent->pageNoArray[parent->numKeys];
+	}
 
-				parent->pageNoArray[parent->numKeys] = tempNewPageNo;
+	//--------------------------------------------------------------------
+	// @brief	insertIntoNonLeaf adds a separator key and the page to its
+	// 		right into a non-leaf node, splitting it if it is full
+	// key:		the separator pushed up from the split child
+	// path:	the non-leaf nodes down to the one receiving the
+	// 		separator, which is taken off the end
+	// leftPageNo:	the child that split, which the separator goes after
+	// rightPageNo:	the new page created by the split of the child
+	//--------------------------------------------------------------------
+	template <class KeyT>
+	const void BTreeIndex<KeyT>::insertIntoNonLeaf(const KeyT& key, std::vector<PageId>& path, PageId leftPageNo, PageId rightPageNo){
+		PageId pageNo = path.back();
+		Page* bufMgrPage;
+		bufMgr->readPage(file,pageNo,bufMgrPage);
+		NonLeafNodeT* parent = (NonLeafNodeT*) bufMgrPage;
 
-				// PageId page_temp = parent->pageNoArray[parent->numKeys];
-				// parent->pageNoArray[parent->numKeys] = newPageNo;
-				parent->pageNoArray[parent->numKeys+1] = lostPage;
-				parent->numKeys++;
-				parent->level = 1;
+		// Case: parent doesn't have space for new key
+		if (!nodeHasRoom(parent, &key)) {
+			bufMgr->unPinPage(file,pageNo,false);
+			splitNonLeafNode(key,path,leftPageNo,rightPageNo);
+			return;
+		}
 
-				bufMgr->unPinPage(file,pageNo,true);
+		// Case: parent has space for new key
+		// the separator goes right after the child that split, with the
+		// new page as the child to its right; searching by key could land
+		// among equal separators on the wrong side of the child
+		int pos = childIndex(parent, leftPageNo);
+		nodeInsert(parent, pos, key, rightPageNo);
 
-				bufMgr->unPinPage(file,newPageNo,true);
+		bufMgr->unPinPage(file,pageNo,true);
+	}
 
-				bufMgr->unPinPage(file,parentPageId,true);
-			}
-			// Case: parent doesn't have space for new key
-			else{
-				int parentKey = arr1[splitIndex];//&parent->keyArray[splitIndex];
-				splitNonLeafNode(parentKey,parentPageId, newPageNo);
+	//--------------------------------------------------------------------
+	// @brief	splitNonLeafNode is used for splitting a node
+	// 		that is not a leaf node. Revolutionary!
+	// key:		the key that causes overflow
+	// path:	the non-leaf nodes down to the full one being split,
+	// 		which is taken off the end
+	// leftPageNo:	the child that split one level down, left of key
+	// previousNewPageNo:	the page to the right of key, created by the
+	// 		split one level down
+	//--------------------------------------------------------------------
+	template <class KeyT>
+	const void BTreeIndex<KeyT>::splitNonLeafNode(const KeyT& key, std::vector<PageId>& path, PageId leftPageNo, PageId previousNewPageNo) {
+		PageId pageNo = path.back();
+		path.pop_back();
 
-				bufMgr->unPinPage(file,pageNo,true);
+		// cast node being split into a non-leaf node struct
+		Page* bufMgrPage;
+		bufMgr->readPage(file,pageNo,bufMgrPage);
+		NonLeafNodeT* oldNode = (NonLeafNodeT*) bufMgrPage;
 
-				bufMgr->unPinPage(file,newPageNo,true);
+		// the new page always sits immediately to the right of the new key
+		int pos = childIndex(oldNode, leftPageNo);
+		PageId newPageNo;
+		NonLeafNodeT* newNode;
+		KeyT pushUpKey = splitNonLeafContents(oldNode, pos, key, previousNewPageNo, newPageNo, newNode);
+		int level = oldNode->level;
 
-				bufMgr->unPinPage(file,parentPageId,true);
-			}
+		bufMgr->unPinPage(file,pageNo,true);
+		bufMgr->unPinPage(file,newPageNo,true);
 
+		// Case: oldNode was the root (and also not a leaf)
+		if (path.empty()) {
+			growRoot(pageNo, pushUpKey, newPageNo, level + 1);
+		}
+		// Case: oldNode was NOT the root
+		else {
+			insertIntoNonLeaf(pushUpKey, path, pageNo, newPageNo);
 		}
 	}
 
 	//--------------------------------------------------------------------
-	// @brief	splitNonLeafNode is used for splitting a node
-	// 		that is not a leaf node. Revolutionary!
-	// key:		the key that causes overflow
-	// pageNo:	something
+	// @brief	splitNonLeafContents moves the upper half of a full pinned
+	// 		non-leaf node, with key as separator pos and rightPageNo
+	// 		after it, to a new right sibling, linking it in and passing
+	// 		on the high key
+	// newPageNo, newNode:	the new node is returned in these, still
+	// 		pinned
+	// returns:	the middle key, which is in neither half
 	//--------------------------------------------------------------------
-	const void BTreeIndex::splitNonLeafNode(int key, PageId parentPageNo, PageId previousNewPageNo) {
-		// cast node being split into a leaf node struct
-		Page* bufMgrPage;
-		bufMgr->readPage(file,parentPageNo,bufMgrPage);
-		Page* page = bufMgrPage;//&file->readPage(pageNo);
-		NonLeafNodeInt* node = (NonLeafNodeInt*) page;
+	template <class KeyT>
+	KeyT BTreeIndex<KeyT>::splitNonLeafContents(NonLeafNodeT* node, int pos, const KeyT& key, PageId rightPageNo, PageId& newPageNo, NonLeafNodeT*& newNode){
+		// initialize temporary arrays for key and pageNo storage
+		// size = num of keys in full array + 1 being added
+		KeyT arr1[NodeCapacity<KeyT>::NONLEAF+1];
+		PageId arr2[NodeCapacity<KeyT>::NONLEAF+2];
+		// copy everything into arr1[] and arr2[] with the new key at its place
+		int numAfter = node->numKeys - pos;
+		nodeKeys(node, arr1);
+		memcpy(arr2, node->pageNoArray, (node->numKeys + 1) * sizeof(PageId));
+		memmove(&arr1[pos+1], &arr1[pos], numAfter * sizeof(KeyT));
+		memmove(&arr2[pos+2], &arr2[pos+1], numAfter * sizeof(PageId));
+		arr1[pos] = key;
+		arr2[pos+1] = rightPageNo;
+		int totalKeys = node->numKeys + 1;
+
+		// splitIndex is the index of the median key, which moves up into
+		// the parent rather than being kept in either half. Packed halves
+		// may not both fit at the median, in which case the closest index
+		// that works is taken, and moving up the new key always does
+		int splitIndex = totalKeys / 2;
+		for (int step = 1; !nodeFits(arr1, splitIndex) || !nodeFits(&arr1[splitIndex + 1], totalKeys - splitIndex - 1); step++) {
+			splitIndex = (step % 2 == 1) ? totalKeys / 2 - (step + 1) / 2 : totalKeys / 2 + step / 2;
+			splitIndex = std::min(std::max(splitIndex, 0), totalKeys - 1);
+		}
+		KeyT pushUpKey = arr1[splitIndex];
 
-		int keyInt = key;
+		// create the new node, a sibling page to the right of "node"
+		newNode = CreateNonLeafNode(newPageNo);
+		NonLeafNodeT* oldNode = node;
+		newNode->level = oldNode->level;
+		if (newNode->level >= lowestPinnedLevel) {
+			pinNode(newPageNo);
+		}
 
-		// initialize temporary arrays for key and rid storage
-		// size = num of records in full array + 1 being added
-		int arr1[INTARRAYNONLEAFSIZE+1];
-		PageId arr2[INTARRAYNONLEAFSIZE+2];
-		// following code block inserts everything into arr1[] and arr2[]
-		int offset = 0;
-		for(int i = 0; i < node->numKeys; i++){
-			if(keyInt < node->keyArray[i] && offset == 0){
-				arr1[i] = keyInt;
-				arr2[i] = previousNewPageNo;
-				offset = 1;
-				i--;
-			}
-			else{
-				arr1[i+offset] = node->keyArray[i];
-				arr2[i+offset] = node->pageNoArray[i];
-			}
-		}
-		//key and rid were never entered!
-		if (offset == 0) {
-			arr1[node->numKeys] = keyInt;
-			arr2[node->numKeys] = previousNewPageNo;
-		}
-		//get the last item in pageNoArray, add it to last space in arr2
-		arr2[node->numKeys+1] = node->pageNoArray[node->numKeys]; //MAYBE SWITCH TO INTARRAYNONLEAFSIZE
+		// refill the old node and fill newNode with the keys after the middle one
+		int numKeysNewNode = totalKeys - splitIndex - 1;
+		nodeFill(oldNode, arr1, arr2, splitIndex);
+		nodeFill(newNode, &arr1[splitIndex + 1], &arr2[splitIndex + 1], numKeysNewNode);
 
-		// splitIndex is the index of the median key, and it points to
-		// the first element in the new node
-		int splitIndex = (node->numKeys + 1) / 2;
+		// newNode goes to the right of oldNode and takes over its high key
+		newNode->rightSibPageNo = oldNode->rightSibPageNo;
+		newNode->highKey = oldNode->highKey;
+		oldNode->rightSibPageNo = newPageNo;
+		oldNode->highKey = pushUpKey;
 
-		// create the new node, a sibling page to the right of "node"
-		PageId newPageNo;
-		NonLeafNodeInt* newNode = CreateNonLeafNode(newPageNo);
-		NonLeafNodeInt* oldNode = node;
+		return pushUpKey;
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::deleteEntry
+	// -----------------------------------------------------------------------------
 
-		// set numKeys of each node to proper value
-		int numKeysNewNode = (INTARRAYNONLEAFSIZE + 1) - splitIndex;
-		newNode->numKeys = numKeysNewNode;
-		oldNode->numKeys = splitIndex;
+	template <class KeyT>
+	const void BTreeIndex<KeyT>::deleteEntry(const void *key, const RecordId rid)
+	{
+		KeyT keyVal = KeyTraits<KeyT>::read(key);
+
+		//the scan may be about to move onto a leaf that gets merged away
+		BTreeScanCursor<KeyT>* cursor = findThreadCursor();
+		if (cursor != NULL && cursor->isExecuting()) endScan();
+
+		// find the leftmost leaf that may hold key, same as a scan would;
+		// deletes do not run alongside other operations, so it needs no latch
+		PageId leafPageNo;
+		std::vector<PageId> path;
+		LeafNodeT* node = findLeafNode(keyVal, leafPageNo, false, &path);
+		bufMgr->pageLatch((Page*) node).unlock();
+
+		// duplicates of key may run on into the right siblings, look
+		// through all of them for the one with the given rid, keeping
+		// the path down to the leaf in step
+		int pos = leafLowerBound(node, node->numKeys, keyVal);
+		while (true) {
+			while (pos < node->numKeys && !(keyVal < leafKey(node, pos)) && leafRid(node, pos) != rid) {
+				pos++;
+			}
+			if (pos < node->numKeys && !(keyVal < leafKey(node, pos))) break;
 
-		// fill entries of newNode arrays
-		for (int i = 0; i < numKeysNewNode; i++){
-			newNode->keyArray[i] = arr1[splitIndex + i];
-			newNode->pageNoArray[i] = arr2[splitIndex + i];
+			PageId rightSibPageNo = node->rightSibPageNo;
+			bufMgr->unPinPage(file,leafPageNo,false);
+			if (pos < node->numKeys || rightSibPageNo == Page::INVALID_NUMBER) {
+				throw NoSuchKeyFoundException();
+			}
+			movePathRight(path, path.size(), rightSibPageNo);
+			Page* page;
+			bufMgr->readPage(file,rightSibPageNo,page);
+			leafPageNo = rightSibPageNo;
+			node = (LeafNodeT*) page;
+			pos = 0;
 		}
-		newNode->pageNoArray[numKeysNewNode] = arr2[splitIndex+numKeysNewNode];
 
+		leafRemove(node, pos);
+		bufMgr->unPinPage(file,leafPageNo,true);
 
-		// give newNode a parent
-		newNode->parent = oldNode->parent;
+		rebalanceLeaf(leafPageNo, path);
+	}
 
-		// At this point, we have two non-leaf nodes
-		// the split index needs to be inserted into the parent
-		//
-		// Case: oldNode was the root (and also not a leaf)
-		if (oldNode->parent == -1) {
-			// create a new NonLeafNode
-			PageId newRootPageNo;
-			NonLeafNodeInt* newRoot = CreateNonLeafNode(newRootPageNo);
-			// set the info that makes it a root
-			newRoot->parent = -1;
-			newRoot->level = 0;
-			indexMetaInfo.rootPageNo = newRootPageNo;
-			// set each child's parent field
-			newNode->parent = newRootPageNo;
-			oldNode->parent = newRootPageNo;
-
-			// insert new key and children pageNo's
-			newRoot->keyArray[0] = arr1[splitIndex];
-			newRoot->pageNoArray[0] = parentPageNo;
-			newRoot->pageNoArray[1] = newPageNo;
-			newRoot->numKeys = 1;
-
-			bufMgr->unPinPage(file,parentPageNo,true);
-
-			bufMgr->unPinPage(file,newPageNo,true);
-
-			bufMgr->unPinPage(file,newRootPageNo,true);
+	//--------------------------------------------------------------------
+	// @brief	movePathRight updates the path down to a node for its
+	// 		right sibling, moving the node on it at each level right
+	// 		as long as the sibling is not under the node kept there
+	// depth:	the number of nodes on the path above the sibling
+	// pageNo:	the right sibling
+	//--------------------------------------------------------------------
+	template <class KeyT>
+	void BTreeIndex<KeyT>::movePathRight(std::vector<PageId>& path, const size_t depth, PageId pageNo){
+		if (depth == 0) return;
+
+		Page* bufMgrPage;
+		PageId parentPageNo = path[depth-1];
+		bufMgr->readPage(file,parentPageNo,bufMgrPage);
+		NonLeafNodeT* parent = (NonLeafNodeT*) bufMgrPage;
+		bool isChild = (parent->pageNoArray[childIndex(parent, pageNo)] == pageNo);
+		PageId rightPageNo = parent->rightSibPageNo;
+		bufMgr->unPinPage(file,parentPageNo,false);
+
+		// Case: the node was the last child of its parent, so its right
+		// sibling is the first child of the parent's right sibling
+		if (!isChild) {
+			path[depth-1] = rightPageNo;
+			movePathRight(path, depth-1, rightPageNo);
 		}
-		// Case: oldNode was NOT the root
-		else{
-			// call out parent
-			PageId parentPageId = oldNode->parent;
-			Page* bufMgrPage;
-			bufMgr->readPage(file,parentPageId,bufMgrPage);
-			NonLeafNodeInt* parent = (NonLeafNodeInt*)bufMgrPage;//(NonLeafNodeInt*)&file->readPage(parentPageId);
-			// Case: parent has space for new key
-			if (parent->numKeys < INTARRAYNONLEAFSIZE) {
-				// create variable for PageNo
-				//PageId* newPageNo = (PageId*) newNode;
-				// perform a bubble insert of the key
-				for (int i = 0; i < parent->numKeys; i++){
-					if (keyInt < parent->keyArray[i]) {
-						int key_temp = parent->keyArray[i];
-						PageId page_temp = parent->pageNoArray[i];
-
-						parent->keyArray[i] = keyInt;
-						parent->pageNoArray[i] = newPageNo;
-
-						keyInt = key_temp;
-						newPageNo = page_temp;
-					}
-				}
-				parent->keyArray[parent->numKeys] = keyInt;
-				PageId page_temp = parent->pageNoArray[parent->numKeys];
-				parent->pageNoArray[parent->numKeys] = newPageNo;
-				parent->pageNoArray[parent->numKeys+1] = page_temp;
-				parent->numKeys++;
-				parent->level = 0;
+	}
 
-				bufMgr->unPinPage(file,parentPageNo,true);
+	//--------------------------------------------------------------------
+	// @brief	rebalanceLeaf fixes a leaf that may have dropped below
+	// 		half full, by borrowing from or merging with a sibling
+	// pageNo:	the leaf an entry was deleted from
+	// path:	the non-leaf nodes from the root down to its parent
+	//--------------------------------------------------------------------
+	template <class KeyT>
+	void BTreeIndex<KeyT>::rebalanceLeaf(PageId pageNo, std::vector<PageId>& path){
+		Page* bufMgrPage;
+		bufMgr->readPage(file,pageNo,bufMgrPage);
+		LeafNodeT* node = (LeafNodeT*) bufMgrPage;
+		int minKeys = leafOccupancy / 2;
 
-				bufMgr->unPinPage(file,newPageNo,true);
+		// the root may shrink all the way down to an empty leaf
+		if (path.empty() || node->numKeys >= minKeys) {
+			bufMgr->unPinPage(file,pageNo,false);
+			return;
+		}
 
-				bufMgr->unPinPage(file,parentPageId,true);
+		PageId parentPageNo = path.back();
+		bufMgr->readPage(file,parentPageNo,bufMgrPage);
+		NonLeafNodeT* parent = (NonLeafNodeT*) bufMgrPage;
+		int idx = childIndex(parent, pageNo);
+		bool borrowed = false;
+
+		// Case: the left sibling can spare its last entry, the leaf has room
+		// for it, and the parent for the separator between what is left of the two
+		if (idx > 0) {
+			PageId leftPageNo = parent->pageNoArray[idx-1];
+			bufMgr->readPage(file,leftPageNo,bufMgrPage);
+			LeafNodeT* left = (LeafNodeT*) bufMgrPage;
+
+			if (left->numKeys > minKeys) {
+				KeyT key = leafKey(left, left->numKeys-1);
+				borrowed = leafRoom(node, key, key) > 0
+						&& nodeSetKey(parent, idx-1, KeyTraits<KeyT>::separator(leafKey(left, left->numKeys-2), key));
 			}
-			// Case: parent doesn't have space for new key
-			else{
-				int parentKey = arr1[splitIndex];//&parent->keyArray[splitIndex];
-				splitNonLeafNode(parentKey,parentPageId,newPageNo);
-
+			if (borrowed) {
+				char payload[MAX_PAYLOAD_SIZE];
+				leafPayloads(left, left->numKeys-1, left->numKeys, payload);
+				leafInsert(node, 0, leafKey(left, left->numKeys-1), leafRid(left, left->numKeys-1), payload);
+				leafRemove(left, left->numKeys-1);
+				left->highKey = nodeKey(parent, idx-1);
+
+				bufMgr->unPinPage(file,leftPageNo,true);
+				bufMgr->unPinPage(file,pageNo,true);
 				bufMgr->unPinPage(file,parentPageNo,true);
+				return;
+			}
+			bufMgr->unPinPage(file,leftPageNo,false);
+		}
 
-				bufMgr->unPinPage(file,newPageNo,true);
-
-				bufMgr->unPinPage(file,parentPageId,true);
+		// Case: the right sibling can spare its first entry, the leaf has
+		// room for it, and the parent for the new separator
+		if (idx < parent->numKeys) {
+			PageId rightPageNo = parent->pageNoArray[idx+1];
+			bufMgr->readPage(file,rightPageNo,bufMgrPage);
+			LeafNodeT* right = (LeafNodeT*) bufMgrPage;
+
+			if (right->numKeys > minKeys) {
+				KeyT key = leafKey(right, 0);
+				borrowed = leafRoom(node, key, key) > 0
+						&& nodeSetKey(parent, idx, KeyTraits<KeyT>::separator(key, leafKey(right, 1)));
+			}
+			if (borrowed) {
+				char payload[MAX_PAYLOAD_SIZE];
+				leafPayloads(right, 0, 1, payload);
+				leafInsert(node, node->numKeys, leafKey(right, 0), leafRid(right, 0), payload);
+				leafRemove(right, 0);
+				node->highKey = nodeKey(parent, idx);
+
+				bufMgr->unPinPage(file,rightPageNo,true);
+				bufMgr->unPinPage(file,pageNo,true);
+				bufMgr->unPinPage(file,parentPageNo,true);
+				return;
 			}
+			bufMgr->unPinPage(file,rightPageNo,false);
+		}
+
+		// Case: neither sibling can spare an entry, so the right one of the
+		// pair is merged into the left one and its separator is dropped
+		int leftIdx = (idx > 0) ? idx - 1 : idx;
+		PageId leftPageNo = parent->pageNoArray[leftIdx];
+		PageId rightPageNo = parent->pageNoArray[leftIdx+1];
+		bufMgr->unPinPage(file,pageNo,false);
+
+		bufMgr->readPage(file,leftPageNo,bufMgrPage);
+		LeafNodeT* left = (LeafNodeT*) bufMgrPage;
+		bufMgr->readPage(file,rightPageNo,bufMgrPage);
+		LeafNodeT* right = (LeafNodeT*) bufMgrPage;
+
+		// Case: the pair is too full to merge, since a sibling could have
+		// spared an entry if a packed parent had room for the separator, or
+		// their keys together need a wider key column, so the leaf is left
+		// as it is
+		KeyT keys[2 * NodeCapacity<KeyT>::LEAF_MAX];
+		RecordId rids[2 * NodeCapacity<KeyT>::LEAF_MAX];
+		char payloads[2 * LEAF_PAYLOAD_BYTES];
+		leafEntries(left, keys, rids, payloads);
+		leafEntries(right, &keys[left->numKeys], &rids[left->numKeys], &payloads[left->numKeys * payloadBytes]);
+		if (!leafFill(left, keys, rids, payloads, left->numKeys + right->numKeys)) {
+			bufMgr->unPinPage(file,leftPageNo,false);
+			bufMgr->unPinPage(file,rightPageNo,false);
+			bufMgr->unPinPage(file,parentPageNo,false);
+			return;
+		}
 
+		left->rightSibPageNo = right->rightSibPageNo;
+		left->highKey = right->highKey;
+		if (left->rightSibPageNo != Page::INVALID_NUMBER) {
+			bufMgr->readPage(file,left->rightSibPageNo,bufMgrPage);
+			((LeafNodeT*) bufMgrPage)->leftSibPageNo = leftPageNo;
+			bufMgr->unPinPage(file,left->rightSibPageNo,true);
 		}
+		removeFromNonLeaf(parent, leftIdx);
+
+		bufMgr->unPinPage(file,leftPageNo,true);
+		bufMgr->unPinPage(file,rightPageNo,false);
+		bufMgr->unPinPage(file,parentPageNo,true);
+		freeNodePage(rightPageNo);
 
+		rebalanceNonLeaf(path);
 	}
 
 	//--------------------------------------------------------------------
-	// @brief	findLeafNode traverses the tree downwards to find the
-	// 		leaf node that fits the given key
-	// key:		the key to insert
-	// pageNo:	a NonLeafNodeInt* that will serve as the start of the search
-	// returns:	the LeafNodeInt* where the key is in range
+	// @brief	rebalanceNonLeaf fixes a non-leaf node that may have
+	// 		dropped below half full after losing a child, and
+	// 		collapses the root once it has a single child left
+	// path:	the non-leaf nodes from the root down to the one a
+	// 		separator was removed from, which is taken off the end
 	//--------------------------------------------------------------------
-	LeafNodeInt* BTreeIndex::findLeafNode(int key, PageId pageNo){
+	template <class KeyT>
+	void BTreeIndex<KeyT>::rebalanceNonLeaf(std::vector<PageId>& path){
+		PageId pageNo = path.back();
+		path.pop_back();
 		Page* bufMgrPage;
 		bufMgr->readPage(file,pageNo,bufMgrPage);
-		//Page* page = bufMgrPage; //&file->readPage(pageNo);
-		NonLeafNodeInt* node = (NonLeafNodeInt*) bufMgrPage;
-
-		//std::cout << "node level: " << node->level << std::endl;
-
-		if(node->level == 1){
-			for(int i = 0; i < node->numKeys; i++){
-				if(key < node->keyArray[i]){
-					Page* new_bufMgrPage;
-					bufMgr->readPage(file,node->pageNoArray[i],new_bufMgrPage);
-					foundLeafPageNo = node->pageNoArray[i];
-					//bufMgr->unPinPage(file, pageNo, false);
-					return (LeafNodeInt*)new_bufMgrPage;//&file->readPage(node->pageNoArray[i]);
+		NonLeafNodeT* node = (NonLeafNodeT*) bufMgrPage;
+		bool childrenAreLeaves = (node->level == 1);
+
+		// Case: the root is down to its last child, which becomes the root
+		if (path.empty()) {
+			if (node->numKeys > 0) {
+				bufMgr->unPinPage(file,pageNo,false);
+				return;
+			}
+			PageId childPageNo = node->pageNoArray[0];
+			bufMgr->unPinPage(file,pageNo,false);
+			indexMetaInfo.rootPageNo = childPageNo;
+			indexMetaInfo.isLeaf = childrenAreLeaves;
+			rootPageNum = childPageNo;
+			freeNodePage(pageNo);
+			writeMetaPage();
+			return;
+		}
+		if (!nodeUnderfull(node)) {
+			bufMgr->unPinPage(file,pageNo,false);
+			return;
+		}
+
+		PageId parentPageNo = path.back();
+		bufMgr->readPage(file,parentPageNo,bufMgrPage);
+		NonLeafNodeT* parent = (NonLeafNodeT*) bufMgrPage;
+		int idx = childIndex(parent, pageNo);
+
+		// Case: the left sibling can spare a child, its last child moves over
+		// and the separators rotate through the parent
+		if (idx > 0) {
+			PageId leftPageNo = parent->pageNoArray[idx-1];
+			bufMgr->readPage(file,leftPageNo,bufMgrPage);
+			NonLeafNodeT* left = (NonLeafNodeT*) bufMgrPage;
+
+			if (nodeCanSpare(left)) {
+				// the separator comes down in front of the node's keys
+				std::vector<KeyT> keys(node->numKeys + 1);
+				std::vector<PageId> pageNos(node->numKeys + 2);
+				keys[0] = nodeKey(parent, idx-1);
+				nodeKeys(node, &keys[1]);
+				pageNos[0] = left->pageNoArray[left->numKeys];
+				memcpy(&pageNos[1], node->pageNoArray, (node->numKeys + 1) * sizeof(PageId));
+				KeyT upKey = nodeKey(left, left->numKeys-1);
+
+				// packed nodes may have no room for the longer keys
+				if (nodeFits(&keys[0], keys.size()) && nodeSetKey(parent, idx-1, upKey)) {
+					nodeFill(node, &keys[0], &pageNos[0], keys.size());
+					removeFromNonLeaf(left, left->numKeys-1);
+					left->highKey = upKey;
+
+					bufMgr->unPinPage(file,leftPageNo,true);
+					bufMgr->unPinPage(file,pageNo,true);
+					bufMgr->unPinPage(file,parentPageNo,true);
+					return;
 				}
 			}
-			Page* new_bufPage;
-			bufMgr->readPage(file,node->pageNoArray[node->numKeys],new_bufPage);
-			foundLeafPageNo = node->pageNoArray[node->numKeys];
-			//bufMgr->unPinPage(file, pageNo, false);
-			return (LeafNodeInt*)new_bufPage;//&file->readPage(node->pageNoArray[node->numKeys]);
-		}
-		//else, node level must be 0
-		else if(node->level == 0) {
-			for(int i = 0; i < node->numKeys; i++){
-				if(key < node->keyArray[i]){
-					bufMgr->unPinPage(file, pageNo, false);
-					return findLeafNode(key, node->pageNoArray[i]);
+			bufMgr->unPinPage(file,leftPageNo,false);
+		}
+
+		// Case: the right sibling can spare its first child
+		if (idx < parent->numKeys) {
+			PageId rightPageNo = parent->pageNoArray[idx+1];
+			bufMgr->readPage(file,rightPageNo,bufMgrPage);
+			NonLeafNodeT* right = (NonLeafNodeT*) bufMgrPage;
+
+			if (nodeCanSpare(right)) {
+				KeyT downKey = nodeKey(parent, idx);
+				KeyT upKey = nodeKey(right, 0);
+
+				if (nodeHasRoom(node, &downKey) && nodeSetKey(parent, idx, upKey)) {
+					nodeInsert(node, node->numKeys, downKey, right->pageNoArray[0]);
+					node->highKey = upKey;
+					// the right sibling keeps everything after its first child
+					std::vector<KeyT> keys(right->numKeys);
+					nodeKeys(right, &keys[0]);
+					nodeFill(right, &keys[0] + 1, &right->pageNoArray[1], right->numKeys - 1);
+
+					bufMgr->unPinPage(file,rightPageNo,true);
+					bufMgr->unPinPage(file,pageNo,true);
+					bufMgr->unPinPage(file,parentPageNo,true);
+					return;
 				}
 			}
-			//bufMgr->unPinPage(file, pageNo, false);
-			return findLeafNode(key, node->pageNoArray[node->numKeys]);
+			bufMgr->unPinPage(file,rightPageNo,false);
+		}
+
+		// Case: neither sibling can spare a child, so the separator comes down
+		// and the right node of the pair is merged into the left one
+		int leftIdx = (idx > 0) ? idx - 1 : idx;
+		PageId leftPageNo = parent->pageNoArray[leftIdx];
+		PageId rightPageNo = parent->pageNoArray[leftIdx+1];
+		bufMgr->unPinPage(file,pageNo,false);
+
+		bufMgr->readPage(file,leftPageNo,bufMgrPage);
+		NonLeafNodeT* left = (NonLeafNodeT*) bufMgrPage;
+		bufMgr->readPage(file,rightPageNo,bufMgrPage);
+		NonLeafNodeT* right = (NonLeafNodeT*) bufMgrPage;
+
+		int firstMoved = left->numKeys + 1;
+		int numMoved = right->numKeys + 1;
+		std::vector<KeyT> keys(left->numKeys + numMoved);
+		std::vector<PageId> pageNos(firstMoved + numMoved);
+		nodeKeys(left, &keys[0]);
+		keys[left->numKeys] = nodeKey(parent, leftIdx);
+		nodeKeys(right, &keys[firstMoved]);
+		memcpy(&pageNos[0], left->pageNoArray, firstMoved * sizeof(PageId));
+		memcpy(&pageNos[firstMoved], right->pageNoArray, numMoved * sizeof(PageId));
+
+		// Case: a packed pair too full to merge, and which could not rotate
+		// either, is left as it is
+		if (!nodeFill(left, &keys[0], &pageNos[0], keys.size())) {
+			bufMgr->unPinPage(file,leftPageNo,false);
+			bufMgr->unPinPage(file,rightPageNo,false);
+			bufMgr->unPinPage(file,parentPageNo,false);
+			return;
 		}
+		left->rightSibPageNo = right->rightSibPageNo;
+		left->highKey = right->highKey;
+		removeFromNonLeaf(parent, leftIdx);
+
+		bufMgr->unPinPage(file,leftPageNo,true);
+		bufMgr->unPinPage(file,rightPageNo,false);
+		bufMgr->unPinPage(file,parentPageNo,true);
+		freeNodePage(rightPageNo);
+
+		rebalanceNonLeaf(path);
+	}
+
+	//--------------------------------------------------------------------
+	// @brief	removeFromNonLeaf drops separator keyIndex and the child
+	// 		to its right from a pinned non-leaf node
+	//--------------------------------------------------------------------
+	template <class KeyT>
+	void BTreeIndex<KeyT>::removeFromNonLeaf(NonLeafNodeT* node, int keyIndex){
+		int numToShift = node->numKeys - keyIndex - 1;
+		memmove(&node->keyArray[keyIndex], &node->keyArray[keyIndex+1], numToShift * sizeof(KeyT));
+		memmove(&node->pageNoArray[keyIndex+1], &node->pageNoArray[keyIndex+2], numToShift * sizeof(PageId));
+		node->numKeys--;
+	}
+
+	//--------------------------------------------------------------------
+	// @brief	childIndex finds the slot of a child in pageNoArray
+	//--------------------------------------------------------------------
+	template <class KeyT>
+	int BTreeIndex<KeyT>::childIndex(NonLeafNodeT* node, PageId childPageNo){
+		// separators cannot tell duplicates apart, so look for the page itself
+		int i = 0;
+		while (i < node->numKeys && node->pageNoArray[i] != childPageNo) i++;
+		return i;
 	}
 
 	// -----------------------------------------------------------------------------
-	// BTreeIndex::startScan
+	// Non-leaf node layout: keys in keyArray, or packed for STRING keys
 	// -----------------------------------------------------------------------------
 
-	const void BTreeIndex::startScan(const void* lowValParm,
-					const Operator lowOpParm,
-					const void* highValParm,
-					const Operator highOpParm)
+	//--------------------------------------------------------------------
+	// @brief	nodeLowerBound finds key among the first numKeys
+	// 		separators of a non-leaf node, as lowerBound does in a
+	// 		keyArray. Safe on a node read without a latch, as long as
+	// 		numKeys is in range
+	//--------------------------------------------------------------------
+	template <class KeyT>
+	int BTreeIndex<KeyT>::nodeLowerBound(const NonLeafNodeT* node, const int numKeys, const KeyT& key){
+		return lowerBound(node->keyArray, numKeys, key);
+	}
+
+	//--------------------------------------------------------------------
+	// @brief	nodeKey returns separator i of a non-leaf node, and
+	// 		nodeKeys copies out all of them
+	//--------------------------------------------------------------------
+	template <class KeyT>
+	KeyT BTreeIndex<KeyT>::nodeKey(const NonLeafNodeT* node, const int i){
+		return node->keyArray[i];
+	}
+
+	template <class KeyT>
+	void BTreeIndex<KeyT>::nodeKeys(const NonLeafNodeT* node, KeyT* keys){
+		std::copy(node->keyArray, node->keyArray + node->numKeys, keys);
+	}
+
+	//--------------------------------------------------------------------
+	// @brief	nodeHasRoom tells whether a non-leaf node can take key
+	// 		without splitting
+	// key:		the separator to add, NULL for whichever one may come
+	// fillFactor:	the fraction of the node that may be used
+	//--------------------------------------------------------------------
+	template <class KeyT>
+	bool BTreeIndex<KeyT>::nodeHasRoom(const NonLeafNodeT* node, const KeyT* key, const double fillFactor){
+		int maxKeys = std::min(nodeOccupancy, std::max(1, (int) (fillFactor * nodeOccupancy)));
+		return node->numKeys < maxKeys;
+	}
+
+	//--------------------------------------------------------------------
+	// @brief	nodeInsert puts key at separator pos of a non-leaf node
+	// 		that has room for it, with rightPageNo as the child to
+	// 		its right
+	//--------------------------------------------------------------------
+	template <class KeyT>
+	void BTreeIndex<KeyT>::nodeInsert(NonLeafNodeT* node, const int pos, const KeyT& key, PageId rightPageNo){
+		// shift every key from pos on, and the child to its right, one slot
+		// over and drop the separator into the hole
+		int numToShift = node->numKeys - pos;
+		memmove(&node->keyArray[pos+1], &node->keyArray[pos], numToShift * sizeof(KeyT));
+		memmove(&node->pageNoArray[pos+2], &node->pageNoArray[pos+1], numToShift * sizeof(PageId));
+		node->keyArray[pos] = key;
+		node->pageNoArray[pos+1] = rightPageNo;
+		node->numKeys++;
+	}
+
+	//--------------------------------------------------------------------
+	// @brief	nodeFits tells whether a non-leaf node can hold the
+	// 		given sorted separators
+	//--------------------------------------------------------------------
+	template <class KeyT>
+	bool BTreeIndex<KeyT>::nodeFits(const KeyT* keys, const int numKeys){
+		return numKeys <= nodeOccupancy;
+	}
+
+	//--------------------------------------------------------------------
+	// @brief	nodeFill replaces the separators and children of a
+	// 		non-leaf node, with numKeys + 1 children
+	// returns:	false, leaving the node as it was, if they do not fit
+	//--------------------------------------------------------------------
+	template <class KeyT>
+	bool BTreeIndex<KeyT>::nodeFill(NonLeafNodeT* node, const KeyT* keys, const PageId* pageNos, const int numKeys){
+		if (!nodeFits(keys, numKeys)) return false;
+		memmove(node->keyArray, keys, numKeys * sizeof(KeyT));
+		memmove(node->pageNoArray, pageNos, (numKeys + 1) * sizeof(PageId));
+		node->numKeys = numKeys;
+		return true;
+	}
+
+	//--------------------------------------------------------------------
+	// @brief	nodeSetKey replaces separator i of a non-leaf node
+	// returns:	false, leaving the node as it was, if key does not fit
+	//--------------------------------------------------------------------
+	template <class KeyT>
+	bool BTreeIndex<KeyT>::nodeSetKey(NonLeafNodeT* node, const int i, const KeyT& key){
+		node->keyArray[i] = key;
+		return true;
+	}
+
+	//--------------------------------------------------------------------
+	// @brief	nodeUnderfull tells whether a non-leaf node is below half
+	// 		full, and nodeCanSpare whether it stays at least half
+	// 		full after giving a separator to a sibling
+	//--------------------------------------------------------------------
+	template <class KeyT>
+	bool BTreeIndex<KeyT>::nodeUnderfull(const NonLeafNodeT* node){
+		return node->numKeys < nodeOccupancy / 2;
+	}
+
+	template <class KeyT>
+	bool BTreeIndex<KeyT>::nodeCanSpare(const NonLeafNodeT* node){
+		return node->numKeys > nodeOccupancy / 2;
+	}
+
+	// bytes of a string key before its terminating zero
+	static int keyLength(const char* key)
+	{
+		return strnlen(key, STRINGSIZE);
+	}
+
+	// number of leading bytes two string keys share, up to length and short of a terminating zero
+	static int commonPrefix(const char* key1, const char* key2, const int length)
+	{
+		int i = 0;
+		while (i < length && key1[i] != 0 && key1[i] == key2[i]) i++;
+		return i;
+	}
+
+	// prefix length of a packed node, in range even if the node is read while it changes
+	static int packedPrefix(const NonLeafNodeString* node)
+	{
+		return std::min(std::max(node->prefixLength, 0), STRINGSIZE);
+	}
+
+	// where the bytes of separator i of a packed node begin and end, within the node and
+	// within STRINGSIZE even if the node is read while it changes
+	static void packedBytes(const NonLeafNodeString* node, const int prefixLength, const int i, int& begin, int& end)
+	{
+		const int maxBytes = NodeCapacity<StringKey>::NONLEAF_BYTES;
+		begin = std::min((i == 0) ? prefixLength : (int) node->keyEnd[i-1], maxBytes);
+		end = std::min(std::max((int) node->keyEnd[i], begin), std::min(maxBytes, begin + STRINGSIZE - prefixLength));
+	}
+
+	// number of separators of a packed node less than key
+	static int packedBound(const NonLeafNodeString* node, const int numKeys, const StringKey& key)
+	{
+		if (numKeys <= 0) return 0;
+
+		// a key that does not start with the prefix is below or above every separator
+		int prefixLength = packedPrefix(node);
+		int cmp = memcmp(key.data, node->keyBytes, prefixLength);
+		if (cmp != 0) return (cmp < 0) ? 0 : numKeys;
+
+		const char* rest = key.data + prefixLength;
+		int restLength = std::max(keyLength(key.data) - prefixLength, 0);
+		int low = 0;
+		int high = numKeys;
+		while (low < high) {
+			int mid = (low + high) / 2;
+			int begin, end;
+			packedBytes(node, prefixLength, mid, begin, end);
+			// past its last byte the separator is zero padded, so a longer key is greater
+			cmp = memcmp(&node->keyBytes[begin], rest, end - begin);
+			if (cmp == 0 && end - begin < restLength) cmp = -1;
+			if (cmp < 0) {
+				low = mid + 1;
+			} else {
+				high = mid;
+			}
+		}
+		return low;
+	}
+
+	// bytes a packed node needs for the given sorted separators
+	static int packedSize(const StringKey* keys, const int numKeys)
+	{
+		if (numKeys == 0) return 0;
+		// the first and last separators share the least with each other
+		int prefixLength = commonPrefix(keys[0].data, keys[numKeys-1].data, STRINGSIZE);
+		int size = prefixLength;
+		for (int i = 0; i < numKeys; i++) {
+			size += keyLength(keys[i].data) - prefixLength;
+		}
+		return size;
+	}
+
+	template <>
+	int BTreeIndex<StringKey>::nodeLowerBound(const NonLeafNodeT* node, const int numKeys, const StringKey& key){
+		return packedBound(node, numKeys, key);
+	}
+
+	template <>
+	StringKey BTreeIndex<StringKey>::nodeKey(const NonLeafNodeT* node, const int i){
+		StringKey key;
+		memset(key.data, 0, STRINGSIZE);
+		int prefixLength = packedPrefix(node);
+		int begin, end;
+		packedBytes(node, prefixLength, i, begin, end);
+		memcpy(key.data, node->keyBytes, prefixLength);
+		memcpy(key.data + prefixLength, &node->keyBytes[begin], end - begin);
+		return key;
+	}
+
+	template <>
+	void BTreeIndex<StringKey>::nodeKeys(const NonLeafNodeT* node, StringKey* keys){
+		for (int i = 0; i < node->numKeys; i++) {
+			keys[i] = nodeKey(node, i);
+		}
+	}
+
+	template <>
+	bool BTreeIndex<StringKey>::nodeHasRoom(const NonLeafNodeT* node, const StringKey* key, const double fillFactor){
+		int maxKeys = std::min(nodeOccupancy, std::max(1, (int) (fillFactor * nodeOccupancy)));
+		if (node->numKeys >= maxKeys) return false;
+		if (node->numKeys == 0) return true;
+
+		// a key without the whole prefix leaves less of it to share, and every
+		// separator keeps the rest itself. Whichever key may come could share none
+		int maxBytes = std::max(STRINGSIZE, (int) (fillFactor * NodeCapacity<StringKey>::NONLEAF_BYTES));
+		int prefixLength = node->prefixLength;
+		int sharedLength = (key == NULL) ? 0 : commonPrefix(node->keyBytes, key->data, prefixLength);
+		int length = (key == NULL) ? STRINGSIZE : keyLength(key->data);
+		int restBytes = node->keyEnd[node->numKeys-1] - prefixLength;
+		int size = sharedLength + restBytes + (prefixLength - sharedLength) * node->numKeys + length - sharedLength;
+		return size <= maxBytes;
+	}
+
+	template <>
+	bool BTreeIndex<StringKey>::nodeFits(const StringKey* keys, const int numKeys){
+		return numKeys <= nodeOccupancy && packedSize(keys, numKeys) <= NodeCapacity<StringKey>::NONLEAF_BYTES;
+	}
+
+	template <>
+	bool BTreeIndex<StringKey>::nodeFill(NonLeafNodeT* node, const StringKey* keys, const PageId* pageNos, const int numKeys){
+		if (!nodeFits(keys, numKeys)) return false;
+
+		// the prefix is whatever the first and last separators share
+		int prefixLength = 0;
+		if (numKeys > 0) {
+			prefixLength = commonPrefix(keys[0].data, keys[numKeys-1].data, STRINGSIZE);
+			memcpy(node->keyBytes, keys[0].data, prefixLength);
+		}
+		int end = prefixLength;
+		for (int i = 0; i < numKeys; i++) {
+			int length = keyLength(keys[i].data) - prefixLength;
+			memcpy(&node->keyBytes[end], keys[i].data + prefixLength, length);
+			end += length;
+			node->keyEnd[i] = end;
+		}
+		memmove(node->pageNoArray, pageNos, (numKeys + 1) * sizeof(PageId));
+		node->prefixLength = prefixLength;
+		node->numKeys = numKeys;
+		return true;
+	}
+
+	template <>
+	void BTreeIndex<StringKey>::nodeInsert(NonLeafNodeT* node, const int pos, const StringKey& key, PageId rightPageNo){
+		int prefixLength = node->prefixLength;
+
+		// Case: key does not start with the prefix, so the node is packed
+		// again around a shorter one
+		if (node->numKeys == 0 || commonPrefix(node->keyBytes, key.data, prefixLength) < prefixLength) {
+			int numKeys = node->numKeys;
+			std::vector<StringKey> keys(numKeys + 1);
+			std::vector<PageId> pageNos(numKeys + 2);
+			nodeKeys(node, &keys[0]);
+			memcpy(&pageNos[0], node->pageNoArray, (numKeys + 1) * sizeof(PageId));
+			memmove(&keys[pos+1], &keys[pos], (numKeys - pos) * sizeof(StringKey));
+			memmove(&pageNos[pos+2], &pageNos[pos+1], (numKeys - pos) * sizeof(PageId));
+			keys[pos] = key;
+			pageNos[pos+1] = rightPageNo;
+			nodeFill(node, &keys[0], &pageNos[0], numKeys + 1);
+			return;
+		}
+
+		// Case: the rest of key goes in between the separators around it
+		int length = keyLength(key.data) - prefixLength;
+		int begin = (pos == 0) ? prefixLength : node->keyEnd[pos-1];
+		int used = node->keyEnd[node->numKeys-1];
+		memmove(&node->keyBytes[begin + length], &node->keyBytes[begin], used - begin);
+		memcpy(&node->keyBytes[begin], key.data + prefixLength, length);
+		for (int i = node->numKeys; i > pos; i--) {
+			node->keyEnd[i] = node->keyEnd[i-1] + length;
+		}
+		node->keyEnd[pos] = begin + length;
+		memmove(&node->pageNoArray[pos+2], &node->pageNoArray[pos+1], (node->numKeys - pos) * sizeof(PageId));
+		node->pageNoArray[pos+1] = rightPageNo;
+		node->numKeys++;
+	}
+
+	template <>
+	void BTreeIndex<StringKey>::removeFromNonLeaf(NonLeafNodeT* node, int keyIndex){
+		// the prefix is still shared by whatever separators are left
+		int begin, end;
+		packedBytes(node, node->prefixLength, keyIndex, begin, end);
+		int used = node->keyEnd[node->numKeys-1];
+		memmove(&node->keyBytes[begin], &node->keyBytes[end], used - end);
+		for (int i = keyIndex; i < node->numKeys - 1; i++) {
+			node->keyEnd[i] = node->keyEnd[i+1] - (end - begin);
+		}
+		int numToShift = node->numKeys - keyIndex - 1;
+		memmove(&node->pageNoArray[keyIndex+1], &node->pageNoArray[keyIndex+2], numToShift * sizeof(PageId));
+		node->numKeys--;
+	}
+
+	template <>
+	bool BTreeIndex<StringKey>::nodeSetKey(NonLeafNodeT* node, const int i, const StringKey& key){
+		std::vector<StringKey> keys(node->numKeys);
+		nodeKeys(node, &keys[0]);
+		keys[i] = key;
+		return nodeFill(node, &keys[0], node->pageNoArray, node->numKeys);
+	}
+
+	template <>
+	bool BTreeIndex<StringKey>::nodeUnderfull(const NonLeafNodeT* node){
+		// full is when either the child slots or the bytes run out
+		int used = (node->numKeys == 0) ? 0 : node->keyEnd[node->numKeys-1];
+		return node->numKeys < nodeOccupancy / 2 && used < NodeCapacity<StringKey>::NONLEAF_BYTES / 2;
+	}
+
+	template <>
+	bool BTreeIndex<StringKey>::nodeCanSpare(const NonLeafNodeT* node){
+		int used = (node->numKeys == 0) ? 0 : node->keyEnd[node->numKeys-1];
+		return node->numKeys > nodeOccupancy / 2 || used - STRINGSIZE >= NodeCapacity<StringKey>::NONLEAF_BYTES / 2;
+	}
+
+	// -----------------------------------------------------------------------------
+	// Leaf node layout: keyArray and ridArray, or columns for INTEGER keys
+	// -----------------------------------------------------------------------------
+
+	//--------------------------------------------------------------------
+	// @brief	leafNumKeys returns the number of entries of a leaf, kept
+	// 		within what the leaf can hold in case it is read without
+	// 		a latch while it changes
+	//--------------------------------------------------------------------
+	template <class KeyT>
+	int BTreeIndex<KeyT>::leafNumKeys(const LeafNodeT* leaf){
+		return std::min(std::max(leaf->numKeys, 0), leafOccupancy);
+	}
+
+	//--------------------------------------------------------------------
+	// @brief	leafLowerBound and leafUpperBound find key among the
+	// 		first numKeys entries of a leaf, as lowerBound and
+	// 		upperBound do in a keyArray. Safe on a leaf read without a
+	// 		latch, as long as numKeys comes from leafNumKeys
+	//--------------------------------------------------------------------
+	template <class KeyT>
+	int BTreeIndex<KeyT>::leafLowerBound(const LeafNodeT* leaf, const int numKeys, const KeyT& key){
+		return lowerBound(leaf->keyArray, numKeys, key);
+	}
+
+	template <class KeyT>
+	int BTreeIndex<KeyT>::leafUpperBound(const LeafNodeT* leaf, const int numKeys, const KeyT& key){
+		return upperBound(leaf->keyArray, numKeys, key);
+	}
+
+	//--------------------------------------------------------------------
+	// @brief	leafKey and leafRid return the key and the record id of
+	// 		entry i of a leaf
+	//--------------------------------------------------------------------
+	template <class KeyT>
+	KeyT BTreeIndex<KeyT>::leafKey(const LeafNodeT* leaf, const int i){
+		return leaf->keyArray[i];
+	}
+
+	template <class KeyT>
+	RecordId BTreeIndex<KeyT>::leafRid(const LeafNodeT* leaf, const int i){
+		return leaf->ridArray[i];
+	}
+
+	//--------------------------------------------------------------------
+	// @brief	leafRids copies the record ids of entries begin .. end-1
+	// 		of a leaf into rids
+	//--------------------------------------------------------------------
+	template <class KeyT>
+	void BTreeIndex<KeyT>::leafRids(const LeafNodeT* leaf, const int begin, const int end, RecordId* rids){
+		memcpy(rids, &leaf->ridArray[begin], (end - begin) * sizeof(RecordId));
+	}
+
+	//--------------------------------------------------------------------
+	// @brief	leafPayloads copies the included columns of entries
+	// 		begin .. end-1 of a leaf into payloads, payloadBytes each.
+	// 		Only leaves over INTEGER keys have any
+	//--------------------------------------------------------------------
+	template <class KeyT>
+	void BTreeIndex<KeyT>::leafPayloads(const LeafNodeT* leaf, const int begin, const int end, char* payloads){
+	}
+
+	//--------------------------------------------------------------------
+	// @brief	leafEntries copies out the keys, record ids and included
+	// 		columns of all entries of a leaf
+	// payloads:	may be NULL if the index has no included columns
+	//--------------------------------------------------------------------
+	template <class KeyT>
+	void BTreeIndex<KeyT>::leafEntries(const LeafNodeT* leaf, KeyT* keys, RecordId* rids, char* payloads){
+		std::copy(leaf->keyArray, leaf->keyArray + leaf->numKeys, keys);
+		std::copy(leaf->ridArray, leaf->ridArray + leaf->numKeys, rids);
+	}
+
+	//--------------------------------------------------------------------
+	// @brief	leafFits tells whether a leaf can hold entries with the
+	// 		given sorted keys
+	//--------------------------------------------------------------------
+	template <class KeyT>
+	bool BTreeIndex<KeyT>::leafFits(const KeyT* keys, const int numKeys){
+		return numKeys <= leafOccupancy;
+	}
+
+	//--------------------------------------------------------------------
+	// @brief	leafFill replaces the entries of a leaf
+	// payloads:	may be NULL if the index has no included columns
+	// returns:	false, leaving the leaf as it was, if they do not fit
+	//--------------------------------------------------------------------
+	template <class KeyT>
+	bool BTreeIndex<KeyT>::leafFill(LeafNodeT* leaf, const KeyT* keys, const RecordId* rids, const char* payloads, const int numKeys){
+		if (!leafFits(keys, numKeys)) return false;
+		std::copy(keys, keys + numKeys, leaf->keyArray);
+		std::copy(rids, rids + numKeys, leaf->ridArray);
+		leaf->numKeys = numKeys;
+		return true;
+	}
+
+	//--------------------------------------------------------------------
+	// @brief	leafRoom tells how many more entries with keys from low
+	// 		to high a leaf can take, 0 or less if it is full
+	// fillFactor:	the fraction of the leaf that may be used
+	//--------------------------------------------------------------------
+	template <class KeyT>
+	int BTreeIndex<KeyT>::leafRoom(const LeafNodeT* leaf, const KeyT& low, const KeyT& high, const double fillFactor){
+		int maxKeys = std::min(leafOccupancy, std::max(1, (int) (fillFactor * leafOccupancy)));
+		return maxKeys - leaf->numKeys;
+	}
+
+	//--------------------------------------------------------------------
+	// @brief	leafInsert puts an entry at position pos of a leaf that
+	// 		has room for it, and leafRemove drops entry pos
+	// payload:	may be NULL if the index has no included columns
+	//--------------------------------------------------------------------
+	template <class KeyT>
+	void BTreeIndex<KeyT>::leafInsert(LeafNodeT* leaf, const int pos, const KeyT& key, const RecordId rid, const char* payload){
+		// open up a slot in both arrays with a single move each
+		int numToShift = leaf->numKeys - pos;
+		memmove(&leaf->keyArray[pos+1], &leaf->keyArray[pos], numToShift * sizeof(KeyT));
+		memmove(&leaf->ridArray[pos+1], &leaf->ridArray[pos], numToShift * sizeof(RecordId));
+		leaf->keyArray[pos] = key;
+		leaf->ridArray[pos] = rid;
+		// numKeys makes a new friend
+		leaf->numKeys++;
+	}
+
+	template <class KeyT>
+	void BTreeIndex<KeyT>::leafRemove(LeafNodeT* leaf, const int pos){
+		// close the gap left by the entry
+		int numToShift = leaf->numKeys - pos - 1;
+		memmove(&leaf->keyArray[pos], &leaf->keyArray[pos+1], numToShift * sizeof(KeyT));
+		memmove(&leaf->ridArray[pos], &leaf->ridArray[pos+1], numToShift * sizeof(RecordId));
+		leaf->numKeys--;
+	}
+
+	//--------------------------------------------------------------------
+	// @brief	setIncludedColumns checks the columns a covering index
+	// 		stores in its leaves and sizes the leaves for them. Only
+	// 		leaves over INTEGER keys have room for included columns
+	//--------------------------------------------------------------------
+	template <class KeyT>
+	void BTreeIndex<KeyT>::setIncludedColumns(const std::string& relationName, const IncludedColumn* columns, const int numColumns){
+		if (numColumns > 0) {
+			throw BadIndexInfoException("Only INTEGER indexes store included columns");
+		}
+	}
+
+	//--------------------------------------------------------------------
+	// @brief	readPayload copies the included columns out of the record
+	// 		rid points at. Columns past the end of the record read
+	// 		as zeros
+	//--------------------------------------------------------------------
+	template <class KeyT>
+	void BTreeIndex<KeyT>::readPayload(const RecordId rid, char* payload){
+		Page* page;
+		bufMgr->readPage(relationFile, rid.page_number, page);
+		std::string record;
+		try {
+			record = page->getRecord(rid);
+		} catch (...) {
+			bufMgr->unPinPage(relationFile, rid.page_number, false);
+			throw;
+		}
+		bufMgr->unPinPage(relationFile, rid.page_number, false);
+
+		for (size_t i = 0; i < includedColumns.size(); i++) {
+			const IncludedColumn& column = includedColumns[i];
+			int stored = std::max(0, std::min(column.width, (int) record.size() - column.attrByteOffset));
+			memcpy(payload, record.data() + column.attrByteOffset, stored);
+			memset(payload + stored, 0, column.width - stored);
+			payload += column.width;
+		}
+	}
+
+	// bytes per key of a leaf holding keys from low to high, none if they are all the same
+	static int keyWidth(const int low, const int high, const bool compress)
+	{
+		if (!compress) return 4;
+		unsigned int range = (unsigned int) high - (unsigned int) low;
+		return (range == 0) ? 0 : (range <= 0xff) ? 1 : (range <= 0xffff) ? 2 : 4;
+	}
+
+	// bytes per record id of a leaf
+	static int ridWidth(const bool compress)
+	{
+		return compress ? PACKED_RID_SIZE : (int) sizeof(RecordId);
+	}
+
+	// number of entries a leaf over INTEGER keys holds at the given widths, with payloadBytes of
+	// included columns per entry
+	static int leafCapacity(const int keyWidth, const int ridWidth, const int payloadBytes)
+	{
+		return (NodeCapacity<int>::LEAF_BYTES - 3) / (keyWidth + ridWidth + payloadBytes);
+	}
+
+	// key width of a leaf, one of 0, 1, 2 and 4 even if the leaf is read while it changes
+	static int leafWidth(const LeafNodeInt* leaf)
+	{
+		int width = leaf->keyWidth;
+		return (width == 0 || width == 1 || width == 2) ? width : 4;
+	}
+
+	// record id width of a leaf, one of PACKED_RID_SIZE and sizeof(RecordId) even if the leaf is
+	// read while it changes
+	static int leafRidWidth(const LeafNodeInt* leaf)
+	{
+		return (leaf->ridWidth == PACKED_RID_SIZE) ? PACKED_RID_SIZE : (int) sizeof(RecordId);
+	}
+
+	// record id column of a leaf at the given widths, right after room for a full key column
+	static const char* ridColumn(const LeafNodeInt* leaf, const int keyWidth, const int ridWidth, const int payloadBytes)
+	{
+		int offset = (leafCapacity(keyWidth, ridWidth, payloadBytes) * keyWidth + 3) / 4 * 4;
+		return leaf->entries + offset;
+	}
+
+	static char* ridColumn(LeafNodeInt* leaf, const int keyWidth, const int ridWidth, const int payloadBytes)
+	{
+		return (char*) ridColumn((const LeafNodeInt*) leaf, keyWidth, ridWidth, payloadBytes);
+	}
+
+	// payload column of a leaf at the given widths, right after room for a full record id column
+	static const char* payloadColumn(const LeafNodeInt* leaf, const int keyWidth, const int ridWidth, const int payloadBytes)
+	{
+		return ridColumn(leaf, keyWidth, ridWidth, payloadBytes) + leafCapacity(keyWidth, ridWidth, payloadBytes) * ridWidth;
+	}
+
+	static char* payloadColumn(LeafNodeInt* leaf, const int keyWidth, const int ridWidth, const int payloadBytes)
+	{
+		return (char*) payloadColumn((const LeafNodeInt*) leaf, keyWidth, ridWidth, payloadBytes);
+	}
+
+	// reads the record ids begin .. end-1 of a record id column of the given width
+	static void decodeRids(const char* column, const int ridWidth, const int begin, const int end, RecordId* rids)
+	{
+		if (ridWidth == (int) sizeof(RecordId)) {
+			memcpy(rids, column + begin * sizeof(RecordId), (end - begin) * sizeof(RecordId));
+			return;
+		}
+		const char* packed = column + begin * PACKED_RID_SIZE;
+		for (int i = 0; i < end - begin; i++, packed += PACKED_RID_SIZE) {
+			memcpy(&rids[i].page_number, packed, sizeof(PageId));
+			memcpy(&rids[i].slot_number, packed + sizeof(PageId), sizeof(SlotId));
+		}
+	}
+
+	// writes numRids record ids into a record id column of the given width, from entry begin on
+	static void encodeRids(char* column, const int ridWidth, const int begin, const RecordId* rids, const int numRids)
+	{
+		if (ridWidth == (int) sizeof(RecordId)) {
+			memcpy(column + begin * sizeof(RecordId), rids, numRids * sizeof(RecordId));
+			return;
+		}
+		char* packed = column + begin * PACKED_RID_SIZE;
+		for (int i = 0; i < numRids; i++, packed += PACKED_RID_SIZE) {
+			memcpy(packed, &rids[i].page_number, sizeof(PageId));
+			memcpy(packed + sizeof(PageId), &rids[i].slot_number, sizeof(SlotId));
+		}
+	}
+
+	// position of key among the numKeys offsets of type OffsetT from keyBase of a leaf
+	template <class OffsetT>
+	static int offsetBound(const LeafNodeInt* leaf, const int numKeys, const int key, const SearchStrategy strategy, const bool upper)
+	{
+		// a key outside the frame is below or above every key of the leaf
+		long long offset = (long long) key - leaf->keyBase;
+		if (offset < 0) return 0;
+		if (offset > (long long) std::numeric_limits<OffsetT>::max()) return numKeys;
+
+		typename NodeSearch<OffsetT>::SearchFn search = upper ? NodeSearch<OffsetT>::upperBound(strategy)
+				: NodeSearch<OffsetT>::lowerBound(strategy);
+		return search((const OffsetT*) leaf->entries, numKeys, (OffsetT) offset);
+	}
+
+	// writes keys as offsets of type OffsetT from base into the key column of a leaf
+	template <class OffsetT>
+	static void encodeKeys(LeafNodeInt* leaf, const int* keys, const int numKeys, const int base)
+	{
+		OffsetT* column = (OffsetT*) leaf->entries;
+		for (int i = 0; i < numKeys; i++) {
+			column[i] = (OffsetT) ((unsigned int) keys[i] - (unsigned int) base);
+		}
+	}
+
+	// reads the key column of offsets of type OffsetT from base of a leaf back into keys. The
+	// loop has no dependence between entries, so it is vectorised into widening adds
+	template <class OffsetT>
+	static void decodeKeys(const LeafNodeInt* leaf, int* keys, const int numKeys, const int base)
+	{
+		const OffsetT* column = (const OffsetT*) leaf->entries;
+		for (int i = 0; i < numKeys; i++) {
+			keys[i] = (int) ((unsigned int) base + column[i]);
+		}
+	}
+
+	template <>
+	int BTreeIndex<int>::leafNumKeys(const LeafNodeT* leaf){
+		return std::min(std::max(leaf->numKeys, 0), leafCapacity(leafWidth(leaf), leafRidWidth(leaf), payloadBytes));
+	}
+
+	template <>
+	int BTreeIndex<int>::leafLowerBound(const LeafNodeT* leaf, const int numKeys, const int& key){
+		switch (leafWidth(leaf)) {
+			case 0: return (key <= leaf->keyBase) ? 0 : numKeys;
+			case 1: return offsetBound<unsigned char>(leaf, numKeys, key, searchStrategy, false);
+			case 2: return offsetBound<unsigned short>(leaf, numKeys, key, searchStrategy, false);
+			default: return lowerBound((const int*) leaf->entries, numKeys, key);
+		}
+	}
+
+	template <>
+	int BTreeIndex<int>::leafUpperBound(const LeafNodeT* leaf, const int numKeys, const int& key){
+		switch (leafWidth(leaf)) {
+			case 0: return (key < leaf->keyBase) ? 0 : numKeys;
+			case 1: return offsetBound<unsigned char>(leaf, numKeys, key, searchStrategy, true);
+			case 2: return offsetBound<unsigned short>(leaf, numKeys, key, searchStrategy, true);
+			default: return upperBound((const int*) leaf->entries, numKeys, key);
+		}
+	}
+
+	template <>
+	int BTreeIndex<int>::leafKey(const LeafNodeT* leaf, const int i){
+		unsigned int base = leaf->keyBase;
+		switch (leafWidth(leaf)) {
+			case 0: return (int) base;
+			case 1: return (int) (base + ((const unsigned char*) leaf->entries)[i]);
+			case 2: return (int) (base + ((const unsigned short*) leaf->entries)[i]);
+			default: return ((const int*) leaf->entries)[i];
+		}
+	}
+
+	template <>
+	RecordId BTreeIndex<int>::leafRid(const LeafNodeT* leaf, const int i){
+		RecordId rid;
+		int ridWidth = leafRidWidth(leaf);
+		decodeRids(ridColumn(leaf, leafWidth(leaf), ridWidth, payloadBytes), ridWidth, i, i + 1, &rid);
+		return rid;
+	}
+
+	template <>
+	void BTreeIndex<int>::leafRids(const LeafNodeT* leaf, const int begin, const int end, RecordId* rids){
+		int ridWidth = leafRidWidth(leaf);
+		decodeRids(ridColumn(leaf, leafWidth(leaf), ridWidth, payloadBytes), ridWidth, begin, end, rids);
+	}
+
+	template <>
+	void BTreeIndex<int>::leafPayloads(const LeafNodeT* leaf, const int begin, const int end, char* payloads){
+		const char* column = payloadColumn(leaf, leafWidth(leaf), leafRidWidth(leaf), payloadBytes);
+		memcpy(payloads, column + begin * payloadBytes, (end - begin) * payloadBytes);
+	}
+
+	template <>
+	void BTreeIndex<int>::leafEntries(const LeafNodeT* leaf, int* keys, RecordId* rids, char* payloads){
+		int width = leafWidth(leaf);
+		switch (width) {
+			case 0: std::fill(keys, keys + leaf->numKeys, leaf->keyBase); break;
+			case 1: decodeKeys<unsigned char>(leaf, keys, leaf->numKeys, leaf->keyBase); break;
+			case 2: decodeKeys<unsigned short>(leaf, keys, leaf->numKeys, leaf->keyBase); break;
+			default: memcpy(keys, leaf->entries, leaf->numKeys * sizeof(int));
+		}
+		int ridWidth = leafRidWidth(leaf);
+		decodeRids(ridColumn(leaf, width, ridWidth, payloadBytes), ridWidth, 0, leaf->numKeys, rids);
+		if (payloadBytes > 0) {
+			memcpy(payloads, payloadColumn(leaf, width, ridWidth, payloadBytes), leaf->numKeys * payloadBytes);
+		}
+	}
+
+	template <>
+	bool BTreeIndex<int>::leafFits(const int* keys, const int numKeys){
+		return numKeys == 0 || numKeys <= leafCapacity(keyWidth(keys[0], keys[numKeys-1], compressLeaves), ridWidth(compressLeaves), payloadBytes);
+	}
+
+	template <>
+	bool BTreeIndex<int>::leafFill(LeafNodeT* leaf, const int* keys, const RecordId* rids, const char* payloads, const int numKeys){
+		if (!leafFits(keys, numKeys)) return false;
+		int width = (numKeys == 0) ? 4 : keyWidth(keys[0], keys[numKeys-1], compressLeaves);
+		int base = (width == 4) ? 0 : keys[0];
+		switch (width) {
+			case 0: break;
+			case 1: encodeKeys<unsigned char>(leaf, keys, numKeys, base); break;
+			case 2: encodeKeys<unsigned short>(leaf, keys, numKeys, base); break;
+			default: memcpy(leaf->entries, keys, numKeys * sizeof(int));
+		}
+		int ridBytes = ridWidth(compressLeaves);
+		encodeRids(ridColumn(leaf, width, ridBytes, payloadBytes), ridBytes, 0, rids, numKeys);
+		if (payloadBytes > 0) {
+			memcpy(payloadColumn(leaf, width, ridBytes, payloadBytes), payloads, numKeys * payloadBytes);
+		}
+		leaf->keyBase = base;
+		leaf->keyWidth = width;
+		leaf->ridWidth = ridBytes;
+		leaf->numKeys = numKeys;
+		return true;
+	}
+
+	template <>
+	int BTreeIndex<int>::leafRoom(const LeafNodeT* leaf, const int& low, const int& high, const double fillFactor){
+		// the width is set by the smallest and largest key the leaf would hold
+		int numKeys = leaf->numKeys;
+		int width = keyWidth(numKeys == 0 ? low : std::min(low, leafKey(leaf, 0)),
+				numKeys == 0 ? high : std::max(high, leafKey(leaf, numKeys-1)), compressLeaves);
+		int capacity = leafCapacity(width, ridWidth(compressLeaves), payloadBytes);
+		int maxKeys = std::min(capacity, std::max(1, (int) (fillFactor * capacity)));
+		return maxKeys - numKeys;
+	}
+
+	template <>
+	void BTreeIndex<int>::leafInsert(LeafNodeT* leaf, const int pos, const int& key, const RecordId rid, const char* payload){
+		int width = leafWidth(leaf);
+		int ridBytes = leafRidWidth(leaf);
+		int numKeys = leaf->numKeys;
+		long long offset = (long long) key - leaf->keyBase;
+		bool inFrame = (width == 4) || (offset >= 0 && offset <= ((width == 0) ? 0 : (width == 1) ? 0xff : 0xffff));
+
+		// Case: the key fits the key column as it is, every column shifts by a slot
+		if (numKeys > 0 && inFrame && numKeys < leafCapacity(width, ridBytes, payloadBytes)) {
+			int numToShift = numKeys - pos;
+			memmove(leaf->entries + (pos + 1) * width, leaf->entries + pos * width, numToShift * width);
+			switch (width) {
+				case 0: break;
+				case 1: ((unsigned char*) leaf->entries)[pos] = (unsigned char) offset; break;
+				case 2: ((unsigned short*) leaf->entries)[pos] = (unsigned short) offset; break;
+				default: ((int*) leaf->entries)[pos] = key;
+			}
+			char* rids = ridColumn(leaf, width, ridBytes, payloadBytes);
+			memmove(rids + (pos + 1) * ridBytes, rids + pos * ridBytes, numToShift * ridBytes);
+			encodeRids(rids, ridBytes, pos, &rid, 1);
+			if (payloadBytes > 0) {
+				char* payloads = payloadColumn(leaf, width, ridBytes, payloadBytes);
+				memmove(payloads + (pos + 1) * payloadBytes, payloads + pos * payloadBytes, numToShift * payloadBytes);
+				memcpy(payloads + pos * payloadBytes, payload, payloadBytes);
+			}
+			leaf->numKeys++;
+			return;
+		}
+
+		// Case: the key is outside the frame of the leaf, or a narrower key
+		// column would make room, so the leaf is refilled at a new width
+		int keys[NodeCapacity<int>::LEAF_MAX+1];
+		RecordId rids[NodeCapacity<int>::LEAF_MAX+1];
+		char payloads[LEAF_PAYLOAD_BYTES];
+		leafEntries(leaf, keys, rids, payloads);
+		memmove(&keys[pos+1], &keys[pos], (numKeys - pos) * sizeof(int));
+		memmove(&rids[pos+1], &rids[pos], (numKeys - pos) * sizeof(RecordId));
+		memmove(&payloads[(pos+1) * payloadBytes], &payloads[pos * payloadBytes], (numKeys - pos) * payloadBytes);
+		keys[pos] = key;
+		rids[pos] = rid;
+		memcpy(&payloads[pos * payloadBytes], payload, payloadBytes);
+		leafFill(leaf, keys, rids, payloads, numKeys + 1);
+	}
+
+	template <>
+	void BTreeIndex<int>::leafRemove(LeafNodeT* leaf, const int pos){
+		// the other keys stay within the frame, so the columns just close the gap
+		int width = leafWidth(leaf);
+		int ridBytes = leafRidWidth(leaf);
+		int numToShift = leaf->numKeys - pos - 1;
+		memmove(leaf->entries + pos * width, leaf->entries + (pos + 1) * width, numToShift * width);
+		char* rids = ridColumn(leaf, width, ridBytes, payloadBytes);
+		memmove(rids + pos * ridBytes, rids + (pos + 1) * ridBytes, numToShift * ridBytes);
+		char* payloads = payloadColumn(leaf, width, ridBytes, payloadBytes);
+		memmove(payloads + pos * payloadBytes, payloads + (pos + 1) * payloadBytes, numToShift * payloadBytes);
+		leaf->numKeys--;
+	}
+
+	template <>
+	void BTreeIndex<int>::setIncludedColumns(const std::string& relationName, const IncludedColumn* columns, const int numColumns){
+		int bytes = 0;
+		for (int i = 0; i < numColumns; i++) {
+			if (columns[i].attrByteOffset < 0 || columns[i].width <= 0) {
+				throw BadIndexInfoException("Included column has a negative offset or no width");
+			}
+			bytes += columns[i].width;
+		}
+		if (numColumns > MAX_INCLUDED_COLUMNS || bytes > MAX_PAYLOAD_SIZE) {
+			throw BadIndexInfoException("Included columns do not fit in the leaves");
+		}
+
+		// the plain layout sets the occupancy every leaf is kept at
+		includedColumns.assign(columns, columns + numColumns);
+		payloadBytes = bytes;
+		leafOccupancy = leafCapacity(sizeof(int), sizeof(RecordId), payloadBytes);
+		if (numColumns > 0) {
+			relationFile = new PageFile(relationName, false);
+		}
+	}
+
+	//--------------------------------------------------------------------
+	// @brief	allocNodePage pins a page for a new node, reusing a freed
+	// 		page when there is one
+	//--------------------------------------------------------------------
+	template <class KeyT>
+	void BTreeIndex<KeyT>::allocNodePage(PageId& pageNo, Page*& page){
+		std::lock_guard<std::mutex> guard(freeListMutex);
+		if (indexMetaInfo.freePageNo == Page::INVALID_NUMBER) {
+			bufMgr->allocPage(file, pageNo, page);
+			return;
+		}
+		pageNo = indexMetaInfo.freePageNo;
+		bufMgr->readPage(file, pageNo, page);
+		indexMetaInfo.freePageNo = ((FreeNodePage*) page)->nextFreePageNo;
+	}
+
+	//--------------------------------------------------------------------
+	// @brief	freeNodePage puts a page that no longer holds a node on the
+	// 		free list, dropping it from the pinned levels if it is there
+	//--------------------------------------------------------------------
+	template <class KeyT>
+	void BTreeIndex<KeyT>::freeNodePage(PageId pageNo){
+		// a pinned page reused for another node would stay pinned for good
+		unpinNode(pageNo);
+
+		std::lock_guard<std::mutex> guard(freeListMutex);
+		Page* page;
+		bufMgr->readPage(file, pageNo, page);
+		((FreeNodePage*) page)->nextFreePageNo = indexMetaInfo.freePageNo;
+		bufMgr->unPinPage(file, pageNo, true);
+		indexMetaInfo.freePageNo = pageNo;
+	}
+
+	//--------------------------------------------------------------------
+	// @brief	writeMetaPage copies indexMetaInfo to the meta page, so
+	// 		that the index can be reopened from its file
+	//--------------------------------------------------------------------
+	template <class KeyT>
+	void BTreeIndex<KeyT>::writeMetaPage(){
+		Page* headerPage;
+		bufMgr->readPage(file, headerPageNum, headerPage);
+		{
+			std::lock_guard<std::mutex> guard(freeListMutex);
+			*(IndexMetaInfo*) headerPage = indexMetaInfo;
+		}
+		bufMgr->unPinPage(file, headerPageNum, true);
+	}
+
+	//--------------------------------------------------------------------
+	// @brief	readNode gets the frame of a node for a descent, from the
+	// 		pinned levels if it is there and otherwise pinned by the
+	// 		buffer manager
+	// isLeaf:	leaves are always pinned by the buffer manager, as
+	// 		their callers unpin them
+	// returns:	whether the frame came from the pinned levels
+	//--------------------------------------------------------------------
+	template <class KeyT>
+	bool BTreeIndex<KeyT>::readNode(PageId pageNo, Page*& page, const bool isLeaf){
+		if (isLeaf) {
+			bufMgr->readPage(file,pageNo,page);
+			return false;
+		}
+		if ((page = pinnedFrame(pageNo)) != NULL) {
+			return true;
+		}
+		readNonLeaf(pageNo, page);
+		return false;
+	}
+
+	//--------------------------------------------------------------------
+	// @brief	readNonLeaf pins a non-leaf node in the frame it was last
+	// 		read into, going through the buffer manager's hash table
+	// 		only if the node has left that frame since
+	//--------------------------------------------------------------------
+	template <class KeyT>
+	void BTreeIndex<KeyT>::readNonLeaf(PageId pageNo, Page*& page){
+		FrameId frameNo = nodeFrames[pageNo & (nodeFrames.size() - 1)].load(std::memory_order_relaxed);
+		if (bufMgr->pinFrame(file, pageNo, frameNo, page)) {
+			return;
+		}
+		bufMgr->readPage(file,pageNo,page);
+		swizzle(pageNo, page);
+	}
+
+	//--------------------------------------------------------------------
+	// @brief	peekNode gets the frame of a node for an optimistic
+	// 		descent like readNode, but looks for a non-leaf in the frame
+	// 		it was last read into first, which neither pins it nor asks
+	// 		the buffer manager
+	// version:	the latch version to validate reads of the node against
+	// 		is returned in this
+	// returns:	whether the node was read without pinning it
+	//--------------------------------------------------------------------
+	template <class KeyT>
+	bool BTreeIndex<KeyT>::peekNode(PageId pageNo, Page*& page, unsigned long& version, const bool isLeaf){
+		if (!isLeaf) {
+			FrameId frameNo = nodeFrames[pageNo & (nodeFrames.size() - 1)].load(std::memory_order_relaxed);
+			page = bufMgr->peekFrame(file, pageNo, frameNo, version);
+			if (page != NULL) {
+				return true;
+			}
+		}
+		bool pinned = readNode(pageNo, page, isLeaf);
+		version = bufMgr->pageLatch(page).readVersion();
+		return pinned;
+	}
+
+	//--------------------------------------------------------------------
+	// @brief	swizzle records the frame a non-leaf node was read into
+	//--------------------------------------------------------------------
+	template <class KeyT>
+	void BTreeIndex<KeyT>::swizzle(PageId pageNo, const Page* page){
+		nodeFrames[pageNo & (nodeFrames.size() - 1)].store(bufMgr->frameNumber(page), std::memory_order_relaxed);
+	}
+
+	//--------------------------------------------------------------------
+	// @brief	releaseNode unpins a node read with readNode or peekNode,
+	// 		unless it was read without pinning it
+	//--------------------------------------------------------------------
+	template <class KeyT>
+	void BTreeIndex<KeyT>::releaseNode(const Page* page, const bool pinned){
+		if (!pinned) {
+			bufMgr->unPinFrame(page,false);
+		}
+	}
+
+	//--------------------------------------------------------------------
+	// @brief	pinnedFrame finds the frame of a pinned page
+	// returns:	the frame, NULL if the page is not pinned
+	//--------------------------------------------------------------------
+	template <class KeyT>
+	Page* BTreeIndex<KeyT>::pinnedFrame(PageId pageNo){
+		// the table is at least twice as large as the budget, so a probe always ends on a free slot
+		size_t mask = pinnedPageNos.size() - 1;
+		for (size_t slot = (pageNo * 2654435761u) & mask; ; slot = (slot + 1) & mask) {
+			PageId slotPageNo = pinnedPageNos[slot].load(std::memory_order_acquire);
+			if (slotPageNo == pageNo) {
+				return pinnedFrames[slot];
+			}
+			if (slotPageNo == Page::INVALID_NUMBER) {
+				return NULL;
+			}
+		}
+	}
+
+	//--------------------------------------------------------------------
+	// @brief	pinNode adds a page to the pinned levels if the memory
+	// 		budget allows
+	// returns:	whether the page is pinned
+	//--------------------------------------------------------------------
+	template <class KeyT>
+	bool BTreeIndex<KeyT>::pinNode(PageId pageNo){
+		std::lock_guard<std::mutex> guard(pinMutex);
+		if (pinnedFrame(pageNo) != NULL) {
+			return true;
+		}
+		if (numPinned >= maxPinned) {
+			return false;
+		}
+
+		size_t mask = pinnedPageNos.size() - 1;
+		size_t slot = (pageNo * 2654435761u) & mask;
+		while (pinnedPageNos[slot].load(std::memory_order_relaxed) != Page::INVALID_NUMBER) {
+			slot = (slot + 1) & mask;
+		}
+		// the frame is in place before a descent can find the page number
+		bufMgr->readPage(file,pageNo,pinnedFrames[slot]);
+		swizzle(pageNo, pinnedFrames[slot]);
+		pinnedPageNos[slot].store(pageNo, std::memory_order_release);
+		numPinned++;
+		return true;
+	}
+
+	//--------------------------------------------------------------------
+	// @brief	pinTopLevels pins the nodes of the top pinnedLevels levels,
+	// 		stopping at the first level that does not fit the budget
+	//--------------------------------------------------------------------
+	template <class KeyT>
+	void BTreeIndex<KeyT>::pinTopLevels(){
+		if (indexMetaInfo.isLeaf) {
+			return;
+		}
+		PageId firstPageNo = indexMetaInfo.rootPageNo;
+		for (int depth = 0; depth < pinnedLevels; depth++) {
+			// walk the level along its right links, as far as the budget reaches
+			std::vector<PageId> pageNos;
+			PageId pageNo = firstPageNo;
+			int level = 0;
+			while (pageNo != Page::INVALID_NUMBER && numPinned + (int) pageNos.size() < maxPinned) {
+				Page* page;
+				bufMgr->readPage(file,pageNo,page);
+				NonLeafNodeT* node = (NonLeafNodeT*) page;
+				if (pageNos.empty()) {
+					firstPageNo = node->pageNoArray[0];
+				}
+				pageNos.push_back(pageNo);
+				level = node->level;
+				PageId rightPageNo = node->rightSibPageNo;
+				bufMgr->unPinPage(file,pageNo,false);
+				pageNo = rightPageNo;
+			}
+			if (pageNo != Page::INVALID_NUMBER) {
+				return;
+			}
+
+			for (size_t i = 0; i < pageNos.size(); i++) {
+				pinNode(pageNos[i]);
+			}
+			lowestPinnedLevel = level;
+			if (level == 1) {
+				return;
+			}
+		}
+	}
+
+	//--------------------------------------------------------------------
+	// @brief	unpinNode drops a page from the pinned levels, if it is
+	// 		there, and unpins it
+	//--------------------------------------------------------------------
+	template <class KeyT>
+	void BTreeIndex<KeyT>::unpinNode(PageId pageNo){
+		std::lock_guard<std::mutex> guard(pinMutex);
+		size_t mask = pinnedPageNos.size() - 1;
+		size_t slot = (pageNo * 2654435761u) & mask;
+		while (pinnedPageNos[slot].load(std::memory_order_relaxed) != pageNo) {
+			if (pinnedPageNos[slot].load(std::memory_order_relaxed) == Page::INVALID_NUMBER) {
+				return;
+			}
+			slot = (slot + 1) & mask;
+		}
+		bufMgr->unPinPage(file,pageNo,false);
+		numPinned--;
+
+		// shift later pages of the probe sequence back into the hole, so that
+		// probes for them still end before the next free slot
+		size_t hole = slot;
+		for (size_t next = (hole + 1) & mask; ; next = (next + 1) & mask) {
+			PageId nextPageNo = pinnedPageNos[next].load(std::memory_order_relaxed);
+			if (nextPageNo == Page::INVALID_NUMBER) {
+				break;
+			}
+			size_t home = (nextPageNo * 2654435761u) & mask;
+			if (((next - home) & mask) >= ((next - hole) & mask)) {
+				pinnedPageNos[hole].store(nextPageNo, std::memory_order_relaxed);
+				pinnedFrames[hole] = pinnedFrames[next];
+				hole = next;
+			}
+		}
+		pinnedPageNos[hole].store(Page::INVALID_NUMBER, std::memory_order_relaxed);
+	}
+
+	//--------------------------------------------------------------------
+	// @brief	unpinLevels unpins every pinned page
+	//--------------------------------------------------------------------
+	template <class KeyT>
+	void BTreeIndex<KeyT>::unpinLevels(){
+		for (size_t slot = 0; slot < pinnedPageNos.size(); slot++) {
+			PageId pageNo = pinnedPageNos[slot].load(std::memory_order_relaxed);
+			if (pageNo != Page::INVALID_NUMBER) {
+				bufMgr->unPinPage(file,pageNo,false);
+				pinnedPageNos[slot].store(Page::INVALID_NUMBER, std::memory_order_relaxed);
+			}
+		}
+		numPinned = 0;
+		lowestPinnedLevel = std::numeric_limits<int>::max();
+	}
+
+	//--------------------------------------------------------------------
+	// @brief	findLeafNode traverses the tree downwards from the root to
+	// 		find the leaf node that fits the given key, latch coupling
+	// 		with shared latches
+	// key:		the key to search for
+	// leafPageNo:	the page number of the leaf is returned in this
+	// exclusiveLeaf:	latch the leaf exclusive instead of shared
+	// path:	if not NULL, the non-leaf nodes passed on the way down
+	// 		are appended to it
+	// returns:	the LeafNodeT* where the key is in range, left pinned
+	// 		and latched
+	//--------------------------------------------------------------------
+	template <class KeyT>
+	typename BTreeIndex<KeyT>::LeafNodeT* BTreeIndex<KeyT>::findLeafNode(const KeyT& key, PageId& leafPageNo, const bool exclusiveLeaf, std::vector<PageId>* path){
+		// the root is latched before rootLatch is released, so it cannot
+		// be split away from under the descent
+		rootLatch.lock(false);
+		PageId pageNo = indexMetaInfo.rootPageNo;
+		bool isLeaf = indexMetaInfo.isLeaf;
+		Page* page;
+		bool pinned = readNode(pageNo, page, isLeaf);
+		bufMgr->pageLatch(page).lock(isLeaf && exclusiveLeaf);
+		rootLatch.unlock();
+
+		while (!isLeaf) {
+			NonLeafNodeT* node = (NonLeafNodeT*) page;
+			if (path != NULL) {
+				path->push_back(pageNo);
+			}
+
+			// follow the leftmost child whose subtree may contain key, so that
+			// scans starting at key never skip duplicates left of a separator
+			int i = nodeLowerBound(node, node->numKeys, key);
+			PageId childPageNo = node->pageNoArray[i];
+			isLeaf = (node->level == 1);
+
+			// latch the child before letting go of the parent
+			Page* childPage;
+			bool childPinned = readNode(childPageNo, childPage, isLeaf);
+			bufMgr->pageLatch(childPage).lock(isLeaf && exclusiveLeaf);
+			bufMgr->pageLatch(page).unlock();
+			releaseNode(page, pinned);
+
+			pageNo = childPageNo;
+			page = childPage;
+			pinned = childPinned;
+		}
+
+		leafPageNo = pageNo;
+		return (LeafNodeT*) page;
+	}
+
+	//--------------------------------------------------------------------
+	// @brief	findLeafOptimistic traverses the tree downwards from the
+	// 		root like findLeafNode, but latches nothing and restarts
+	// 		from the root whenever a node changed while being read.
+	// 		Non-leaf nodes are not pinned either when they are still
+	// 		in the frame they were last read into, see peekNode
+	// key:		the key to search for
+	// leafPageNo:	the page number of the leaf is returned in this
+	// version:	the leaf latch version the caller validates its reads
+	// 		of the leaf against is returned in this
+	// returns:	the LeafNodeT* where the key is in range, pinned only
+	//--------------------------------------------------------------------
+	template <class KeyT>
+	typename BTreeIndex<KeyT>::LeafNodeT* BTreeIndex<KeyT>::findLeafOptimistic(const KeyT& key, PageId& leafPageNo, unsigned long& version){
+		while (true) {
+			// the root must still be the root once its version is read
+			unsigned long rootVersion = rootLatch.readVersion();
+			PageId pageNo = indexMetaInfo.rootPageNo;
+			bool isLeaf = indexMetaInfo.isLeaf;
+			if (!rootLatch.validate(rootVersion)) continue;
+
+			Page* page;
+			unsigned long pageVersion;
+			bool pinned = peekNode(pageNo, page, pageVersion, isLeaf);
+			if (!rootLatch.validate(rootVersion)) {
+				releaseNode(page, pinned);
+				continue;
+			}
+
+			// whatever is read from a node is only used once its version checked out,
+			// and the child pointer in particular is only followed then
+			bool restart = false;
+			while (!isLeaf) {
+				NonLeafNodeT* node = (NonLeafNodeT*) page;
+				int numKeys = std::min(std::max(node->numKeys, 0), nodeOccupancy);
+				int i = nodeLowerBound(node, numKeys, key);
+				PageId childPageNo = node->pageNoArray[i];
+				bool childIsLeaf = (node->level == 1);
+				if (!bufMgr->pageLatch(page).validate(pageVersion)) {
+					restart = true;
+					break;
+				}
+
+				// the child covers key as long as the parent did not change
+				// before the child version was read
+				Page* childPage;
+				unsigned long childVersion;
+				bool childPinned = peekNode(childPageNo, childPage, childVersion, childIsLeaf);
+				if (!bufMgr->pageLatch(page).validate(pageVersion)) {
+					releaseNode(childPage, childPinned);
+					restart = true;
+					break;
+				}
+				releaseNode(page, pinned);
+
+				pageNo = childPageNo;
+				page = childPage;
+				pinned = childPinned;
+				pageVersion = childVersion;
+				isLeaf = childIsLeaf;
+			}
+			if (restart) {
+				releaseNode(page, pinned);
+				continue;
+			}
+
+			leafPageNo = pageNo;
+			version = pageVersion;
+			return (LeafNodeT*) page;
+		}
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::lookup
+	// -----------------------------------------------------------------------------
+
+	template <class KeyT>
+	bool BTreeIndex<KeyT>::lookup(const void* key, RecordId& outRid)
 	{
-		//std::cout << "Reached start scan pre-exception check"<< std::endl;
-		//throw necessary exceptions given bad input
-		if(*(int*)lowValParm > *(int*)highValParm){
-			//std::cout << "Throwing Bad Scan Range Exception: lowValParm|highValParm" << *(int*)lowValParm << "|" << *(int*)highValParm<< std::endl;
-			throw BadScanrangeException();
+		KeyT keyVal = KeyTraits<KeyT>::read(key);
+		int numFound;
+		// an optimistic read that saw a concurrent change starts over
+		while ((numFound = lookupEntries(keyVal, NULL, &outRid)) < 0) {
 		}
-		if(lowOpParm != GT  && lowOpParm != GTE){
-			//std::cout << "Throwing Bad OPCODES Exception"<< std::endl;
-			throw BadOpcodesException();
+		return numFound > 0;
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::lookupAll
+	// -----------------------------------------------------------------------------
+
+	template <class KeyT>
+	int BTreeIndex<KeyT>::lookupAll(const void* key, std::vector<RecordId>& outRids)
+	{
+		KeyT keyVal = KeyTraits<KeyT>::read(key);
+		outRids.clear();
+		int numFound;
+		while ((numFound = lookupEntries(keyVal, &outRids, NULL)) < 0) {
 		}
-		if(highOpParm != LT && highOpParm != LTE){
-			//std::cout << "Throwing Bad OPCODES Exception"<< std::endl;
-			throw BadOpcodesException();
+		return numFound;
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::multiGet
+	// -----------------------------------------------------------------------------
+
+	template <class KeyT>
+	int BTreeIndex<KeyT>::multiGet(const std::vector<KeyT>& keys, std::vector<RecordId>& outRids, std::vector<int>& outCounts)
+	{
+		std::vector< std::pair<KeyT, int> > probes(keys.size());
+		for (size_t i = 0; i < keys.size(); i++) {
+			probes[i] = std::make_pair(keys[i], (int) i);
+		}
+		std::sort(probes.begin(), probes.end());
+
+		std::vector< std::pair<int, RecordId> > matches;
+		if (!probes.empty()) {
+			// a root split after this point leaves the old root as the first
+			// node of its level, from which the probes still move right
+			PageId rootPageNo;
+			bool rootIsLeaf;
+			rootLatch.lock(false);
+			rootPageNo = indexMetaInfo.rootPageNo;
+			rootIsLeaf = indexMetaInfo.isLeaf;
+			rootLatch.unlock();
+			multiGetNodes(rootPageNo, rootIsLeaf, probes, 0, (int) probes.size(), Page::INVALID_NUMBER, matches);
 		}
 
-		//std::cout << "Reached start scan (no badOpcodes or bad scanrange)"<< std::endl;
-
-		scanExecuting = true;
-		lowValInt = *((int*) lowValParm);
-		highValInt = *((int*) highValParm);
-		// lowOp = lowOpParm;
-		// highOp = highOpParm;
-
-		//std::cout << "Successfully set the global scan variables: " << "LowVal|HighVal|LowOp|HighOp -" << lowValInt << "|" << highValInt << "|" << lowOpParm << "|" << highOpParm << "|"<< std::endl;
-
-		if(lowOpParm == GT){
-			LeafNodeInt* currPage = findLeafNode(lowValInt + 1, indexMetaInfo.rootPageNo);
-			currentPageData = (Page*) currPage;
-			//std::cout << "b4 current page number"<< std::endl;
-			currentPageNum = foundLeafPageNo;
-			//std::cout << "after current page number"<< std::endl;
-			//std::cout << "currPage->numKeys"<< currPage->numKeys << std::endl;
-			for(int i = 0; i < currPage->numKeys; i++){
-				//std::cout << "Setting next entry" << std::endl;
-				if(currPage->keyArray[i] > lowValInt){
-					nextEntry = i;
-					//std::cout << "NextEntry set to: " << nextEntry << std::endl;
-					break;
+		// group the matches by key, in the order the keys were given
+		outCounts.assign(keys.size(), 0);
+		for (size_t i = 0; i < matches.size(); i++) {
+			outCounts[matches[i].first]++;
+		}
+		std::vector<int> offsets(keys.size());
+		int total = 0;
+		for (size_t i = 0; i < keys.size(); i++) {
+			offsets[i] = total;
+			total += outCounts[i];
+		}
+		outRids.resize(total);
+		for (size_t i = 0; i < matches.size(); i++) {
+			outRids[offsets[matches[i].first]++] = matches[i].second;
+		}
+		return total;
+	}
+
+	//--------------------------------------------------------------------
+	// @brief	multiGetNodes looks up a sorted run of probes in the
+	// 		subtree of a node and in the nodes right of it at the same
+	// 		level that the later probes have moved to, latching one
+	// 		node at a time like B_LINK mode in every read mode
+	// probes:	the sorted (key, position in the batch) pairs
+	// first, last:	the run of probes to look up
+	// nextPageNo:	the node the caller looks up the probes from last on
+	// 		in next, or INVALID_NUMBER. Probes that move right to it
+	// 		are handed back rather than followed, so that it is
+	// 		pinned once
+	// matches:	(position, record id) of every entry found are appended
+	// 		to it
+	// return:	the first probe handed back, last if there are none
+	//--------------------------------------------------------------------
+	template <class KeyT>
+	int BTreeIndex<KeyT>::multiGetNodes(PageId pageNo, bool isLeaf, const std::vector< std::pair<KeyT, int> >& probes,
+			int first, int last, PageId nextPageNo, std::vector< std::pair<int, RecordId> >& matches){
+		bool optimistic = (readMode == OPTIMISTIC_LOCK_COUPLING);
+		// (child, first probe) of every child some probes go down to
+		std::vector< std::pair<PageId, int> > children;
+		while (first < last) {
+			Page* page;
+			bool pinned = readNode(pageNo, page, isLeaf);
+			size_t numMatches = matches.size();
+			PageId rightSibPageNo;
+			bool childrenAreLeaves = false;
+			int rightFirst;
+			while (true) {
+				unsigned long version = 0;
+				if (optimistic) {
+					version = bufMgr->pageLatch(page).readVersion();
+				} else {
+					bufMgr->pageLatch(page).lock(false);
+				}
+				children.clear();
+				matches.resize(numMatches);
+
+				if (isLeaf) {
+					LeafNodeT* leaf = (LeafNodeT*) page;
+					int numKeys = leafNumKeys(leaf);
+					rightSibPageNo = leaf->rightSibPageNo;
+					// probes from the high key on may also have entries further right
+					rightFirst = last;
+					for (int i = first; i < last; i++) {
+						const KeyT& key = probes[i].first;
+						if (rightSibPageNo != Page::INVALID_NUMBER && rightFirst == last && !(key < leaf->highKey)) {
+							rightFirst = i;
+						}
+						int begin = leafLowerBound(leaf, numKeys, key);
+						int end = leafUpperBound(leaf, numKeys, key);
+						for (int j = begin; j < end; j++) {
+							matches.push_back(std::make_pair(probes[i].second, leafRid(leaf, j)));
+						}
+					}
+				} else {
+					NonLeafNodeT* node = (NonLeafNodeT*) page;
+					int numKeys = std::min(std::max(node->numKeys, 0), nodeOccupancy);
+					rightSibPageNo = node->rightSibPageNo;
+					childrenAreLeaves = (node->level == 1);
+					// probes past the high key belong to a node that split off this one
+					rightFirst = last;
+					for (int i = first; i < last; i++) {
+						const KeyT& key = probes[i].first;
+						if (rightSibPageNo != Page::INVALID_NUMBER && node->highKey < key) {
+							rightFirst = i;
+							break;
+						}
+						PageId childPageNo = node->pageNoArray[nodeLowerBound(node, numKeys, key)];
+						if (children.empty() || children.back().first != childPageNo) {
+							children.push_back(std::make_pair(childPageNo, i));
+						}
+					}
+				}
+
+				bool valid = true;
+				if (optimistic) {
+					valid = bufMgr->pageLatch(page).validate(version);
+				} else {
+					bufMgr->pageLatch(page).unlock();
 				}
+				if (valid) break;
 			}
+			releaseNode(page, pinned);
+
+			// every child was read off a node that is no longer latched, so a
+			// child that split since moves the later probes right in turn. Those
+			// that reach the next child, such as a probe equal to the separator
+			// between the two, are looked up there with its own
+			int carried = rightFirst;
+			for (size_t c = 0; c < children.size(); c++) {
+				bool lastChild = (c + 1 == children.size());
+				int childFirst = std::min(children[c].second, carried);
+				int childLast = lastChild ? rightFirst : children[c+1].second;
+				PageId nextChildPageNo = lastChild ? Page::INVALID_NUMBER : children[c+1].first;
+				carried = multiGetNodes(children[c].first, childrenAreLeaves, probes, childFirst, childLast, nextChildPageNo, matches);
+			}
+
+			if (rightFirst < last && rightSibPageNo == nextPageNo) {
+				return rightFirst;
+			}
+			pageNo = rightSibPageNo;
+			first = rightFirst;
 		}
-		else if(lowOpParm == GTE){
-			LeafNodeInt* currPage = findLeafNode(lowValInt, indexMetaInfo.rootPageNo);
-			currentPageData = (Page*) currPage;
-			currentPageNum = foundLeafPageNo;//((Page*) currPage)->page_number();
-			for(int i = 0; i < currPage->numKeys; i++){
-				if(currPage->keyArray[i] >= lowValInt){
-					nextEntry = i;
-					//std::cout << "NextEntry set to: " << nextEntry << std::endl;
-					break;
+		return last;
+	}
+
+	//--------------------------------------------------------------------
+	// @brief	lookupEntries copies the record ids of the entries with
+	// 		key, moving right while equal keys may continue into the
+	// 		next leaf. Every leaf is released before returning
+	// outRids:	if not NULL, all matches are appended to it
+	// firstRid:	if outRids is NULL, the first match is returned in this
+	// returns:	the number of matches, or -1 if an optimistic read
+	// 		has to be retried, outRids then being left as it was
+	//--------------------------------------------------------------------
+	template <class KeyT>
+	int BTreeIndex<KeyT>::lookupEntries(const KeyT& key, std::vector<RecordId>* outRids, RecordId* firstRid){
+		bool optimistic = (readMode == OPTIMISTIC_LOCK_COUPLING);
+		PageId pageNo;
+		unsigned long version = 0;
+		LeafNodeT* currPage;
+		if (optimistic) {
+			currPage = findLeafOptimistic(key, pageNo, version);
+		} else if (readMode == B_LINK) {
+			currPage = (LeafNodeT*) descendBlink(key, 0, pageNo, false, NULL);
+		} else {
+			currPage = findLeafNode(key, pageNo, false, NULL);
+		}
+
+		size_t numBefore = (outRids != NULL) ? outRids->size() : 0;
+		int numFound = 0;
+		while (true) {
+			int numKeys = leafNumKeys(currPage);
+			int begin = leafLowerBound(currPage, numKeys, key);
+			int end = leafUpperBound(currPage, numKeys, key);
+			if (end > begin) {
+				if (outRids != NULL) {
+					size_t numCopied = outRids->size();
+					outRids->resize(numCopied + (end - begin));
+					leafRids(currPage, begin, end, &(*outRids)[numCopied]);
+				} else if (numFound == 0) {
+					*firstRid = leafRid(currPage, begin);
 				}
+				numFound += end - begin;
+			}
+			// the right sibling starts at the high key, so it can only hold key too
+			// if this leaf ends with it, or a delete left the separator behind
+			PageId rightSibPageNo = currPage->rightSibPageNo;
+			bool more = (outRids != NULL || numFound == 0) && end == numKeys
+					&& rightSibPageNo != Page::INVALID_NUMBER && !(key < currPage->highKey);
+
+			bool valid = true;
+			if (optimistic) {
+				valid = bufMgr->pageLatch((Page*) currPage).validate(version);
+			} else {
+				bufMgr->pageLatch((Page*) currPage).unlock();
+			}
+			bufMgr->unPinPage(file, pageNo, false);
+			if (!valid) {
+				if (outRids != NULL) outRids->resize(numBefore);
+				return -1;
+			}
+			if (!more) return numFound;
+
+			Page* bufMgrPage;
+			bufMgr->readPage(file,rightSibPageNo,bufMgrPage);
+			if (optimistic) {
+				version = bufMgr->pageLatch(bufMgrPage).readVersion();
+			} else {
+				bufMgr->pageLatch(bufMgrPage).lock(false);
 			}
+			currPage = (LeafNodeT*) bufMgrPage;
+			pageNo = rightSibPageNo;
 		}
 	}
 
 	// -----------------------------------------------------------------------------
-	// BTreeIndex::scanNext
+	// BTreeIndex::startScan
 	// -----------------------------------------------------------------------------
 
-	const void BTreeIndex::scanNext(RecordId& outRid)
+	template <class KeyT>
+	const void BTreeIndex<KeyT>::startScan(const void* lowValParm,
+					const Operator lowOpParm,
+					const void* highValParm,
+					const Operator highOpParm,
+					const ScanDirection direction)
 	{
-		//std::cout << "Entered ScanNext()" << nextEntry << std::endl;
+		//only one scan at a time per thread, the cursor ends the previous one
+		BTreeScanCursor<KeyT>& cursor = bindThreadCursor();
+		try {
+			cursor.startScan(lowValParm, lowOpParm, highValParm, highOpParm, direction);
+		} catch (...) {
+			//a scan that did not start leaves the cursor free for other threads
+			if (!cursor.isExecuting()) releaseThreadCursor(&cursor);
+			throw;
+		}
+	}
+
+	//--------------------------------------------------------------------
+	// @brief	positionScan finds the first leaf holding an entry past
+	// 		the low bound, or for a backward scan the last leaf that
+	// 		may hold one within the high bound, copying its matching
+	// 		record ids into cursor.
+	// 		Returns false if an optimistic read has to be retried.
+	//--------------------------------------------------------------------
+	template <class KeyT>
+	bool BTreeIndex<KeyT>::positionScan(BTreeScanCursor<KeyT>& cursor){
+		bool optimistic = (readMode == OPTIMISTIC_LOCK_COUPLING);
+		const KeyT& searchKey = cursor.backward ? cursor.highVal : cursor.lowVal;
+		PageId pageNo;
+		unsigned long version = 0;
+		LeafNodeT* currPage;
+		if (optimistic) {
+			currPage = findLeafOptimistic(searchKey, pageNo, version);
+		} else if (readMode == B_LINK) {
+			currPage = (LeafNodeT*) descendBlink(searchKey, 0, pageNo, false, NULL);
+		} else {
+			currPage = findLeafNode(searchKey, pageNo, false, NULL);
+		}
+
+		// walk right until the first key that satisfies the low bound, or
+		// backward, as long as the next leaf may still hold keys within the
+		// high bound, since equal keys can continue past the leaf searched for
+		while (true) {
+			int numKeys = leafNumKeys(currPage);
+			bool found;
+			if (!cursor.backward) {
+				int start;
+				if (cursor.lowOp == GTE) {
+					start = leafLowerBound(currPage, numKeys, cursor.lowVal);
+				} else {
+					start = leafUpperBound(currPage, numKeys, cursor.lowVal);
+				}
+				found = (start < numKeys);
+			} else {
+				int end;
+				if (cursor.highOp == LT) {
+					end = leafLowerBound(currPage, numKeys, cursor.highVal);
+				} else {
+					end = leafUpperBound(currPage, numKeys, cursor.highVal);
+				}
+				bool rightInRange = (cursor.highOp == LT) ? currPage->highKey < cursor.highVal
+						: !(cursor.highVal < currPage->highKey);
+				found = (end < numKeys || currPage->rightSibPageNo == Page::INVALID_NUMBER || !rightInRange);
+			}
+			if (found) {
+				fillScan(cursor, currPage, pageNo, true);
+			}
+			PageId rightSibPageNo = currPage->rightSibPageNo;
 
-		LeafNodeInt* currentLeafNode = (LeafNodeInt*)currentPageData;
+			bool valid = true;
+			if (optimistic) {
+				valid = bufMgr->pageLatch((Page*) currPage).validate(version);
+			} else {
+				bufMgr->pageLatch((Page*) currPage).unlock();
+			}
+			bufMgr->unPinPage(file, pageNo, false);
+			if (!valid) return false;
+			if (found) return true;
 
-		//if the next entry is larger than the keys in the array, a new page is needed
-		if (nextEntry == currentLeafNode->numKeys) {
-			bufMgr->unPinPage(file,currentPageNum,true);
-			currentPageNum = currentLeafNode->rightSibPageNo;
+			if (rightSibPageNo == Page::INVALID_NUMBER) {
+				throw NoSuchKeyFoundException();
+			}
 			Page* bufMgrPage;
-			bufMgr->readPage(file,currentLeafNode->rightSibPageNo,bufMgrPage);
-			currentPageData = bufMgrPage; // &file->readPage(currentLeafNode->rightSibPageNo);
-			currentLeafNode = (LeafNodeInt*) currentPageData;
-			nextEntry = 0;
+			bufMgr->readPage(file,rightSibPageNo,bufMgrPage);
+			if (optimistic) {
+				version = bufMgr->pageLatch(bufMgrPage).readVersion();
+			} else {
+				bufMgr->pageLatch(bufMgrPage).lock(false);
+			}
+			currPage = (LeafNodeT*) bufMgrPage;
+			pageNo = rightSibPageNo;
+		}
+	}
+
+	//--------------------------------------------------------------------
+	// @brief	fillScan copies the record ids of a leaf that fall within
+	// 		the scan bounds into the cursor, in scan order. The leaf
+	// 		is either latched or read optimistically, in which case
+	// 		numKeys may be torn and is kept within the leaf capacity
+	// 		by leafNumKeys
+	// first:	true for the leaf the scan starts in. The leaves after
+	// 		it only need to be checked against the far bound
+	//--------------------------------------------------------------------
+	template <class KeyT>
+	void BTreeIndex<KeyT>::fillScan(BTreeScanCursor<KeyT>& cursor, LeafNodeT* leaf, PageId pageNo, const bool first){
+		int numKeys = leafNumKeys(leaf);
+		int begin = 0;
+		if (first || cursor.backward) {
+			if (cursor.lowOp == GTE) {
+				begin = leafLowerBound(leaf, numKeys, cursor.lowVal);
+			} else {
+				begin = leafUpperBound(leaf, numKeys, cursor.lowVal);
+			}
+		}
+		int end = numKeys;
+		if (first || !cursor.backward) {
+			if (cursor.highOp == LT) {
+				end = leafLowerBound(leaf, numKeys, cursor.highVal);
+			} else {
+				end = leafUpperBound(leaf, numKeys, cursor.highVal);
+			}
+		}
+		end = std::max(begin, end);
+
+		cursor.numRids = end - begin;
+		cursor.nextEntry = 0;
+		cursor.currPageNum = pageNo;
+		leafRids(leaf, begin, end, cursor.rids);
+		if (payloadBytes > 0) {
+			leafPayloads(leaf, begin, end, cursor.payloads);
 		}
-		if (currentLeafNode == NULL) {
-			throw IndexScanCompletedException();
+		if (!cursor.backward) {
+			// a key past the high bound in this leaf ends the scan here
+			cursor.nextPageNum = (end < numKeys) ? Page::INVALID_NUMBER : leaf->rightSibPageNo;
+		} else {
+			std::reverse(cursor.rids, cursor.rids + cursor.numRids);
+			for (int i = 0, j = cursor.numRids - 1; payloadBytes > 0 && i < j; i++, j--) {
+				std::swap_ranges(&cursor.payloads[i * payloadBytes], &cursor.payloads[(i + 1) * payloadBytes], &cursor.payloads[j * payloadBytes]);
+			}
+			// and a key before the low bound does for a backward scan
+			cursor.nextPageNum = (begin > 0) ? Page::INVALID_NUMBER : leaf->leftSibPageNo;
 		}
+	}
 
-		int currentKey = currentLeafNode->keyArray[nextEntry];
+	//--------------------------------------------------------------------
+	// @brief	advanceScan copies the matching record ids of the leaf
+	// 		the cursor moves on to. Moving left, a leaf that split
+	// 		since its page number was read is followed right to the
+	// 		leaf just before the one the cursor came from
+	//--------------------------------------------------------------------
+	template <class KeyT>
+	void BTreeIndex<KeyT>::advanceScan(BTreeScanCursor<KeyT>& cursor){
+		bool optimistic = (readMode == OPTIMISTIC_LOCK_COUPLING);
+		PageId fromPageNo = cursor.currPageNum;
+		PageId pageNo = cursor.nextPageNum;
+		while (true) {
+			Page* bufMgrPage;
+			bufMgr->readPage(file,pageNo,bufMgrPage);
+			LeafNodeT* leaf = (LeafNodeT*) bufMgrPage;
+			unsigned long version = 0;
+			if (optimistic) {
+				version = bufMgr->pageLatch(bufMgrPage).readVersion();
+			} else {
+				bufMgr->pageLatch(bufMgrPage).lock(false);
+			}
 
-		//get the next recordId on the current page
-		if (highOp == LT) {
-			if (currentKey < highValInt) {
-				outRid = currentLeafNode->ridArray[nextEntry];
-				nextEntry++;
+			PageId rightSibPageNo = leaf->rightSibPageNo;
+			bool adjacent = !cursor.backward || rightSibPageNo == fromPageNo
+					|| rightSibPageNo == Page::INVALID_NUMBER;
+			if (adjacent) {
+				fillScan(cursor, leaf, pageNo, false);
 			}
-			else {
-				throw IndexScanCompletedException();
+
+			bool valid = true;
+			if (optimistic) {
+				valid = bufMgr->pageLatch(bufMgrPage).validate(version);
+			} else {
+				bufMgr->pageLatch(bufMgrPage).unlock();
 			}
+			bufMgr->unPinPage(file,pageNo,false);
+			// the page number stays valid, so only the read of the leaf is retried
+			if (!valid) continue;
+			if (adjacent) return;
+			pageNo = rightSibPageNo;
 		}
-		else if (highOp == LTE) {
-			if (currentKey <= highValInt) {
-				outRid = currentLeafNode->ridArray[nextEntry];
-				nextEntry++;
-			} else {
-				throw IndexScanCompletedException();
+	}
+
+	//--------------------------------------------------------------------
+	// @brief	findThreadCursor returns the cursor bound to the calling
+	// 		thread on this index, or NULL if it has none
+	//--------------------------------------------------------------------
+	template <class KeyT>
+	BTreeScanCursor<KeyT>* BTreeIndex<KeyT>::findThreadCursor(){
+		LastThreadCursor& last = lastThreadCursor();
+		if (last.indexId == indexId) {
+			return last.cursor;
+		}
+
+		std::lock_guard<std::mutex> guard(scanMutex);
+		std::thread::id thread = std::this_thread::get_id();
+		for (size_t i = 0; i < threadScans.size(); i++) {
+			if (threadScans[i].first == thread) {
+				last.indexId = indexId;
+				last.cursor = threadScans[i].second;
+				return last.cursor;
+			}
+		}
+		return NULL;
+	}
+
+	//--------------------------------------------------------------------
+	// @brief	threadCursor returns the cursor behind the scan the
+	// 		calling thread runs through startScan on this index,
+	// 		throwing ScanNotInitializedException if it has none
+	//--------------------------------------------------------------------
+	template <class KeyT>
+	BTreeScanCursor<KeyT>& BTreeIndex<KeyT>::threadCursor(){
+		BTreeScanCursor<KeyT>* cursor = findThreadCursor();
+		if (cursor == NULL) {
+			throw ScanNotInitializedException();
+		}
+		return *cursor;
+	}
+
+	//--------------------------------------------------------------------
+	// @brief	bindThreadCursor returns the cursor bound to the calling
+	// 		thread, binding a free or new one if it has none
+	//--------------------------------------------------------------------
+	template <class KeyT>
+	BTreeScanCursor<KeyT>& BTreeIndex<KeyT>::bindThreadCursor(){
+		BTreeScanCursor<KeyT>* cursor = findThreadCursor();
+		if (cursor != NULL) {
+			return *cursor;
+		}
+
+		std::lock_guard<std::mutex> guard(scanMutex);
+		if (freeCursors.empty()) {
+			cursor = new BTreeScanCursor<KeyT>(this);
+		} else {
+			cursor = freeCursors.back();
+			freeCursors.pop_back();
+		}
+		threadScans.push_back(ThreadScan(std::this_thread::get_id(), cursor));
+
+		LastThreadCursor& last = lastThreadCursor();
+		last.indexId = indexId;
+		last.cursor = cursor;
+		return *cursor;
+	}
+
+	//--------------------------------------------------------------------
+	// @brief	releaseThreadCursor returns the cursor bound to the
+	// 		calling thread to freeCursors
+	//--------------------------------------------------------------------
+	template <class KeyT>
+	void BTreeIndex<KeyT>::releaseThreadCursor(BTreeScanCursor<KeyT>* cursor){
+		std::lock_guard<std::mutex> guard(scanMutex);
+		for (size_t i = 0; i < threadScans.size(); i++) {
+			if (threadScans[i].second == cursor) {
+				threadScans[i] = threadScans.back();
+				threadScans.pop_back();
+				break;
 			}
 		}
+		freeCursors.push_back(cursor);
 
+		// the cursor may be bound to another thread next
+		LastThreadCursor& last = lastThreadCursor();
+		if (last.indexId == indexId) {
+			last.indexId = 0;
+			last.cursor = NULL;
+		}
+	}
+
+	//--------------------------------------------------------------------
+	// @brief	lastThreadCursor is the cursor the calling thread last
+	// 		found or bound, with the indexId of its index
+	//--------------------------------------------------------------------
+	template <class KeyT>
+	typename BTreeIndex<KeyT>::LastThreadCursor& BTreeIndex<KeyT>::lastThreadCursor(){
+		static thread_local LastThreadCursor last = { 0, NULL };
+		return last;
 	}
 
 	// -----------------------------------------------------------------------------
-	// BTreeIndex::endScan
+	// BTreeIndex::scanNext
 	// -----------------------------------------------------------------------------
-	//
-	const void BTreeIndex::endScan()
+
+	template <class KeyT>
+	const void BTreeIndex<KeyT>::scanNext(RecordId& outRid)
 	{
-		//throws ScanNotInitializedException if the scan hasn't been started yet
-		if (!scanExecuting) throw ScanNotInitializedException();
-		scanExecuting = false;
-		//unpins the page associated with the scan
-		bufMgr->unPinPage(file, currentPageNum, false);
+		threadCursor().scanNext(outRid);
+	}
+
+	template <class KeyT>
+	const void BTreeIndex<KeyT>::scanNext(RecordId& outRid, void* outPayload)
+	{
+		threadCursor().scanNext(outRid, outPayload);
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::scanNextBatch
+	// -----------------------------------------------------------------------------
 
-		nextEntry = NULL;
-		lowValInt = NULL;
-		highValInt = NULL;
-		// lowOp = NULL;
-		// highOp = NULL;
+	template <class KeyT>
+	bool BTreeIndex<KeyT>::scanNextBatch(std::vector<RecordId>& outRids, const int maxCount)
+	{
+		return threadCursor().scanNextBatch(outRids, maxCount);
+	}
 
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::endScan
+	// -----------------------------------------------------------------------------
+	//
+	template <class KeyT>
+	const void BTreeIndex<KeyT>::endScan()
+	{
+		BTreeScanCursor<KeyT>& cursor = threadCursor();
+		cursor.endScan();
+		releaseThreadCursor(&cursor);
 	}
 
-	const void BTreeIndex::PrintTree(PageId pageNum, bool IsLeaf)
+	template <class KeyT>
+	const void BTreeIndex<KeyT>::PrintTree(PageId pageNum, bool IsLeaf)
 	{
 		if (IsLeaf) { //base case
 
-			LeafNodeInt* leaf;
+			LeafNodeT* leaf;
 
 			bufMgr->readPage(file,pageNum,(Page*&)leaf);
 
 			std::cout << ""<< std::endl;
 			std::cout << "------------------------------------------------------------------------------"<< std::endl;
 
-			std::cout << "LeafPage: " << pageNum << " NumKeys: " << leaf->numKeys << " Parent: " << leaf->parent << std::endl;
+			std::cout << "LeafPage: " << pageNum << " NumKeys: " << leaf->numKeys << std::endl;
 			std::cout << "Printing Key Array: ";
 
-			for (int i = 0; i < INTARRAYLEAFSIZE; i++) {
-				std::cout << " " << leaf->keyArray[i] << " " << "|";
+			for (int i = 0; i < leaf->numKeys; i++) {
+				std::cout << " " << leafKey(leaf, i) << " " << "|";
 			}
 			std::cout << std::endl;
 
 			std::cout << "Printing RID Array: ";
 
-			for (int i = 0; i < INTARRAYLEAFSIZE; i++) {
-				std::cout << leaf->ridArray[i].page_number << "-" << leaf->ridArray[i].slot_number << "|";
+			for (int i = 0; i < leaf->numKeys; i++) {
+				RecordId rid = leafRid(leaf, i);
+				std::cout << rid.page_number << "-" << rid.slot_number << "|";
 			}
 			std::cout << std::endl;
 
 			std::cout << "------------------------------------------------------------------------------"<< std::endl;
 			std::cout << ""<< std::endl;
 
-			bufMgr->unPinPage(file,pageNum,true);
+			bufMgr->unPinPage(file,pageNum,false);
 		} else {
-			NonLeafNodeInt* nonleaf;
+			NonLeafNodeT* nonleaf;
 
 			bufMgr->readPage(file,pageNum,(Page*&)nonleaf);
 
 			std::cout << ""<< std::endl;
 			std::cout << "------------------------------------------------------------------------------"<< std::endl;
 
-			std::cout << "NonLeafPage: " << pageNum << " NumKeys: " << nonleaf->numKeys << " Parent: " << nonleaf->parent << " Level: " << nonleaf->level << std::endl;
+			std::cout << "NonLeafPage: " << pageNum << " NumKeys: " << nonleaf->numKeys << " Level: " << nonleaf->level << std::endl;
 
 			std::cout << "Printing Key Array: ";
 
-			for (int i = 0; i < INTARRAYLEAFSIZE; i++) {
-				std::cout << nonleaf->keyArray[i] << "|";
+			for (int i = 0; i < nonleaf->numKeys; i++) {
+				std::cout << nodeKey(nonleaf, i) << "|";
 			}
 			std::cout << std::endl;
 
 			std::cout << "Printing PageNoArray Array: ";
 
-			for (int i = 0; i < INTARRAYLEAFSIZE+1; i++) {
-				std::cout << nonleaf->pageNoArray << "|";
+			for (int i = 0; i < nonleaf->numKeys+1; i++) {
+				std::cout << nonleaf->pageNoArray[i] << "|";
 			}
 			std::cout << std::endl;
 
 			std::cout << "------------------------------------------------------------------------------"<< std::endl;
 			std::cout << ""<< std::endl;
 
-			if (nonleaf->level == 1) {
-
-				for (int i = 0; i < INTARRAYLEAFSIZE+1; i++) {
-					
-					PrintTree(nonleaf->pageNoArray[i],true);
-				}
-				bufMgr->unPinPage(file,pageNum,true);
+			// children are printed after the parent is unpinned, so the
+			// recursion holds at most one pin per level
+			int numChildren = nonleaf->numKeys + 1;
+			int level = nonleaf->level;
+			PageId children[NodeCapacity<KeyT>::NONLEAF + 1];
+			for (int i = 0; i < numChildren; i++) {
+				children[i] = nonleaf->pageNoArray[i];
 			}
-			else if (nonleaf->level == 0) {
-				for (int i = 0; i < INTARRAYLEAFSIZE+1; i++) {
-					
-					PrintTree(nonleaf->pageNoArray[i],false);
+			bufMgr->unPinPage(file,pageNum,false);
+
+			if (level >= 1) {
+				for (int i = 0; i < numChildren; i++) {
+					PrintTree(children[i], level == 1);
 				}
-				bufMgr->unPinPage(file,pageNum,true);
 			}
 			else {
 				std::cout << "LEVEL ERROR NON LEAF PAGE: " << pageNum << std::endl;
-				bufMgr->unPinPage(file,pageNum,true);
 			}
 		}
 	}
 
+	template <class KeyT>
+	void BTreeIndex<KeyT>::setSearchStrategy(const SearchStrategy strategy)
+	{
+		searchStrategy = strategy;
+		lowerBound = NodeSearch<KeyT>::lowerBound(strategy);
+		upperBound = NodeSearch<KeyT>::upperBound(strategy);
+	}
+
+	template <class KeyT>
+	void BTreeIndex<KeyT>::setReadMode(const ReadMode mode)
+	{
+		readMode = mode;
+	}
+
+	template <class KeyT>
+	void BTreeIndex<KeyT>::setPinnedLevels(const int levels, const size_t memoryBudget)
+	{
+		unpinLevels();
+		pinnedLevels = std::max(levels, 0);
+		maxPinned = (pinnedLevels > 0) ? (int) (memoryBudget / Page::SIZE) : 0;
+
+		size_t numSlots = 2;
+		while (numSlots < 2 * (size_t) maxPinned) {
+			numSlots *= 2;
+		}
+		std::vector< std::atomic<PageId> >(numSlots).swap(pinnedPageNos);
+		pinnedFrames.assign(numSlots, NULL);
+		pinTopLevels();
+	}
+
+	template <class KeyT>
+	int BTreeIndex<KeyT>::getHeight()
+	{
+		rootLatch.lock(false);
+		PageId pageNo = indexMetaInfo.rootPageNo;
+		bool isLeaf = indexMetaInfo.isLeaf;
+		rootLatch.unlock();
+		if (isLeaf) {
+			return 1;
+		}
+
+		// the root knows how many levels are below it
+		Page* bufMgrPage;
+		bufMgr->readPage(file,pageNo,bufMgrPage);
+		bufMgr->pageLatch(bufMgrPage).lock(false);
+		int level = ((NonLeafNodeT*) bufMgrPage)->level;
+		bufMgr->pageLatch(bufMgrPage).unlock();
+		bufMgr->unPinPage(file,pageNo,false);
+		return level + 1;
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::getPinnedNodes
+	// -----------------------------------------------------------------------------
+
+	template <class KeyT>
+	int BTreeIndex<KeyT>::getPinnedNodes()
+	{
+		std::lock_guard<std::mutex> guard(pinMutex);
+		return numPinned;
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::getBuildStats
+	// -----------------------------------------------------------------------------
+
+	template <class KeyT>
+	const IndexBuildStats& BTreeIndex<KeyT>::getBuildStats() const
+	{
+		return buildStats;
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeIndex::getPayloadSize
+	// -----------------------------------------------------------------------------
+
+	template <class KeyT>
+	int BTreeIndex<KeyT>::getPayloadSize() const
+	{
+		return payloadBytes;
+	}
+
+	// -----------------------------------------------------------------------------
+	// BTreeScanCursor
+	// -----------------------------------------------------------------------------
+
+	template <class KeyT>
+	BTreeScanCursor<KeyT>::BTreeScanCursor(BTreeIndex<KeyT>* indexIn)
+	{
+		index = indexIn;
+		executing = false;
+		nextEntry = 0;
+		numRids = 0;
+		nextPageNum = Page::INVALID_NUMBER;
+		currPageNum = Page::INVALID_NUMBER;
+		backward = false;
+	}
+
+	template <class KeyT>
+	const void BTreeScanCursor<KeyT>::startScan(const void* lowValParm,
+					const Operator lowOpParm,
+					const void* highValParm,
+					const Operator highOpParm,
+					const ScanDirection direction)
+	{
+		//throw necessary exceptions given bad input
+		if(lowOpParm != GT  && lowOpParm != GTE){
+			throw BadOpcodesException();
+		}
+		if(highOpParm != LT && highOpParm != LTE){
+			throw BadOpcodesException();
+		}
+		KeyT lowKey = KeyTraits<KeyT>::read(lowValParm);
+		KeyT highKey = KeyTraits<KeyT>::read(highValParm);
+		if(highKey < lowKey){
+			throw BadScanrangeException();
+		}
+
+		//only one scan at a time per cursor
+		if (executing) endScan();
+
+		lowVal = lowKey;
+		lowOp = lowOpParm;
+		highVal = highKey;
+		highOp = highOpParm;
+		backward = (direction == BACKWARD);
+
+		// an optimistic read that saw a concurrent change starts over
+		while (!index->positionScan(*this)) {
+		}
+
+		// going backward, the leaf searched for may hold only keys above the
+		// high bound, the first matching entry then being further left
+		while (numRids == 0 && nextPageNum != Page::INVALID_NUMBER) {
+			index->advanceScan(*this);
+		}
+
+		// the first candidate must also satisfy the far bound
+		if (numRids == 0) {
+			throw NoSuchKeyFoundException();
+		}
+
+		executing = true;
+	}
+
+	template <class KeyT>
+	const void BTreeScanCursor<KeyT>::scanNext(RecordId& outRid)
+	{
+		if (!executing) throw ScanNotInitializedException();
+
+		//once the record ids copied from a leaf are used up, copy those of its right sibling
+		while (nextEntry >= numRids) {
+			if (nextPageNum == Page::INVALID_NUMBER) {
+				throw IndexScanCompletedException();
+			}
+			index->advanceScan(*this);
+		}
+
+		outRid = rids[nextEntry];
+		nextEntry++;
+	}
+
+	template <class KeyT>
+	const void BTreeScanCursor<KeyT>::scanNext(RecordId& outRid, void* outPayload)
+	{
+		int payloadBytes = index->payloadBytes;
+		if (payloadBytes == 0) {
+			throw BadIndexInfoException("Index has no included columns to return");
+		}
+		scanNext(outRid);
+
+		//the included columns of the entry were copied from the leaf along with its record id
+		memcpy(outPayload, payloads + (nextEntry - 1) * payloadBytes, payloadBytes);
+	}
+
+	template <class KeyT>
+	bool BTreeScanCursor<KeyT>::scanNextBatch(std::vector<RecordId>& outRids, const int maxCount)
+	{
+		if (!executing) throw ScanNotInitializedException();
+
+		//the record ids left in the cursor are already within the high bound, so they are copied as a block
+		outRids.clear();
+		while ((int) outRids.size() < maxCount) {
+			if (nextEntry >= numRids) {
+				if (nextPageNum == Page::INVALID_NUMBER) break;
+				index->advanceScan(*this);
+				continue;
+			}
+			int count = std::min(numRids - nextEntry, maxCount - (int) outRids.size());
+			outRids.insert(outRids.end(), &rids[nextEntry], &rids[nextEntry + count]);
+			nextEntry += count;
+		}
+
+		return !outRids.empty();
+	}
+
+	template <class KeyT>
+	const void BTreeScanCursor<KeyT>::endScan()
+	{
+		//throws ScanNotInitializedException if the scan hasn't been started yet
+		if (!executing) throw ScanNotInitializedException();
+		executing = false;
+
+		numRids = 0;
+		nextEntry = 0;
+		nextPageNum = Page::INVALID_NUMBER;
+	}
+
+	template <class KeyT>
+	bool BTreeScanCursor<KeyT>::isExecuting() const
+	{
+		return executing;
+	}
+
+	// the key types indexes can be built over
+	template class BTreeScanCursor<int>;
+	template class BTreeScanCursor<double>;
+	template class BTreeScanCursor<StringKey>;
+	template class BTreeIndex<int>;
+	template class BTreeIndex<double>;
+	template class BTreeIndex<StringKey>;
+
 }
@@ -11,11 +11,17 @@
 #include <string>
 #include "string.h"
 #include <sstream>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
 
 #include "types.h"
 #include "page.h"
 #include "file.h"
 #include "buffer.h"
+#include "latch.h"
+#include "node_search.h"
 
 namespace badgerdb
 {
@@ -41,18 +47,421 @@ enum Operator
 	GT		/* Greater Than */
 };
 
+/**
+ * @brief How lookups and scans synchronize with concurrent inserts. Passed to BTreeIndex::setReadMode().
+ */
+enum ReadMode
+{
+	LATCH_CRABBING = 0,			/* Latch every node shared on the way down, coupling parent and child */
+	OPTIMISTIC_LOCK_COUPLING = 1,	/* Latch nothing, validate node versions after reading and restart on conflict */
+	B_LINK = 2					/* Latch one node at a time and follow right links past concurrent splits; inserts split bottom-up */
+};
+
+/**
+ * @brief Order in which a scan returns the entries of its range. Passed to BTreeIndex::startScan().
+ */
+enum ScanDirection
+{
+	FORWARD = 0,	/* Ascending keys, from the low bound along the right links of the leaves */
+	BACKWARD = 1	/* Descending keys, from the high bound along the left links of the leaves */
+};
+
+
+/**
+ * @brief Size of String key.
+ * Keys are fixed width, shorter strings are padded with zeroes.
+ */
+const  int STRINGSIZE = 64;
+
+/**
+ * @brief Fixed width character string usable as a B+Tree key.
+ * Keys are always zero padded past the end of the string, so two keys can be
+ * compared with a single memcmp over the whole array.
+ */
+template <int N>
+struct FixedString{
+	char data[ N ];
+
+  /**
+   * Copy a C string (or a character field of a record) into a key, truncating
+   * it at N characters and zero padding the rest.
+   */
+	void set( const char* str )
+	{
+		strncpy( data, str, N );
+	}
+};
+
+template <int N>
+bool operator<( const FixedString<N>& s1, const FixedString<N>& s2 )
+{
+	return memcmp( s1.data, s2.data, N ) < 0;
+}
+
+template <int N>
+bool operator>( const FixedString<N>& s1, const FixedString<N>& s2 )
+{
+	return memcmp( s1.data, s2.data, N ) > 0;
+}
+
+template <int N>
+bool operator<=( const FixedString<N>& s1, const FixedString<N>& s2 )
+{
+	return memcmp( s1.data, s2.data, N ) <= 0;
+}
+
+template <int N>
+bool operator>=( const FixedString<N>& s1, const FixedString<N>& s2 )
+{
+	return memcmp( s1.data, s2.data, N ) >= 0;
+}
+
+template <int N>
+bool operator==( const FixedString<N>& s1, const FixedString<N>& s2 )
+{
+	return memcmp( s1.data, s2.data, N ) == 0;
+}
+
+template <int N>
+bool operator!=( const FixedString<N>& s1, const FixedString<N>& s2 )
+{
+	return memcmp( s1.data, s2.data, N ) != 0;
+}
+
+template <int N>
+std::ostream& operator<<( std::ostream& out, const FixedString<N>& s )
+{
+	return out << std::string( s.data, strnlen( s.data, N ) );
+}
+
+/**
+ * @brief Key type of indexes built over STRING attributes.
+ */
+typedef FixedString<STRINGSIZE> StringKey;
+
+/**
+ * @brief Per key type information: the Datatype the key is stored as in IndexMetaInfo, how a
+ * key is read from a record or from the void pointers passed to insertEntry and startScan, and
+ * which key a split pushes up between a node ending in left and its sibling starting at right.
+ */
+template <class T>
+struct KeyTraits;
+
+template <>
+struct KeyTraits<int>{
+	static const Datatype TYPE = INTEGER;
+	static int read( const void* ptr ) { int key; memcpy( &key, ptr, sizeof( int ) ); return key; }
+	static int separator( const int& left, const int& right ) { return right; }
+};
+
+template <>
+struct KeyTraits<double>{
+	static const Datatype TYPE = DOUBLE;
+	static double read( const void* ptr ) { double key; memcpy( &key, ptr, sizeof( double ) ); return key; }
+	static double separator( const double& left, const double& right ) { return right; }
+};
+
+template <int N>
+struct KeyTraits< FixedString<N> >{
+	static const Datatype TYPE = STRING;
+	static FixedString<N> read( const void* ptr ) { FixedString<N> key; key.set( (const char*) ptr ); return key; }
+
+  /**
+   * The shortest prefix of right that is still greater than left: right cut off just past the
+   * first character the two differ in (suffix truncation). Right itself if they are equal.
+   */
+	static FixedString<N> separator( const FixedString<N>& left, const FixedString<N>& right )
+	{
+		if( !( left < right ) ) return right;
+		int length = 0;
+		while( left.data[ length ] == right.data[ length ] ) length++;
+		FixedString<N> key;
+		memset( key.data, 0, N );
+		memcpy( key.data, right.data, length + 1 );
+		return key;
+	}
+};
+
+/**
+ * @brief Number of key slots in the leaf and non-leaf nodes of a B+Tree over keys of type T.
+ */
+template <class T>
+struct NodeCapacity{
+  /**
+   * Whatever is left of the page after the leaf header (high key, sibling pointers and key
+   * count) is divided between the key and rid arrays.
+   */
+	//                                             high key        sibling ptrs            numKeys              key            rid
+	static const int LEAF = ( Page::SIZE - sizeof( T ) - 2 * sizeof( PageId ) - sizeof( int ) ) / ( sizeof( T ) + sizeof( RecordId ) );
+
+  /**
+   * A non-leaf node with n keys holds n + 1 child page numbers, hence the extra pageNo in the header.
+   * Keys with a stricter alignment than int are padded away from the level field.
+   */
+	//                                                high key          level            numKeys          sibling ptr       extra pageNo                                   alignment                                        key         pageNo
+	static const int NONLEAF = ( Page::SIZE - sizeof( T ) - sizeof( int ) - sizeof( int ) - sizeof( PageId ) - sizeof( PageId ) - ( alignof( T ) > sizeof( int ) ? alignof( T ) - sizeof( int ) : 0 ) ) / ( sizeof( T ) + sizeof( PageId ) );
+
+  /**
+   * Most entries any leaf can hold, LEAF unless leaves are compressed.
+   */
+	static const int LEAF_MAX = LEAF;
+
+  /**
+   * Most bytes the included columns of one leaf's entries take. Only leaves over INTEGER keys
+   * hold included columns; one byte keeps the arrays sized by it legal.
+   */
+	static const int PAYLOAD_BYTES = 1;
+};
+
+/**
+ * @brief Bytes per record id in the record id column of a compressed leaf: the page number
+ * followed by the slot number, without the padding of RecordId.
+ */
+const  int PACKED_RID_SIZE = sizeof( PageId ) + sizeof( SlotId );
+
+/**
+ * @brief Most columns a covering index copies into its leaves, see IndexBuildOptions::includedColumns.
+ */
+const  int MAX_INCLUDED_COLUMNS = 4;
+
+/**
+ * @brief Most bytes the included columns of a covering index take together, per entry.
+ */
+const  int MAX_PAYLOAD_SIZE = 64;
+
+/**
+ * @brief Leaves over INTEGER keys keep their entries in a byte area (see LeafNode<int>), whose
+ * key column takes 0, 1, 2 or 4 bytes per key and whose record id column takes PACKED_RID_SIZE or
+ * sizeof( RecordId ) bytes per record id. LEAF is the capacity with plain keys and record ids.
+ */
+template <>
+struct NodeCapacity<int>{
+  /**
+   * Bytes left for the entries after the leaf header. The record id column starts at the next
+   * multiple of 4 after the key column, which costs up to 3 bytes.
+   */
+	//                                                  high key      sibling ptrs           numKeys, keyBase, widths
+	static const int LEAF_BYTES = Page::SIZE - sizeof( int ) - 2 * sizeof( PageId ) - 3 * sizeof( int );
+
+	static const int LEAF = ( LEAF_BYTES - 3 ) / ( sizeof( int ) + sizeof( RecordId ) );
+
+	static const int LEAF_MAX = ( LEAF_BYTES - 3 ) / PACKED_RID_SIZE;
+
+  /**
+   * The included columns share the byte area with the keys and record ids, so never exceed it.
+   */
+	static const int PAYLOAD_BYTES = LEAF_BYTES;
+
+	//                                                high key          level            numKeys          sibling ptr       extra pageNo          key         pageNo
+	static const int NONLEAF = ( Page::SIZE - sizeof( int ) - sizeof( int ) - sizeof( int ) - sizeof( PageId ) - sizeof( PageId ) ) / ( sizeof( int ) + sizeof( PageId ) );
+};
+
+/**
+ * @brief Bytes per separator, on average, that non-leaf nodes over STRING keys are sized for.
+ */
+const  int STRING_SEPARATOR_SIZE = 4;
+
+/**
+ * @brief Non-leaf nodes over STRING keys pack their separators (see NonLeafNode<StringKey>), so
+ * they have a page number and an end offset per child plus room for STRING_SEPARATOR_SIZE bytes
+ * of separator each, rather than STRINGSIZE bytes.
+ */
+template <>
+struct NodeCapacity<StringKey>{
+	//                                             high key                sibling ptrs            numKeys                 key                    rid
+	static const int LEAF = ( Page::SIZE - sizeof( StringKey ) - 2 * sizeof( PageId ) - sizeof( int ) ) / ( sizeof( StringKey ) + sizeof( RecordId ) );
+
+	//                                                high key            level, numKeys, prefixLength   sibling ptr           extra pageNo             key end                  pageNo           separator
+	static const int NONLEAF = ( Page::SIZE - sizeof( StringKey ) - 3 * sizeof( int ) - sizeof( PageId ) - sizeof( PageId ) ) / ( sizeof( unsigned short ) + sizeof( PageId ) + STRING_SEPARATOR_SIZE );
+
+  /**
+   * Bytes left for the separators themselves once the fixed size arrays are placed.
+   */
+	static const int NONLEAF_BYTES = Page::SIZE - sizeof( StringKey ) - 3 * sizeof( int ) - sizeof( PageId ) - ( NONLEAF + 1 ) * sizeof( PageId ) - NONLEAF * sizeof( unsigned short );
+
+	static const int LEAF_MAX = LEAF;
+
+	static const int PAYLOAD_BYTES = 1;
+};
 
 /**
  * @brief Number of key slots in B+Tree leaf for INTEGER key.
  */
-//                                                  sibling ptr             key               rid
-const  int INTARRAYLEAFSIZE = 3;//( Page::SIZE - sizeof( PageId ) ) / ( sizeof( int ) + sizeof( RecordId ) );
+const  int INTARRAYLEAFSIZE = NodeCapacity<int>::LEAF;
 
 /**
  * @brief Number of key slots in B+Tree non-leaf for INTEGER key.
  */
-//                                                     level     extra pageNo                  key       pageNo
-const  int INTARRAYNONLEAFSIZE = 3;//( Page::SIZE - sizeof( int ) - sizeof( PageId ) ) / ( sizeof( int ) + sizeof( PageId ) );
+const  int INTARRAYNONLEAFSIZE = NodeCapacity<int>::NONLEAF;
+
+/**
+ * @brief Number of key slots in B+Tree leaf for DOUBLE key.
+ */
+const  int DOUBLEARRAYLEAFSIZE = NodeCapacity<double>::LEAF;
+
+/**
+ * @brief Number of key slots in B+Tree non-leaf for DOUBLE key.
+ */
+const  int DOUBLEARRAYNONLEAFSIZE = NodeCapacity<double>::NONLEAF;
+
+/**
+ * @brief Number of key slots in B+Tree leaf for STRING key.
+ */
+const  int STRINGARRAYLEAFSIZE = NodeCapacity<StringKey>::LEAF;
+
+/**
+ * @brief Number of key slots in B+Tree non-leaf for STRING key.
+ */
+const  int STRINGARRAYNONLEAFSIZE = NodeCapacity<StringKey>::NONLEAF;
+
+/**
+ * @brief Fraction of each node filled when an index is bulk loaded.
+ * The remaining slots absorb later inserts before the node has to split.
+ */
+const double DEFAULT_FILL_FACTOR = 0.9;
+
+/**
+ * @brief Default memory an index build may use for sorting, in bytes.
+ */
+const size_t DEFAULT_BUILD_MEMORY = 16 << 20;
+
+/**
+ * @brief Default number of threads an index build sorts and merges runs with.
+ */
+const int DEFAULT_BUILD_THREADS = 4;
+
+/**
+ * @brief Default number of sorted runs merged at once by an index build.
+ */
+const int DEFAULT_MERGE_FAN_IN = 64;
+
+/**
+ * @brief Default number of levels, the root first, whose nodes an index keeps pinned in the buffer pool.
+ */
+const int DEFAULT_PINNED_LEVELS = 2;
+
+/**
+ * @brief Default buffer pool memory an index may keep pinned for its upper levels, in bytes.
+ */
+const size_t DEFAULT_PIN_MEMORY = 16 * Page::SIZE;
+
+/**
+ * @brief A column of the base relation that a covering index stores in its leaves, next to the
+ * record id of every entry.
+*/
+struct IncludedColumn{
+  /**
+   * Offset of the column inside the record.
+   */
+	int attrByteOffset;
+
+  /**
+   * Number of bytes the column takes.
+   */
+	int width;
+};
+
+/**
+ * @brief Settings for building an index over an existing relation.
+ * Entries are sorted in memory when they fit in memoryBudget. Otherwise the relation is
+ * cut into sorted runs that are written to temporary files and merged back together.
+*/
+struct IndexBuildOptions{
+  /**
+   * Fraction of every node filled by the bulk load, in (0, 1].
+   */
+	double fillFactor;
+
+  /**
+   * Bytes of memory used for run buffers while the relation is scanned and for
+   * run pages while runs are merged.
+   */
+	size_t memoryBudget;
+
+  /**
+   * Number of worker threads sorting and writing runs, and merging runs.
+   */
+	int numThreads;
+
+  /**
+   * Maximum number of runs merged at once. Lowered if the memory budget cannot
+   * hold a page for every input run.
+   */
+	int mergeFanIn;
+
+  /**
+   * Store the keys of a leaf as 1 or 2 byte offsets from its smallest key whenever they span
+   * few enough values, or only once if they are all the same, and their record ids in PACKED_RID_SIZE bytes rather than
+   * sizeof( RecordId ), so that more entries fit in a leaf. Only INTEGER indexes compress their
+   * leaves, the others ignore it. Applies to the bulk load and to every later change to a leaf.
+   */
+	bool compressLeaves;
+
+  /**
+   * Columns of the relation to copy into the leaves with every entry, in this order, so that a
+   * scan can return them through scanNext without reading the relation (a covering index). At
+   * most MAX_INCLUDED_COLUMNS columns of MAX_PAYLOAD_SIZE bytes together. Only INTEGER indexes
+   * store included columns. They are read from the record each new entry points at, whether it
+   * is bulk loaded or inserted later, so the record must be in the relation by then.
+   */
+	std::vector<IncludedColumn> includedColumns;
+
+	IndexBuildOptions()
+		: fillFactor(DEFAULT_FILL_FACTOR), memoryBudget(DEFAULT_BUILD_MEMORY),
+		  numThreads(DEFAULT_BUILD_THREADS), mergeFanIn(DEFAULT_MERGE_FAN_IN), compressLeaves(false)
+	{
+	}
+};
+
+/**
+ * @brief What an index build did and how long each phase took.
+*/
+struct IndexBuildStats{
+  /**
+   * Number of entries loaded into the index.
+   */
+	long numEntries;
+
+  /**
+   * Number of sorted runs written while scanning, 0 if the entries were sorted in memory.
+   */
+	int numRuns;
+
+  /**
+   * Number of merge passes over the runs before the final merge into the leaves.
+   */
+	int mergePasses;
+
+  /**
+   * Wall clock time scanning the relation and sorting and writing runs, in milliseconds.
+   */
+	double runMs;
+
+  /**
+   * Part of runMs the scanning thread spent reading the relation.
+   */
+	double scanMs;
+
+  /**
+   * Time spent sorting runs, summed over all worker threads.
+   */
+	double sortMs;
+
+  /**
+   * Wall clock time of the merge passes before the final merge.
+   */
+	double mergeMs;
+
+  /**
+   * Wall clock time of the final merge and of packing the entries into the tree.
+   */
+	double loadMs;
+
+	IndexBuildStats()
+		: numEntries(0), numRuns(0), mergePasses(0), runMs(0), scanMs(0), sortMs(0), mergeMs(0), loadMs(0)
+	{
+	}
+};
 
 /**
  * @brief Structure to store a key-rid pair. It is used to pass the pair to functions that 
@@ -132,109 +541,523 @@ struct IndexMetaInfo{
    * Variable to keep track of if root is a leaf
    */
 	bool isLeaf; 
+
+  /**
+   * First page of the list of pages freed by merges, Page::INVALID_NUMBER if none.
+   */
+	PageId freePageNo;
+
+  /**
+   * Whether leaves are compressed, kept so that a reopened index lays out new leaves the same way.
+   */
+	bool compressLeaves;
+
+  /**
+   * Number of columns stored in the leaves, and the columns themselves, see IndexBuildOptions::includedColumns.
+   */
+	int numIncludedColumns;
+	IncludedColumn includedColumns[ MAX_INCLUDED_COLUMNS ];
 };
 
 /*
 Each node is a page, so once we read the page in we just cast the pointer to the page to this struct and use it to access the parts
 These structures basically are the format in which the information is stored in the pages for the index file depending on what kind of 
 node they are. The level memeber of each non leaf structure seen below is set to 1 if the nodes 
-at this level are just above the leaf nodes. Otherwise set to 0.
+at this level are just above the leaf nodes, 2 for the level above that, and so on.
+
+Every level is chained left to right through rightSibPageNo. Each node but the last of its level
+also keeps the separator between it and its right sibling as highKey: all of its entries are less
+than or equal to highKey, and those of the nodes to its right are greater than or equal to it. A
+node that split after its parent was read therefore tells a search to go right (B-link tree).
+Leaves are also chained right to left through leftSibPageNo, for scans in descending order.
+Nodes do not point back at their parent: inserts and deletes keep the non-leaf nodes they went
+down through and walk that path back up, so a split or merge never touches the children it moves.
 */
 
 /**
- * @brief Structure for all non-leaf nodes when the key is of INTEGER type.
+ * @brief Structure for all non-leaf nodes, templated for the key type.
 */
-struct NonLeafNodeInt{
+template <class KeyT>
+struct NonLeafNode{
+  /**
+   * Upper bound of the keys in the subtree, meaningless if rightSibPageNo is Page::INVALID_NUMBER.
+   */
+	KeyT highKey;
+
   /**
-   * Level of the node in the tree.
+   * Level of the node in the tree, counted from 1 just above the leaves.
    */
 	int level;
 
   /**
    * Stores keys.
    */
-	int keyArray[ INTARRAYNONLEAFSIZE ];
+	KeyT keyArray[ NodeCapacity<KeyT>::NONLEAF ];
 
   /**
    * Stores page numbers of child pages which themselves are other non-leaf/leaf nodes in the tree.
    */
-	PageId pageNoArray[ INTARRAYNONLEAFSIZE + 1 ];
+	PageId pageNoArray[ NodeCapacity<KeyT>::NONLEAF + 1 ];
 
-	int numKeys; 
+  /**
+   * Number of keys currently stored in keyArray.
+   */
+	int numKeys;
 
-	PageId parent;
+  /**
+   * Page number of the node on the right side at the same level, Page::INVALID_NUMBER for the last one.
+   */
+	PageId rightSibPageNo;
 };
 
 
 /**
- * @brief Structure for all leaf nodes when the key is of INTEGER type.
+ * @brief Structure for non-leaf nodes over STRING keys. Rather than taking STRINGSIZE bytes each,
+ * separators are packed: the bytes all of them start with are stored once (prefix compression),
+ * followed by the rest of every separator up to its terminating zero. Leaf splits push up the
+ * shortest key that tells the two halves apart (see KeyTraits::separator), so a separator rarely
+ * takes more than a few bytes and the node holds about as many children as one over INTEGER keys.
+ * The node is full once either its child slots or its keyBytes run out.
 */
-struct LeafNodeInt{
+template <>
+struct NonLeafNode<StringKey>{
   /**
-   * Stores keys.
+   * Upper bound of the keys in the subtree, meaningless if rightSibPageNo is Page::INVALID_NUMBER.
    */
-	int keyArray[ INTARRAYLEAFSIZE ];
+	StringKey highKey;
 
   /**
-   * Stores RecordIds.
+   * Level of the node in the tree, counted from 1 just above the leaves.
    */
-	RecordId ridArray[ INTARRAYLEAFSIZE ];
+	int level;
 
   /**
-   * Page number of the leaf on the right side.
-	 * This linking of leaves allows to easily move from one leaf to the next leaf during index scan.
+   * Number of separators currently stored in keyBytes.
    */
-	PageId rightSibPageNo;
-
 	int numKeys;
 
-	PageId parent;
-};
-
-
-/**
- * @brief BTreeIndex class. It implements a B+ Tree index on a single attribute of a
- * relation. This index supports only one scan at a time.
-*/
-class BTreeIndex {
-
- private:
-
   /**
-   * File object for the index file.
+   * Page number of the node on the right side at the same level, Page::INVALID_NUMBER for the last one.
    */
-	File		*file;
+	PageId rightSibPageNo;
 
   /**
-   * Buffer Manager Instance.
+   * Length of the prefix every separator starts with, stored at the start of keyBytes.
    */
-	BufMgr	*bufMgr;
+	int prefixLength;
 
   /**
-   * Page number of meta page.
+   * Stores page numbers of child pages which themselves are other non-leaf/leaf nodes in the tree.
    */
-	PageId	headerPageNum;
+	PageId pageNoArray[ NodeCapacity<StringKey>::NONLEAF + 1 ];
 
   /**
-   * page number of root page of B+ tree inside index file.
+   * Separator i is the prefix followed by keyBytes from keyEnd[i-1] (prefixLength for the
+   * first one) up to keyEnd[i], zero padded to STRINGSIZE.
    */
-	PageId	rootPageNum;
+	unsigned short keyEnd[ NodeCapacity<StringKey>::NONLEAF ];
 
   /**
-   * Datatype of attribute over which index is built.
+   * The prefix, then the separators without it, in key order.
    */
-	Datatype	attributeType;
+	char keyBytes[ NodeCapacity<StringKey>::NONLEAF_BYTES ];
+};
 
-  /**
+
+/**
+ * @brief Structure for all leaf nodes, templated for the key type.
+*/
+template <class KeyT>
+struct LeafNode{
+  /**
+   * Upper bound of the keys in the leaf, meaningless if rightSibPageNo is Page::INVALID_NUMBER.
+   */
+	KeyT highKey;
+
+  /**
+   * Stores keys.
+   */
+	KeyT keyArray[ NodeCapacity<KeyT>::LEAF ];
+
+  /**
+   * Stores RecordIds.
+   */
+	RecordId ridArray[ NodeCapacity<KeyT>::LEAF ];
+
+  /**
+   * Page number of the leaf on the right side.
+	 * This linking of leaves allows to easily move from one leaf to the next leaf during index scan.
+   */
+	PageId rightSibPageNo;
+
+  /**
+   * Page number of the leaf on the left side, Page::INVALID_NUMBER for the first one.
+   * Set after the right link when a leaf splits, so it may briefly still point past the new leaf.
+   */
+	PageId leftSibPageNo;
+
+  /**
+   * Number of keys currently stored in keyArray.
+   */
+	int numKeys;
+};
+
+/**
+ * @brief Structure for leaf nodes over INTEGER keys. The entries form two columns in the entries
+ * area: numKeys keys, then, from the next multiple of 4 past room for as many keys as the leaf
+ * holds at its widths, their record ids. When the index compresses leaves (see
+ * IndexBuildOptions::compressLeaves) and the keys of a leaf span fewer than 2^16 values, each key
+ * is stored as its offset from keyBase in 1 or 2 bytes (frame of reference). A leaf whose keys
+ * are all the same, as in a long run of duplicates, is a posting list: keyBase is the key and
+ * there is no key column at all, only the record ids. Otherwise the keys are plain ints and
+ * keyBase is 0. The width is picked again whenever the leaf is refilled, so a
+ * key outside the range of the others falls back to the plain layout, or splits the leaf if the
+ * entries no longer fit. Compressed leaves also store each record id in PACKED_RID_SIZE bytes.
+ * An index with included columns has a third column after the record ids, the payload: the
+ * included columns of every entry, taking the same number of bytes for each. The leaf then holds
+ * fewer entries at every width.
+*/
+template <>
+struct LeafNode<int>{
+  /**
+   * Upper bound of the keys in the leaf, meaningless if rightSibPageNo is Page::INVALID_NUMBER.
+   */
+	int highKey;
+
+  /**
+   * Page number of the leaf on the right side.
+   */
+	PageId rightSibPageNo;
+
+  /**
+   * Page number of the leaf on the left side, Page::INVALID_NUMBER for the first one.
+   */
+	PageId leftSibPageNo;
+
+  /**
+   * Number of entries currently stored.
+   */
+	int numKeys;
+
+  /**
+   * Value the stored key offsets are relative to.
+   */
+	int keyBase;
+
+  /**
+   * Bytes per key in the key column: 0, 1, 2 or 4.
+   */
+	short keyWidth;
+
+  /**
+   * Bytes per record id in the record id column: PACKED_RID_SIZE or sizeof( RecordId ).
+   */
+	short ridWidth;
+
+  /**
+   * The key column followed by the record id column and the payload column, if any.
+   */
+	char entries[ NodeCapacity<int>::LEAF_BYTES ];
+};
+
+/**
+ * @brief Layout of an index page freed by a merge. Freed pages are chained through
+ * nextFreePageNo, starting at IndexMetaInfo::freePageNo, until a new node reuses them.
+*/
+struct FreeNodePage{
+  /**
+   * Next freed page, Page::INVALID_NUMBER at the end of the list.
+   */
+	PageId nextFreePageNo;
+};
+
+/**
+ * @brief Structure for all non-leaf nodes when the key is of INTEGER type.
+*/
+typedef NonLeafNode<int> NonLeafNodeInt;
+
+/**
+ * @brief Structure for all leaf nodes when the key is of INTEGER type.
+*/
+typedef LeafNode<int> LeafNodeInt;
+
+/**
+ * @brief Structure for all non-leaf nodes when the key is of DOUBLE type.
+*/
+typedef NonLeafNode<double> NonLeafNodeDouble;
+
+/**
+ * @brief Structure for all leaf nodes when the key is of DOUBLE type.
+*/
+typedef LeafNode<double> LeafNodeDouble;
+
+/**
+ * @brief Structure for all non-leaf nodes when the key is of STRING type.
+*/
+typedef NonLeafNode<StringKey> NonLeafNodeString;
+
+/**
+ * @brief Structure for all leaf nodes when the key is of STRING type.
+*/
+typedef LeafNode<StringKey> LeafNodeString;
+
+static_assert( sizeof( NonLeafNodeInt ) <= Page::SIZE,
+		"NonLeafNodeInt must fit in a single page." );
+static_assert( sizeof( LeafNodeInt ) <= Page::SIZE,
+		"LeafNodeInt must fit in a single page." );
+static_assert( NodeCapacity<int>::LEAF_MAX / 2 + 1 <= ( NodeCapacity<int>::LEAF_BYTES - 3 ) / ( sizeof( int ) + PACKED_RID_SIZE ),
+		"Either half of a split compressed LeafNodeInt must fit with plain keys." );
+static_assert( sizeof( NonLeafNodeDouble ) <= Page::SIZE,
+		"NonLeafNodeDouble must fit in a single page." );
+static_assert( sizeof( LeafNodeDouble ) <= Page::SIZE,
+		"LeafNodeDouble must fit in a single page." );
+static_assert( sizeof( NonLeafNodeString ) <= Page::SIZE,
+		"NonLeafNodeString must fit in a single page." );
+static_assert( sizeof( LeafNodeString ) <= Page::SIZE,
+		"LeafNodeString must fit in a single page." );
+
+
+template <class KeyT>
+class BTreeIndex;
+
+/**
+ * @brief A range scan over a BTreeIndex. Any number of cursors may be open on one index at
+ * once, from one thread or several, for instance for both sides of a nested-loop join.
+ *
+ * A cursor copies out the matching record ids of one leaf at a time into a buffer it holds
+ * inline, so it keeps no page pinned or latched between calls and never allocates: it can live
+ * on the stack of a query. Entries that exist for the whole scan are returned exactly once,
+ * since splits only move entries right, and a backward scan that finds the leaf to its left has
+ * split since it read the link moves right again to the new leaf. A cursor must not be used
+ * across a deleteEntry, which may free the leaf it would move to next.
+ */
+template <class KeyT>
+class BTreeScanCursor {
+ public:
+  /**
+   * A cursor over index with no scan started.
+   */
+	BTreeScanCursor(BTreeIndex<KeyT>* index);
+
+  /**
+	 * Begin a filtered scan of the index, ending the scan this cursor had open if any.
+	 * Find the leaf that contains the first entry that satisfies the scan parameters in the given
+	 * direction and copy out its matching record ids.
+   * @param lowVal	Low value of range, pointer to integer / double / char string
+   * @param lowOp		Low operator (GT/GTE)
+   * @param highVal	High value of range, pointer to integer / double / char string
+   * @param highOp	High operator (LT/LTE)
+   * @param direction	FORWARD to return entries in ascending key order, BACKWARD for descending
+   * @throws  BadOpcodesException If lowOp and highOp do not contain one of their their expected values
+   * @throws  BadScanrangeException If lowVal > highval
+	 * @throws  NoSuchKeyFoundException If there is no key in the B+ tree that satisfies the scan criteria.
+	**/
+	const void startScan(const void* lowVal, const Operator lowOp, const void* highVal, const Operator highOp,
+			const ScanDirection direction = FORWARD);
+
+  /**
+	 * Fetch the record id of the next index entry that matches the scan.
+   * @param outRid	RecordId of next record found that satisfies the scan criteria returned in this
+	 * @throws ScanNotInitializedException If no scan has been initialized.
+	 * @throws IndexScanCompletedException If no more records, satisfying the scan criteria, are left to be scanned.
+	**/
+	const void scanNext(RecordId& outRid);
+
+  /**
+	 * Fetch the record id and the included columns of the next index entry that matches the scan.
+   * @param outRid	RecordId of next record found that satisfies the scan criteria returned in this
+   * @param outPayload	Receives BTreeIndex::getPayloadSize() bytes, the included columns of the entry
+	 * @throws ScanNotInitializedException If no scan has been initialized.
+	 * @throws IndexScanCompletedException If no more records, satisfying the scan criteria, are left to be scanned.
+	 * @throws BadIndexInfoException If the index has no included columns.
+	**/
+	const void scanNext(RecordId& outRid, void* outPayload);
+
+  /**
+	 * Fetch the record ids of up to maxCount next index entries that match the scan, copied
+	 * leaf by leaf, replacing the contents of outRids.
+   * @param outRids	Record ids found that satisfy the scan criteria returned in this
+   * @param maxCount	Largest number of record ids to return
+	 * @return False, with outRids left empty, once no more records are left to be scanned.
+	 * @throws ScanNotInitializedException If no scan has been initialized.
+	**/
+	bool scanNextBatch(std::vector<RecordId>& outRids, const int maxCount);
+
+  /**
+	 * Terminate the current scan of this cursor.
+	 * @throws ScanNotInitializedException If no scan has been initialized.
+	**/
+	const void endScan();
+
+  /**
+	 * True between startScan and endScan.
+	**/
+	bool isExecuting() const;
+
+ private:
+	friend class BTreeIndex<KeyT>;
+
+  /**
+   * Index being scanned.
+   */
+	BTreeIndex<KeyT>* index;
+
+  /**
+   * True if an index scan has been started.
+   */
+	bool executing;
+
+  /**
+   * Index of next entry to be returned from rids.
+   */
+	int nextEntry;
+
+  /**
+   * Number of record ids copied into rids.
+   */
+	int numRids;
+
+  /**
+   * Leaf to copy from next, the sibling of the leaf rids came from in the scan direction,
+   * Page::INVALID_NUMBER once a bound or the last leaf was reached.
+   */
+	PageId nextPageNum;
+
+  /**
+   * Leaf rids came from, which a backward scan expects to find right of the next one.
+   */
+	PageId currPageNum;
+
+  /**
+   * True if entries are returned in descending key order, rids then being copied reversed.
+   */
+	bool backward;
+
+  /**
+   * Low value for scan.
+   */
+	KeyT lowVal;
+
+  /**
+   * Low Operator. Can only be GT(>) or GTE(>=).
+   */
+	Operator lowOp;
+
+  /**
+   * High value for scan.
+   */
+	KeyT highVal;
+
+  /**
+   * High Operator. Can only be LT(<) or LTE(<=).
+   */
+	Operator highOp;
+
+  /**
+   * Record ids of the matching entries of the leaf being scanned, in the order they are returned.
+   */
+	RecordId rids[ NodeCapacity<KeyT>::LEAF_MAX ];
+
+  /**
+   * Included columns of the entries in rids, in the same order, if the index has any.
+   */
+	char payloads[ NodeCapacity<KeyT>::PAYLOAD_BYTES ];
+};
+
+/**
+ * @brief BTreeIndex class. It implements a B+ Tree index on a single attribute of a
+ * relation. Each thread may run one scan at a time through the index itself, and any
+ * number through BTreeScanCursor objects.
+ * The class is templated for the key type; btree.cpp instantiates it for int (INTEGER),
+ * double (DOUBLE) and StringKey (STRING) keys, so that all key handling is resolved at
+ * compile time and the attribute type is only checked once, when the index is constructed.
+ *
+ * insertEntry and scans may be called from several threads at once. Threads coordinate through
+ * the latches of the buffer frames holding the nodes and latch couple on the way down: a child is
+ * latched before its parent is released. Lookups latch every node shared. An insert first tries
+ * the same with only the leaf latched exclusive, and if the leaf is full descends again latching
+ * exclusive and releasing all ancestors once it reaches a node that cannot split, so a split only
+ * ever touches nodes the inserting thread holds. rootLatch orders root changes against descents.
+ * With OPTIMISTIC_LOCK_COUPLING, lookups latch nothing and instead check the version of each
+ * node's latch around reading it, so read-mostly workloads do not contend on the upper levels.
+ * With B_LINK, no thread ever waits on a parent while holding a latch on the way down: searches
+ * latch one node at a time and go right when a node split since its parent was read, and inserts
+ * split a leaf on their own and then post the separator to the parent, bottom-up.
+ * deleteEntry, PrintTree, setSearchStrategy, setReadMode and setPinnedLevels must not run
+ * concurrently with other operations.
+*/
+template <class KeyT>
+class BTreeIndex {
+
+ public:
+
+  /**
+   * Leaf node layout of this index.
+   */
+	typedef LeafNode<KeyT> LeafNodeT;
+
+  /**
+   * Non-leaf node layout of this index.
+   */
+	typedef NonLeafNode<KeyT> NonLeafNodeT;
+
+ private:
+
+  /**
+   * File object for the index file.
+   */
+	File		*file;
+
+  /**
+   * Buffer Manager Instance.
+   */
+	BufMgr	*bufMgr;
+
+  /**
+   * Page number of meta page.
+   */
+	PageId	headerPageNum;
+
+  /**
+   * page number of root page of B+ tree inside index file.
+   */
+	PageId	rootPageNum;
+
+  /**
+   * Datatype of attribute over which index is built.
+   */
+	Datatype	attributeType;
+
+  /**
    * Offset of attribute, over which index is built, inside records. 
    */
 	int 		attrByteOffset;
 
   /**
-   * Number of keys in leaf node, depending upon the type of key.
+   * Number of keys in leaf node, depending upon the type of key. Compressed leaves may hold more.
    */
 	int			leafOccupancy;
 
+  /**
+   * Whether leaves are compressed, see IndexBuildOptions::compressLeaves.
+   */
+	bool		compressLeaves;
+
+  /**
+   * Columns stored in the leaves with every entry, see IndexBuildOptions::includedColumns.
+   */
+	std::vector<IncludedColumn>	includedColumns;
+
+  /**
+   * Bytes the included columns take per entry, 0 if there are none.
+   */
+	int			payloadBytes;
+
+  /**
+   * Base relation, which the included columns of new entries are read from. NULL if there are none.
+   */
+	File		*relationFile;
+
   /**
    * Number of keys in non-leaf node, depending upon the type of key.
    */
@@ -245,92 +1068,206 @@ class BTreeIndex {
    */
   struct IndexMetaInfo indexMetaInfo {};
 
+  /**
+   * Strategy used to search keyArray when visiting a node.
+   */
+	SearchStrategy	searchStrategy;
+
+  /**
+   * Position of the first key not less than a given key in a node, for the current searchStrategy.
+   */
+	typename NodeSearch<KeyT>::SearchFn	lowerBound;
+
+  /**
+   * Position of the first key greater than a given key in a node, for the current searchStrategy.
+   */
+	typename NodeSearch<KeyT>::SearchFn	upperBound;
+
+  /**
+   * How lookups and scans synchronize with inserts.
+   */
+	ReadMode	readMode;
+
 
 	// MEMBERS SPECIFIC TO SCANNING
 
+	friend class BTreeScanCursor<KeyT>;
+
   /**
-   * True if an index scan has been started.
+   * Identifies this index in the cursor each thread last used, see threadCursor(). Never reused,
+   * so a thread remembering a destroyed index cannot mistake a new one for it.
    */
-	bool		scanExecuting;
+	unsigned long indexId;
 
   /**
-   * Index of next entry to be scanned in current leaf being scanned.
+   * A thread's scan through startScan: the thread and the cursor that runs it.
    */
-	int			nextEntry;
+	typedef std::pair< std::thread::id, BTreeScanCursor<KeyT>* > ThreadScan;
 
   /**
-   * Page number of current page being scanned.
+   * Cursors of the scans threads have open through startScan, one per thread. A cursor is
+   * bound to a thread by startScan and returned to freeCursors by endScan.
    */
-	PageId	currentPageNum;
+	std::vector<ThreadScan> threadScans;
 
   /**
-   * Current Page being scanned.
+   * Cursors left by ended scans, for the next thread starting one. Along with threadScans this
+   * only grows with the number of threads scanning at once, and both are freed with the index.
    */
-	Page		*currentPageData;
+	std::vector< BTreeScanCursor<KeyT>* > freeCursors;
 
   /**
-   * Low INTEGER value for scan.
+   * Guards threadScans and freeCursors.
    */
-	int			lowValInt;
+	std::mutex	scanMutex;
+
+	// MEMBERS SPECIFIC TO CONCURRENCY
 
   /**
-   * Low DOUBLE value for scan.
+   * Held shared while a descent reads indexMetaInfo.rootPageNo and latches the root, and
+   * exclusive by an insert that may split the root, until the root is known to be safe.
    */
-	double	lowValDouble;
+	RWLatch	rootLatch;
 
   /**
-   * Low STRING value for scan.
+   * Guards the free page list in indexMetaInfo against concurrent splits.
    */
-	std::string	lowValString;
+	std::mutex	freeListMutex;
+
+	// MEMBERS SPECIFIC TO PINNED LEVELS
 
   /**
-   * High INTEGER value for scan.
+   * Page numbers of the pinned nodes, an open addressing table with Page::INVALID_NUMBER in
+   * the free slots. Slots are only emptied when a merge frees a pinned node, and deletes do not
+   * run alongside other operations, so a descent may use the frame of any page it finds here
+   * without pinning it.
    */
-	int			highValInt;
+	std::vector< std::atomic<PageId> >	pinnedPageNos;
 
   /**
-   * High DOUBLE value for scan.
+   * Frame holding the page in the same slot of pinnedPageNos.
    */
-	double	highValDouble;
+	std::vector<Page*>	pinnedFrames;
 
   /**
-   * High STRING value for scan.
+   * Number of levels to pin, see setPinnedLevels().
    */
-	std::string highValString;
-	
+	int	pinnedLevels;
+
   /**
-   * Low Operator. Can only be GT(>) or GTE(>=).
+   * Number of pages pinned, and the most the memory budget allows.
    */
-	Operator	lowOp;
+	int	numPinned;
+	int	maxPinned;
 
   /**
-   * High Operator. Can only be LT(<) or LTE(<=).
+   * Level of the lowest pinned nodes. A node split off one at this level or above is pinned too.
+   */
+	std::atomic<int>	lowestPinnedLevel;
+
+  /**
+   * Guards adding pages to pinnedPageNos.
    */
-	Operator	highOp;
+	std::mutex	pinMutex;
 
-  PageId foundLeafPageNo;
+	// MEMBERS SPECIFIC TO SWIZZLING
+
+  /**
+   * Frame each non-leaf node was last read into, at its page number modulo the table size,
+   * which is at least twice the number of frames. Optimistic descents go straight to that frame
+   * instead of through the buffer manager, see peekNode(), and the descents of the other modes
+   * and of inserts pin the node in it without probing the buffer manager's hash table, see
+   * readNonLeaf(). An entry left behind by an evicted node, or taken over by another page
+   * number, is caught by BufMgr::peekFrame() and BufMgr::pinFrame().
+   */
+	std::vector< std::atomic<FrameId> >	nodeFrames;
+
+  /**
+   * Phase timings of the build done by the constructor.
+   */
+	IndexBuildStats	buildStats;
 
 	
  public:
 
-  LeafNodeInt *CreateLeafNode(PageId &newPageId);
-
-  NonLeafNodeInt *CreateNonLeafNode(PageId &newPageId);
+  /**
+   * @brief Builds the tree bottom-up from entries that arrive in key order.
+   * Leaves are packed left to right up to the fill factor and every level above is
+   * built in the same pass: each level keeps only the node currently being filled
+   * pinned, and a node is released once its right sibling has been started, so each
+   * page is written exactly once. The index must not hold any entries yet.
+   */
+	class BulkLoader {
+	 public:
+	  /**
+	   * Start a bulk load into an empty index, allocating its first leaf.
+	   * @param index			Index being loaded
+	   * @param fillFactor	Fraction of leaf and non-leaf slots to fill, in (0, 1]
+	   */
+		BulkLoader(BTreeIndex<KeyT>* index, const double fillFactor);
+
+	  /**
+	   * Append the next entry. Keys must be passed in non-decreasing order.
+	   */
+		void append(const KeyT& key, const RecordId& rid);
+
+	  /**
+	   * Release the rightmost node of every level and make the top level the root.
+	   */
+		void finish();
+
+	 private:
+	  /**
+	   * Add childPageNo, whose smallest key is key, as the next child of the node being
+	   * filled at level (leaves are level 0), starting a new node or a new root as needed.
+	   */
+		void addChild(const size_t level, const KeyT& key, PageId childPageNo, Page* childPage);
+
+	  /**
+	   * Index being loaded.
+	   */
+		BTreeIndex<KeyT>* index;
+
+	  /**
+	   * Fraction of a leaf or non-leaf filled before the next one is started.
+	   */
+		double fillFactor;
+
+	  /**
+	   * Page number of the node being filled at every level, leaves first.
+	   */
+		std::vector<PageId> pageNos;
+
+	  /**
+	   * Pinned page of the node being filled at every level, leaves first.
+	   */
+		std::vector<Page*> pages;
+	};
+
+  LeafNodeT *CreateLeafNode(PageId &newPageId);
+
+  NonLeafNodeT *CreateNonLeafNode(PageId &newPageId);
 
   /**
    * BTreeIndex Constructor. 
-	 * Check to see if the corresponding index file exists. If so, open the file.
-	 * If not, create it and insert entries for every tuple in the base relation using FileScan class.
+	 * Check to see if the corresponding index file exists. If so, open the file: the root, the free
+	 * list and the leaf layout are read back from its meta page. The build settings of options are
+	 * ignored, and a leaf layout left at its default means the stored one.
+	 * If not, create it and bulk load it with an entry for every tuple in the base relation: the
+	 * (key, rid) pairs are collected using FileScan class, sorted (externally if they do not fit in
+	 * the memory budget, see IndexBuilder), and packed into the tree bottom-up.
    *
    * @param relationName        Name of file.
    * @param outIndexName        Return the name of index file.
    * @param bufMgrIn						Buffer Manager Instance
    * @param attrByteOffset			Offset of attribute, over which index is to be built, in the record
-   * @param attrType						Datatype of attribute over which index is built
-   * @throws  BadIndexInfoException     If the index file already exists for the corresponding attribute, but values in metapage(relationName, attribute byte offset, attribute type etc.) do not match with values received through constructor parameters.
+   * @param attrType						Datatype of attribute over which index is built, must match the key type of the index
+   * @param options						Fill factor, memory budget, threads, merge fan-in, leaf layout and included columns of the build
+   * @throws  BadIndexInfoException     If attrType does not match the key type of the index, or the included columns are not supported, or the index file already exists for the corresponding attribute, but values in metapage(relationName, attribute byte offset, attribute type, leaf compression or included columns when options asks for them) do not match with values received through constructor parameters.
    */
 	BTreeIndex(const std::string & relationName, std::string & outIndexName,
-						BufMgr *bufMgrIn,	const int attrByteOffset,	const Datatype attrType);
+						BufMgr *bufMgrIn,	const int attrByteOffset,	const Datatype attrType,
+						const IndexBuildOptions & options = IndexBuildOptions());
 	
 
   /**
@@ -353,55 +1290,591 @@ class BTreeIndex {
 	**/
 	const void insertEntry(const void* key, const RecordId rid);
 
+  /**
+	 * Insert a batch of entries, as if by insertEntry on each in turn. The batch is sorted, and the
+	 * entries that fall into the same leaf are merged into it in one pass under a single descent.
+	 * A leaf that fills up splits as it would for a single insert, and the descent that follows
+	 * merges the remaining entries into the halves.
+   * @param entries	Entries to insert, in any order
+	**/
+	const void insertBatch(const std::vector< RIDKeyPair<KeyT> >& entries);
+
   // -------------------------------------------------------------
 	// @brief splitLeafNode performs the split of a leaf node into two
 	// 	  when an insertion is performed on a full node
 	// key:		the key being inserted
 	// rid:		the rid being inserted
+	// payload:	the included columns of the entry being inserted
 	// pageNo:	the pointer to the node being split
+	// path:	the non-leaf nodes the split may reach, from the top
+	// 		down to the parent of the node, empty if it is the root
 	// returns:	void
 	// -------------------------------------------------------------
-  const void splitLeafNode(int key, const RecordId rid,  PageId pageNo);
+  const void splitLeafNode(const KeyT& key, const RecordId rid, const char* payload, PageId pageNo, std::vector<PageId>& path);
 
   //--------------------------------------------------------------------
 	// @brief	splitNonLeafNode is used for splitting a node
 	// 		that is not a leaf node. Revolutionary!
 	// key:		the key that causes overflow
-	// pageNo:	something
+	// path:	the non-leaf nodes down to the full one being split,
+	// 		which is taken off the end
+	// leftPageNo:	the child that split one level down, left of key
+	// previousNewPageNo:	the page to the right of key, created by the
+	// 		split one level down
+	//--------------------------------------------------------------------
+	const void splitNonLeafNode(const KeyT& key, std::vector<PageId>& path, PageId leftPageNo, PageId previousNewPageNo);
+
+  //--------------------------------------------------------------------
+	// @brief	splitLeafContents moves the upper half of a full pinned
+	// 		leaf, with the new entry in place, to a new right sibling,
+	// 		linking it in and passing on the high key
+	// pageNo:	the page number of node, which the caller holds
+	// 		exclusive if other threads may be using the index
+	// newPageNo, newNode:	the new leaf is returned in these, still
+	// 		pinned
+	// returns:	the separator between the two halves
+	//--------------------------------------------------------------------
+	KeyT splitLeafContents(PageId pageNo, LeafNodeT* node, const KeyT& key, const RecordId rid, const char* payload,
+			PageId& newPageNo, LeafNodeT*& newNode);
+
+  //--------------------------------------------------------------------
+	// @brief	splitNonLeafContents moves the upper half of a full pinned
+	// 		non-leaf node, with key as separator pos and rightPageNo
+	// 		after it, to a new right sibling, linking it in and passing
+	// 		on the high key
+	// newPageNo, newNode:	the new node is returned in these, still
+	// 		pinned
+	// returns:	the middle key, which is in neither half
+	//--------------------------------------------------------------------
+	KeyT splitNonLeafContents(NonLeafNodeT* node, int pos, const KeyT& key, PageId rightPageNo, PageId& newPageNo, NonLeafNodeT*& newNode);
+
+  //--------------------------------------------------------------------
+	// @brief	growRoot puts a new root above the old one and the node
+	// 		split off it
+	// level:	the level of the new root
+	//--------------------------------------------------------------------
+	void growRoot(PageId leftPageNo, const KeyT& key, PageId rightPageNo, int level);
+
+  //--------------------------------------------------------------------
+	// @brief	insertIntoLeaf places a key and rid into a leaf that
+	// 		still has room, keeping keyArray sorted
+	// node:	the pinned leaf receiving the entry
+	// payload:	the included columns of the entry
+	//--------------------------------------------------------------------
+	void insertIntoLeaf(LeafNodeT* node, const KeyT& key, const RecordId rid, const char* payload);
+
+  //--------------------------------------------------------------------
+	// @brief	mergeIntoLeaf places a sorted run of entries into a leaf
+	// 		that has room for all of them, moving every old entry at
+	// 		most once. Duplicates go after the keys already present
+	// node:	the pinned leaf receiving the entries
+	// payloads:	the included columns of every entry, in the same order
+	// first, last:	the run of entries to place
+	//--------------------------------------------------------------------
+	void mergeIntoLeaf(LeafNodeT* node, const std::vector< RIDKeyPair<KeyT> >& entries, const char* payloads, size_t first, size_t last);
+
+  //--------------------------------------------------------------------
+	// @brief	insertIntoNonLeaf adds a separator key and the page to its
+	// 		right into a non-leaf node, splitting it if it is full
+	// key:		the separator pushed up from the split child
+	// path:	the non-leaf nodes down to the one receiving the
+	// 		separator, which is taken off the end
+	// leftPageNo:	the child that split, which the separator goes after
+	// rightPageNo:	the new page created by the split of the child
+	//--------------------------------------------------------------------
+	const void insertIntoNonLeaf(const KeyT& key, std::vector<PageId>& path, PageId leftPageNo, PageId rightPageNo);
+
+  /**
+	 * Delete the entry <key,rid> from the index. Duplicates of key with other record ids stay.
+	 * A leaf left less than half full borrows an entry from a sibling under the same parent that
+	 * can spare one, or is merged with that sibling otherwise. A merge removes a separator from
+	 * the parent, which may underflow in turn, up to the root. A root left with a single child is
+	 * replaced by that child. Pages emptied by merges are kept for reuse by later node allocations.
+	 * Any executing scan is ended first, since the leaf it is positioned on may be merged away.
+   * @param key			Key to delete, pointer to integer/double/char string
+   * @param rid			Record ID of the entry to delete
+   * @throws  NoSuchKeyFoundException If the index holds no entry <key,rid>
+	**/
+	const void deleteEntry(const void* key, const RecordId rid);
+
+  //--------------------------------------------------------------------
+	// @brief	rebalanceLeaf fixes a leaf that may have dropped below
+	// 		half full, by borrowing from or merging with a sibling
+	// pageNo:	the leaf an entry was deleted from
+	// path:	the non-leaf nodes from the root down to its parent
+	//--------------------------------------------------------------------
+	void rebalanceLeaf(PageId pageNo, std::vector<PageId>& path);
+
+  //--------------------------------------------------------------------
+	// @brief	rebalanceNonLeaf fixes a non-leaf node that may have
+	// 		dropped below half full after losing a child, and
+	// 		collapses the root once it has a single child left
+	// path:	the non-leaf nodes from the root down to the one a
+	// 		separator was removed from, which is taken off the end
+	//--------------------------------------------------------------------
+	void rebalanceNonLeaf(std::vector<PageId>& path);
+
+  //--------------------------------------------------------------------
+	// @brief	movePathRight updates the path down to a node for its
+	// 		right sibling, moving the node on it at each level right
+	// 		as long as the sibling is not under the node kept there
+	// depth:	the number of nodes on the path above the sibling
+	// pageNo:	the right sibling
+	//--------------------------------------------------------------------
+	void movePathRight(std::vector<PageId>& path, const size_t depth, PageId pageNo);
+
+  //--------------------------------------------------------------------
+	// @brief	removeFromNonLeaf drops separator keyIndex and the child
+	// 		to its right from a pinned non-leaf node
+	//--------------------------------------------------------------------
+	void removeFromNonLeaf(NonLeafNodeT* node, int keyIndex);
+
+  //--------------------------------------------------------------------
+	// @brief	nodeLowerBound finds key among the first numKeys
+	// 		separators of a non-leaf node, as lowerBound does in a
+	// 		keyArray. Safe on a node read without a latch, as long as
+	// 		numKeys is in range
+	//--------------------------------------------------------------------
+	int nodeLowerBound(const NonLeafNodeT* node, const int numKeys, const KeyT& key);
+
+  //--------------------------------------------------------------------
+	// @brief	nodeKey returns separator i of a non-leaf node, and
+	// 		nodeKeys copies out all of them
+	//--------------------------------------------------------------------
+	KeyT nodeKey(const NonLeafNodeT* node, const int i);
+	void nodeKeys(const NonLeafNodeT* node, KeyT* keys);
+
+  //--------------------------------------------------------------------
+	// @brief	nodeHasRoom tells whether a non-leaf node can take key
+	// 		without splitting
+	// key:		the separator to add, NULL for whichever one may come
+	// fillFactor:	the fraction of the node that may be used
+	//--------------------------------------------------------------------
+	bool nodeHasRoom(const NonLeafNodeT* node, const KeyT* key, const double fillFactor = 1.0);
+
+  //--------------------------------------------------------------------
+	// @brief	nodeInsert puts key at separator pos of a non-leaf node
+	// 		that has room for it, with rightPageNo as the child to
+	// 		its right
+	//--------------------------------------------------------------------
+	void nodeInsert(NonLeafNodeT* node, const int pos, const KeyT& key, PageId rightPageNo);
+
+  //--------------------------------------------------------------------
+	// @brief	nodeFits tells whether a non-leaf node can hold the
+	// 		given sorted separators
+	//--------------------------------------------------------------------
+	bool nodeFits(const KeyT* keys, const int numKeys);
+
+  //--------------------------------------------------------------------
+	// @brief	nodeFill replaces the separators and children of a
+	// 		non-leaf node, with numKeys + 1 children
+	// returns:	false, leaving the node as it was, if they do not fit
+	//--------------------------------------------------------------------
+	bool nodeFill(NonLeafNodeT* node, const KeyT* keys, const PageId* pageNos, const int numKeys);
+
+  //--------------------------------------------------------------------
+	// @brief	nodeSetKey replaces separator i of a non-leaf node
+	// returns:	false, leaving the node as it was, if key does not fit
+	//--------------------------------------------------------------------
+	bool nodeSetKey(NonLeafNodeT* node, const int i, const KeyT& key);
+
+  //--------------------------------------------------------------------
+	// @brief	nodeUnderfull tells whether a non-leaf node is below half
+	// 		full, and nodeCanSpare whether it stays at least half
+	// 		full after giving a separator to a sibling
+	//--------------------------------------------------------------------
+	bool nodeUnderfull(const NonLeafNodeT* node);
+	bool nodeCanSpare(const NonLeafNodeT* node);
+
+  //--------------------------------------------------------------------
+	// @brief	leafNumKeys returns the number of entries of a leaf, kept
+	// 		within what the leaf can hold in case it is read without
+	// 		a latch while it changes
+	//--------------------------------------------------------------------
+	int leafNumKeys(const LeafNodeT* leaf);
+
+  //--------------------------------------------------------------------
+	// @brief	leafLowerBound and leafUpperBound find key among the
+	// 		first numKeys entries of a leaf, as lowerBound and
+	// 		upperBound do in a keyArray. Safe on a leaf read without a
+	// 		latch, as long as numKeys comes from leafNumKeys
+	//--------------------------------------------------------------------
+	int leafLowerBound(const LeafNodeT* leaf, const int numKeys, const KeyT& key);
+	int leafUpperBound(const LeafNodeT* leaf, const int numKeys, const KeyT& key);
+
+  //--------------------------------------------------------------------
+	// @brief	leafKey and leafRid return the key and the record id of
+	// 		entry i of a leaf
+	//--------------------------------------------------------------------
+	KeyT leafKey(const LeafNodeT* leaf, const int i);
+	RecordId leafRid(const LeafNodeT* leaf, const int i);
+
+  //--------------------------------------------------------------------
+	// @brief	leafRids copies the record ids of entries begin .. end-1
+	// 		of a leaf into rids
+	//--------------------------------------------------------------------
+	void leafRids(const LeafNodeT* leaf, const int begin, const int end, RecordId* rids);
+
+  //--------------------------------------------------------------------
+	// @brief	leafPayloads copies the included columns of entries
+	// 		begin .. end-1 of a leaf into payloads, payloadBytes each
+	//--------------------------------------------------------------------
+	void leafPayloads(const LeafNodeT* leaf, const int begin, const int end, char* payloads);
+
+  //--------------------------------------------------------------------
+	// @brief	leafEntries copies out the keys, record ids and included
+	// 		columns of all entries of a leaf
+	// payloads:	may be NULL if the index has no included columns
+	//--------------------------------------------------------------------
+	void leafEntries(const LeafNodeT* leaf, KeyT* keys, RecordId* rids, char* payloads);
+
+  //--------------------------------------------------------------------
+	// @brief	leafFits tells whether a leaf can hold entries with the
+	// 		given sorted keys
+	//--------------------------------------------------------------------
+	bool leafFits(const KeyT* keys, const int numKeys);
+
+  //--------------------------------------------------------------------
+	// @brief	leafFill replaces the entries of a leaf
+	// payloads:	may be NULL if the index has no included columns
+	// returns:	false, leaving the leaf as it was, if they do not fit
+	//--------------------------------------------------------------------
+	bool leafFill(LeafNodeT* leaf, const KeyT* keys, const RecordId* rids, const char* payloads, const int numKeys);
+
+  //--------------------------------------------------------------------
+	// @brief	leafRoom tells how many more entries with keys from low
+	// 		to high a leaf can take, 0 or less if it is full
+	// fillFactor:	the fraction of the leaf that may be used
+	//--------------------------------------------------------------------
+	int leafRoom(const LeafNodeT* leaf, const KeyT& low, const KeyT& high, const double fillFactor = 1.0);
+
+  //--------------------------------------------------------------------
+	// @brief	leafInsert puts an entry at position pos of a leaf that
+	// 		has room for it, and leafRemove drops entry pos
+	// payload:	may be NULL if the index has no included columns
+	//--------------------------------------------------------------------
+	void leafInsert(LeafNodeT* leaf, const int pos, const KeyT& key, const RecordId rid, const char* payload);
+	void leafRemove(LeafNodeT* leaf, const int pos);
+
+  //--------------------------------------------------------------------
+	// @brief	setIncludedColumns checks the columns a covering index
+	// 		stores in its leaves and sizes the leaves for them
+	//--------------------------------------------------------------------
+	void setIncludedColumns(const std::string& relationName, const IncludedColumn* columns, const int numColumns);
+
+  //--------------------------------------------------------------------
+	// @brief	readPayload copies the included columns out of the record
+	// 		rid points at. Columns past the end of the record read
+	// 		as zeros
+	//--------------------------------------------------------------------
+	void readPayload(const RecordId rid, char* payload);
+
+  //--------------------------------------------------------------------
+	// @brief	childIndex finds the slot of a child in pageNoArray
+	//--------------------------------------------------------------------
+	int childIndex(NonLeafNodeT* node, PageId childPageNo);
+
+  //--------------------------------------------------------------------
+	// @brief	allocNodePage pins a page for a new node, reusing a freed
+	// 		page when there is one
+	//--------------------------------------------------------------------
+	void allocNodePage(PageId& pageNo, Page*& page);
+
+  //--------------------------------------------------------------------
+	// @brief	freeNodePage puts a page that no longer holds a node on the
+	// 		free list, dropping it from the pinned levels if it is there
 	//--------------------------------------------------------------------
-	const void splitNonLeafNode(int key, PageId pageNo, PageId previousNewPageNo);
+	void freeNodePage(PageId pageNo);
 
   //--------------------------------------------------------------------
-	// @brief	findLeafNode traverses the tree downwards to find the
-	// 		leaf node that fits the given key
-	// key:		the key to insert
-	// pageNo:	a NonLeafNodeInt* that will serve as the start of the search
-	// returns:	the LeafNodeInt* where the key is in range
+	// @brief	writeMetaPage copies indexMetaInfo to the meta page, so
+	// 		that the index can be reopened from its file
 	//--------------------------------------------------------------------
-	LeafNodeInt* findLeafNode(int key, PageId pageNo);
+	void writeMetaPage();
+
+  //--------------------------------------------------------------------
+	// @brief	readNode gets the frame of a node for a descent, from the
+	// 		pinned levels if it is there and otherwise pinned by the
+	// 		buffer manager, non-leaves through readNonLeaf
+	// isLeaf:	leaves are always pinned by the buffer manager, as
+	// 		their callers unpin them
+	// returns:	whether the frame came from the pinned levels
+	//--------------------------------------------------------------------
+	bool readNode(PageId pageNo, Page*& page, const bool isLeaf);
+
+  //--------------------------------------------------------------------
+	// @brief	readNonLeaf pins a non-leaf node in the frame it was last
+	// 		read into, going through the buffer manager's hash table
+	// 		only if the node has left that frame since
+	//--------------------------------------------------------------------
+	void readNonLeaf(PageId pageNo, Page*& page);
+
+  //--------------------------------------------------------------------
+	// @brief	peekNode gets the frame of a node for an optimistic
+	// 		descent like readNode, but looks for a non-leaf in the frame
+	// 		it was last read into first, which neither pins it nor asks
+	// 		the buffer manager
+	// version:	the latch version to validate reads of the node against
+	// 		is returned in this
+	// returns:	whether the node was read without pinning it
+	//--------------------------------------------------------------------
+	bool peekNode(PageId pageNo, Page*& page, unsigned long& version, const bool isLeaf);
+
+  //--------------------------------------------------------------------
+	// @brief	swizzle records the frame a non-leaf node was read into
+	//--------------------------------------------------------------------
+	void swizzle(PageId pageNo, const Page* page);
+
+  //--------------------------------------------------------------------
+	// @brief	releaseNode unpins a node read with readNode or peekNode,
+	// 		unless it was read without pinning it, by its frame
+	//--------------------------------------------------------------------
+	void releaseNode(const Page* page, const bool pinned);
+
+  //--------------------------------------------------------------------
+	// @brief	pinnedFrame finds the frame of a pinned page
+	// returns:	the frame, NULL if the page is not pinned
+	//--------------------------------------------------------------------
+	Page* pinnedFrame(PageId pageNo);
+
+  //--------------------------------------------------------------------
+	// @brief	pinNode adds a page to the pinned levels if the memory
+	// 		budget allows
+	// returns:	whether the page is pinned
+	//--------------------------------------------------------------------
+	bool pinNode(PageId pageNo);
+
+  //--------------------------------------------------------------------
+	// @brief	pinTopLevels pins the nodes of the top pinnedLevels levels,
+	// 		stopping at the first level that does not fit the budget
+	//--------------------------------------------------------------------
+	void pinTopLevels();
+
+  //--------------------------------------------------------------------
+	// @brief	unpinNode drops a page from the pinned levels, if it is
+	// 		there, and unpins it
+	//--------------------------------------------------------------------
+	void unpinNode(PageId pageNo);
+
+  //--------------------------------------------------------------------
+	// @brief	unpinLevels unpins every pinned page
+	//--------------------------------------------------------------------
+	void unpinLevels();
+
+  //--------------------------------------------------------------------
+	// @brief	findLeafNode traverses the tree downwards from the root to
+	// 		find the leaf node that fits the given key, latch coupling
+	// 		with shared latches
+	// key:		the key to search for
+	// leafPageNo:	the page number of the leaf is returned in this
+	// exclusiveLeaf:	latch the leaf exclusive instead of shared
+	// path:	if not NULL, the non-leaf nodes passed on the way down
+	// 		are appended to it
+	// returns:	the LeafNodeT* where the key is in range, pinned and
+	// 		latched
+	//--------------------------------------------------------------------
+	LeafNodeT* findLeafNode(const KeyT& key, PageId& leafPageNo, const bool exclusiveLeaf, std::vector<PageId>* path);
+
+  //--------------------------------------------------------------------
+	// @brief	findLeafOptimistic traverses the tree downwards from the
+	// 		root like findLeafNode, but latches nothing and restarts
+	// 		from the root whenever a node changed while being read.
+	// 		Non-leaf nodes are not pinned either when they are still
+	// 		in the frame they were last read into, see peekNode
+	// key:		the key to search for
+	// leafPageNo:	the page number of the leaf is returned in this
+	// version:	the leaf latch version the caller validates its reads
+	// 		of the leaf against is returned in this
+	// returns:	the LeafNodeT* where the key is in range, pinned only
+	//--------------------------------------------------------------------
+	LeafNodeT* findLeafOptimistic(const KeyT& key, PageId& leafPageNo, unsigned long& version);
+
+  //--------------------------------------------------------------------
+	// @brief	positionScan finds the first leaf holding an entry past
+	// 		the low bound, or for a backward scan the last leaf that
+	// 		may hold one within the high bound, copying its matching
+	// 		record ids into cursor.
+	// 		Returns false if an optimistic read has to be retried.
+	//--------------------------------------------------------------------
+	bool positionScan(BTreeScanCursor<KeyT>& cursor);
+
+  //--------------------------------------------------------------------
+	// @brief	insertPessimistic inserts an entry whose leaf may have to
+	// 		split, latching exclusive from the root down and keeping
+	// 		every node that could split along with the first one above
+	// 		them that cannot
+	//--------------------------------------------------------------------
+	void insertPessimistic(const KeyT& key, const RecordId rid, const char* payload);
+
+  //--------------------------------------------------------------------
+	// @brief	descendBlink finds the node at the given level that fits
+	// 		key, latching one node at a time and moving right past
+	// 		nodes that split since their parent was read
+	// level:	0 for a leaf, the node level otherwise
+	// pageNo:	the page number of the node is returned in this
+	// exclusive:	latch the node found exclusive instead of shared
+	// path:	if not NULL, the non-leaf nodes passed on the way down
+	// 		are appended to it
+	// returns:	the node, pinned and latched
+	//--------------------------------------------------------------------
+	Page* descendBlink(const KeyT& key, const int level, PageId& pageNo, const bool exclusive, std::vector<PageId>* path);
+
+  //--------------------------------------------------------------------
+	// @brief	moveRightBlink follows right links from a latched node
+	// 		until reaching the one whose high key covers key, latching
+	// 		each before releasing the one left of it
+	// pinned:	whether the node was taken from the pinned levels,
+	// 		updated for the node returned
+	//--------------------------------------------------------------------
+	Page* moveRightBlink(const KeyT& key, PageId& pageNo, Page* page, const bool isLeaf, const bool exclusive, bool& pinned);
+
+  //--------------------------------------------------------------------
+	// @brief	insertBlink inserts an entry in B_LINK mode. A full leaf is
+	// 		split while only it is latched, then the separator goes to
+	// 		the parent, latched while still holding the child and found
+	// 		by moving right from the parent seen on the way down
+	//--------------------------------------------------------------------
+	void insertBlink(const KeyT& key, const RecordId rid, const char* payload);
+
+  //--------------------------------------------------------------------
+	// @brief	fillScan copies the record ids of a leaf that fall within
+	// 		the scan bounds into the cursor, in scan order. The leaf
+	// 		is either latched or read optimistically, in which case
+	// 		numKeys may be torn and is kept within the leaf capacity
+	// first:	true for the leaf the scan starts in. The leaves after
+	// 		it only need to be checked against the far bound
+	//--------------------------------------------------------------------
+	void fillScan(BTreeScanCursor<KeyT>& cursor, LeafNodeT* leaf, PageId pageNo, const bool first);
+
+  //--------------------------------------------------------------------
+	// @brief	advanceScan copies the matching record ids of the leaf
+	// 		the cursor moves on to. Moving left, a leaf that split
+	// 		since its page number was read is followed right to the
+	// 		leaf just before the one the cursor came from
+	//--------------------------------------------------------------------
+	void advanceScan(BTreeScanCursor<KeyT>& cursor);
+
+  //--------------------------------------------------------------------
+	// @brief	findThreadCursor returns the cursor bound to the calling
+	// 		thread on this index, or NULL if it has none
+	//--------------------------------------------------------------------
+	BTreeScanCursor<KeyT>* findThreadCursor();
+
+  //--------------------------------------------------------------------
+	// @brief	threadCursor returns the cursor behind the scan the
+	// 		calling thread runs through startScan on this index,
+	// 		throwing ScanNotInitializedException if it has none
+	//--------------------------------------------------------------------
+	BTreeScanCursor<KeyT>& threadCursor();
+
+  //--------------------------------------------------------------------
+	// @brief	bindThreadCursor returns the cursor bound to the calling
+	// 		thread, binding a free or new one if it has none
+	//--------------------------------------------------------------------
+	BTreeScanCursor<KeyT>& bindThreadCursor();
+
+  //--------------------------------------------------------------------
+	// @brief	releaseThreadCursor returns the cursor bound to the
+	// 		calling thread to freeCursors
+	//--------------------------------------------------------------------
+	void releaseThreadCursor(BTreeScanCursor<KeyT>* cursor);
+
+  //--------------------------------------------------------------------
+	// @brief	lastThreadCursor is the cursor the calling thread last
+	// 		found or bound, with the indexId of its index, so that
+	// 		scanNext takes no mutex. Plain data, so threads keep it
+	// 		without allocating
+	//--------------------------------------------------------------------
+	struct LastThreadCursor {
+		unsigned long indexId;
+		BTreeScanCursor<KeyT>* cursor;
+	};
+	static LastThreadCursor& lastThreadCursor();
+
+  //--------------------------------------------------------------------
+	// @brief	lookupEntries copies the record ids of the entries with
+	// 		key, moving right while equal keys may continue into the
+	// 		next leaf. Every leaf is released before returning
+	// outRids:	if not NULL, all matches are appended to it
+	// firstRid:	if outRids is NULL, the first match is returned in this
+	// returns:	the number of matches, or -1 if an optimistic read
+	// 		has to be retried, outRids then being left as it was
+	//--------------------------------------------------------------------
+	int lookupEntries(const KeyT& key, std::vector<RecordId>* outRids, RecordId* firstRid);
+
+  /**
+	 * Find one entry with the given key, for equality lookups that expect a single match.
+	 * Unlike a scan over [key, key], this sets up no scan state, keeps no page pinned once it
+	 * returns and throws nothing when the key is missing.
+   * @param key			Key to look up, pointer to integer/double/char string
+   * @param outRid	Record id of an entry with key returned in this, if one exists
+	 * @return True if the index holds an entry with key.
+	**/
+	bool lookup(const void* key, RecordId& outRid);
+
+  /**
+	 * Find every entry with the given key, duplicates included, like lookup.
+   * @param key			Key to look up, pointer to integer/double/char string
+   * @param outRids	Record ids of the entries with key returned in this, replacing its contents
+	 * @return Number of entries found.
+	**/
+	int lookupAll(const void* key, std::vector<RecordId>& outRids);
+
+  /**
+	 * Find every entry of each of a batch of keys, like lookupAll on each. The keys are sorted
+	 * and the batch descends the tree once, split among the children of every node it passes, so
+	 * each node on the way is pinned about once per batch rather than once per key.
+   * @param keys			Keys to look up, in any order and possibly repeated
+   * @param outRids	Record ids of the entries of keys[0], then of keys[1] and so on returned in this, replacing its contents
+   * @param outCounts	Number of entries of each key returned in this, replacing its contents
+	 * @return Total number of entries found.
+	**/
+	int multiGet(const std::vector<KeyT>& keys, std::vector<RecordId>& outRids, std::vector<int>& outCounts);
+
+  //--------------------------------------------------------------------
+	// @brief	multiGetNodes looks up a sorted run of probes in the
+	// 		subtree of a node and in the nodes right of it at the same
+	// 		level that the later probes have moved to, latching one
+	// 		node at a time like B_LINK mode in every read mode
+	// probes:	the sorted (key, position in the batch) pairs
+	// first, last:	the run of probes to look up
+	// nextPageNo:	the node the caller looks up the probes from last on
+	// 		in next, or INVALID_NUMBER. Probes that move right to it
+	// 		are handed back rather than followed, so that it is
+	// 		pinned once
+	// matches:	(position, record id) of every entry found are appended
+	// 		to it
+	// return:	the first probe handed back, last if there are none
+	//--------------------------------------------------------------------
+	int multiGetNodes(PageId pageNo, bool isLeaf, const std::vector< std::pair<KeyT, int> >& probes,
+			int first, int last, PageId nextPageNo, std::vector< std::pair<int, RecordId> >& matches);
 
 
   /**
 	 * Begin a filtered scan of the index.  For instance, if the method is called 
 	 * using ("a",GT,"d",LTE) then we should seek all entries with a value 
 	 * greater than "a" and less than or equal to "d".
-	 * If another scan is already executing, that needs to be ended here.
+	 * If another scan is already executing in the calling thread, that needs to be ended here.
 	 * Set up all the variables for scan. Start from root to find out the leaf page that contains the first RecordID
-	 * that satisfies the scan parameters. Keep that page pinned in the buffer pool.
+	 * that satisfies the scan parameters, and copy out the matching record ids of that leaf.
+	 * A BACKWARD scan starts from the high bound and returns entries in descending key order, so that
+	 * the largest k keys of a range cost only the leaves holding them.
    * @param lowVal	Low value of range, pointer to integer / double / char string
    * @param lowOp		Low operator (GT/GTE)
    * @param highVal	High value of range, pointer to integer / double / char string
    * @param highOp	High operator (LT/LTE)
+   * @param direction	FORWARD to return entries in ascending key order, BACKWARD for descending
    * @throws  BadOpcodesException If lowOp and highOp do not contain one of their their expected values 
    * @throws  BadScanrangeException If lowVal > highval
 	 * @throws  NoSuchKeyFoundException If there is no key in the B+ tree that satisfies the scan criteria.
 	**/
-	const void startScan(const void* lowVal, const Operator lowOp, const void* highVal, const Operator highOp);
+	const void startScan(const void* lowVal, const Operator lowOp, const void* highVal, const Operator highOp,
+			const ScanDirection direction = FORWARD);
 
 
   /**
 	 * Fetch the record id of the next index entry that matches the scan.
-	 * Return the next record from current page being scanned. If current page has been scanned to its entirety, move on to the right sibling of current page, if any exists, to start scanning that page. Make sure to unpin any pages that are no longer required.
+	 * Return the next record id copied from the current leaf. Once those are used up, move on to the sibling of that leaf in the scan direction, if any exists, and copy out its matching record ids.
    * @param outRid	RecordId of next record found that satisfies the scan criteria returned in this
 	 * @throws ScanNotInitializedException If no scan has been initialized.
 	 * @throws IndexScanCompletedException If no more records, satisfying the scan criteria, are left to be scanned.
@@ -410,12 +1883,83 @@ class BTreeIndex {
 
 
   /**
-	 * Terminate the current scan. Unpin any pinned pages. Reset scan specific variables.
+	 * Fetch the record id of the next index entry that matches the scan, like scanNext, along with
+	 * its included columns (see IndexBuildOptions::includedColumns), so that queries on those
+	 * columns need not read the record from the relation.
+   * @param outRid	RecordId of next record found that satisfies the scan criteria returned in this
+   * @param outPayload	Receives getPayloadSize() bytes: each included column in turn, as stored in the record
+	 * @throws ScanNotInitializedException If no scan has been initialized.
+	 * @throws IndexScanCompletedException If no more records, satisfying the scan criteria, are left to be scanned.
+	 * @throws BadIndexInfoException If the index has no included columns.
+	**/
+	const void scanNext(RecordId& outRid, void* outPayload);
+
+
+  /**
+	 * Fetch the record ids of up to maxCount next index entries that match the scan.
+	 * Whole runs of record ids are copied from each leaf at once, and the end of the scan is
+	 * reported through the return value rather than with IndexScanCompletedException, so
+	 * long range scans should prefer this to scanNext. Both may be mixed within one scan.
+   * @param outRids	Record ids found that satisfy the scan criteria returned in this, replacing its contents
+   * @param maxCount	Largest number of record ids to return
+	 * @return False, with outRids left empty, once no more records are left to be scanned.
+	 * @throws ScanNotInitializedException If no scan has been initialized.
+	**/
+	bool scanNextBatch(std::vector<RecordId>& outRids, const int maxCount);
+
+
+  /**
+	 * Terminate the calling thread's current scan. Reset scan specific variables.
 	 * @throws ScanNotInitializedException If no scan has been initialized.
 	**/
 	const void endScan();
 
   const void PrintTree(PageId pageNum, bool IsLeaf);
+
+  /**
+	 * Select how keys are located inside a node during descents, inserts and scans.
+	 * Defaults to SIMD_SEARCH, which is plain binary search for keys other than int.
+   * @param strategy	LINEAR_SEARCH, BINARY_SEARCH or SIMD_SEARCH
+	**/
+	void setSearchStrategy(const SearchStrategy strategy);
+
+  /**
+	 * Select how lookups and scans synchronize with concurrent inserts. Defaults to LATCH_CRABBING.
+	 * Inserts latch exclusive in every mode; with B_LINK they also split bottom-up.
+   * @param mode	LATCH_CRABBING, OPTIMISTIC_LOCK_COUPLING or B_LINK
+	**/
+	void setReadMode(const ReadMode mode);
+
+  /**
+	 * Keep the nodes of the top levels of the tree, the root first, pinned in the buffer pool, so
+	 * that descents only go through the buffer manager below them. A level is pinned whole or not
+	 * at all, and no level is added once the pinned pages would take more than memoryBudget. Nodes
+	 * split off a pinned level and new roots are pinned as they are made, while the budget lasts.
+	 * Leaves are never pinned. Defaults to DEFAULT_PINNED_LEVELS levels within DEFAULT_PIN_MEMORY.
+   * @param levels	Number of levels to pin, 0 to pin nothing
+   * @param memoryBudget	Bytes of the buffer pool the pinned pages may take
+	**/
+	void setPinnedLevels(const int levels, const size_t memoryBudget);
+
+  /**
+	 * Number of levels in the tree, counting the leaf level. A tree whose root is a leaf has height 1.
+	**/
+	int getHeight();
+
+  /**
+	 * Number of nodes kept pinned in the buffer pool, see setPinnedLevels().
+	**/
+	int getPinnedNodes();
+
+  /**
+	 * Number of bytes the included columns take per entry, 0 if the index has none.
+	**/
+	int getPayloadSize() const;
+
+  /**
+	 * Phase timings and run counts of the build done when the index was constructed.
+	**/
+	const IndexBuildStats& getBuildStats() const;
 	
 };
 
@@ -7,6 +7,7 @@
 
 #include <memory>
 #include <iostream>
+#include <algorithm>
 #include "buffer.h"
 #include "exceptions/buffer_exceeded_exception.h"
 #include "exceptions/page_not_pinned_exception.h"
@@ -31,6 +32,7 @@ BufMgr::BufMgr(std::uint32_t bufs)
   }
 
   bufPool = new Page[bufs];
+  frameLatches = new RWLatch[bufs];
 
   int htsize = ((((int) (bufs * 1.2))*2)/2)+1;
   hashTable = new BufHashTbl (htsize);  // allocate the buffer hash table
@@ -52,13 +54,14 @@ BufMgr::~BufMgr() {
 
   delete [] bufDescTable;
   delete [] bufPool;
+  delete [] frameLatches;
 }
 
-void BufMgr::allocBuf(FrameId & frame) 
+void BufMgr::allocBuf(FrameId & frame, File*& evictedFile, PageId& evictedPageNo) 
 {
   // perform first part of clock algorithm to search for 
   // open buffer frame
-  // Assumes non-concurrent access to buffer manager
+  // Callers hold the buffer manager mutex
   std::uint32_t numScanned = 0;
   bool found = 0;
 
@@ -90,7 +93,6 @@ void BufMgr::allocBuf(FrameId & frame)
     else
     {
       // has been referenced, clear the bit
-      bufStats.accesses++;
       bufDescTable[clockHand].refbit = false;
     }
   }
@@ -101,15 +103,22 @@ void BufMgr::allocBuf(FrameId & frame)
     throw BufferExceededException();
   }
   
-  // flush any existing changes to disk if necessary
+  // existing changes are flushed to disk by the caller, once the mutex is released; until
+  // then the page may not be read back in
+  evictedFile = NULL;
+  evictedPageNo = Page::INVALID_NUMBER;
   if (bufDescTable[clockHand].dirty)
   {
     bufStats.diskwrites++;
-    //status = bufDescTable[clockHand].file->writePage(bufDescTable[clockHand].pageNo,
-    bufDescTable[clockHand].file->writePage(bufDescTable[clockHand].pageNo, bufPool[clockHand]);
+    evictedFile = bufDescTable[clockHand].file;
+    evictedPageNo = bufDescTable[clockHand].pageNo;
+    writingBack.push_back(std::make_pair((const File*) evictedFile, evictedPageNo));
   }
 
-	//Reset all the BufDesc entry for the frame before returning the frame
+	//Reset all the BufDesc entry for the frame before returning the frame. Its latch moves the
+	//version seen by optimistic readers of the page leaving it, see peekFrame(), and is held
+	//until the caller has put the new page in
+  frameLatches[clockHand].lock(true);
   bufDescTable[clockHand].Clear();
 
   // return new frame number
@@ -119,43 +128,106 @@ void BufMgr::allocBuf(FrameId & frame)
 	
 void BufMgr::readPage(File* file, const PageId pageNo, Page*& page)
 {
+  std::unique_lock<std::mutex> guard(mutex);
+  bufStats.accesses++;
   // check to see if it is already in the buffer pool
   // std::cout << "readPage called on file.page " << file << "." << pageNo << endl;
   FrameId frameNo = 0;
-	try
-	{
-  	hashTable->lookup(file, pageNo, frameNo);
+  while (true)
+  {
+    try
+    {
+      bufStats.hashlookups++;
+      hashTable->lookup(file, pageNo, frameNo);
+    }
+    catch(HashNotFoundException e) //not in the buffer pool, unless it is still being written out
+    {
+      if (!isWritingBack(file, pageNo))
+      {
+        break;
+      }
+      ioDone.wait(guard);
+      continue;
+    }
+
+    // another request is reading the page in; it may fail, so look it up again once done
+    if (bufDescTable[frameNo].ioPending)
+    {
+      ioDone.wait(guard);
+      continue;
+    }
 
     // set the referenced bit
     bufDescTable[frameNo].refbit = true;
     bufDescTable[frameNo].pinCnt++;
     page = &bufPool[frameNo];
+    return;
   }
-  catch(HashNotFoundException e) //not in the buffer pool, must allocate a new page
-  {
-    // alloc a new frame
-    allocBuf(frameNo);
 
-    // read the page into the new frame
-    bufStats.diskreads++;
-    //status = file->readPage(pageNo, &bufPool[frameNo]);
-    bufPool[frameNo] = file->readPage(pageNo);
+  // alloc a new frame, and insert the page in the hash table as pending, so that requests
+  // for it wait rather than read it a second time
+  File* evictedFile;
+  PageId evictedPageNo;
+  allocBuf(frameNo, evictedFile, evictedPageNo);
+  bufDescTable[frameNo].Set(file, pageNo);
+  bufDescTable[frameNo].ioPending = true;
+  hashTable->insert(file, pageNo, frameNo);
+  bufStats.diskreads++;
 
-    // set up the entry properly
-    bufDescTable[frameNo].Set(file, pageNo);
-    page = &bufPool[frameNo];
+  // write out the evicted page and read the page into the new frame with the mutex released
+  guard.unlock();
+  try
+  {
+    std::lock_guard<std::mutex> ioGuard(ioMutex);
+    if (evictedFile != NULL)
+    {
+      evictedFile->writePage(evictedPageNo, bufPool[frameNo]);
+    }
+    bufPool[frameNo] = file->readPage(pageNo);
+  }
+  catch(...)
+  {
+    guard.lock();
+    finishIo(frameNo, evictedFile, evictedPageNo, false);
+    throw;
+  }
+  guard.lock();
+  finishIo(frameNo, evictedFile, evictedPageNo, true);
+  page = &bufPool[frameNo];
+}
 
-    // insert in the hash table
-    hashTable->insert(file, pageNo, frameNo);
+void BufMgr::finishIo(const FrameId frameNo, const File* evictedFile, const PageId evictedPageNo, const bool succeeded)
+{
+  if (evictedFile != NULL)
+  {
+    writingBack.erase(std::find(writingBack.begin(), writingBack.end(), std::make_pair(evictedFile, evictedPageNo)));
+  }
+  if (!succeeded)
+  {
+    if (bufDescTable[frameNo].file != NULL)
+    {
+      hashTable->remove(bufDescTable[frameNo].file, bufDescTable[frameNo].pageNo);
+    }
+    bufDescTable[frameNo].Clear();
   }
+  bufDescTable[frameNo].ioPending = false;
+  frameLatches[frameNo].unlock();
+  ioDone.notify_all();
+}
+
+bool BufMgr::isWritingBack(const File* file, const PageId pageNo) const
+{
+  return std::find(writingBack.begin(), writingBack.end(), std::make_pair(file, pageNo)) != writingBack.end();
 }
 
 
 void BufMgr::unPinPage(File* file, const PageId pageNo, 
 			     const bool dirty) 
 {
+  std::lock_guard<std::mutex> guard(mutex);
   // lookup in hashtable
   FrameId frameNo = 0;
+  bufStats.hashlookups++;
   hashTable->lookup(file, pageNo, frameNo);
 
   if (dirty == true) bufDescTable[frameNo].dirty = dirty;
@@ -170,6 +242,17 @@ void BufMgr::unPinPage(File* file, const PageId pageNo,
 
 void BufMgr::flushFile(const File* file) 
 {
+  std::unique_lock<std::mutex> guard(mutex);
+  // pages of the file evicted by other requests must be on disk before the file may be closed
+  for (std::size_t i = 0; i < writingBack.size(); )
+  {
+    if (writingBack[i].first == file)
+    {
+      ioDone.wait(guard);
+      i = 0;
+    }
+    else i++;
+  }
   for (std::uint32_t i = 0; i < numBufs; i++)
 	{
   	BufDesc* tmpbuf = &(bufDescTable[i]);
@@ -181,6 +264,8 @@ void BufMgr::flushFile(const File* file)
 	    if (tmpbuf->dirty == true)
 			{
 				//if ((status = tmpbuf->file->writePage(tmpbuf->pageNo, &(bufPool[i]))) != OK)
+				bufStats.diskwrites++;
+				std::lock_guard<std::mutex> ioGuard(ioMutex);
 				tmpbuf->file->writePage(tmpbuf->pageNo, bufPool[i]);
 				tmpbuf->dirty = false;
     	}
@@ -193,8 +278,61 @@ void BufMgr::flushFile(const File* file)
   }
 }
 
+bool BufMgr::pinFrame(const File* file, const PageId pageNo, const FrameId frameNo, Page*& page)
+{
+  if (frameNo >= numBufs)
+  {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> guard(mutex);
+  BufDesc& desc = bufDescTable[frameNo];
+  if (!desc.valid || desc.ioPending || desc.file != file || desc.pageNo != pageNo)
+  {
+    return false;
+  }
+  bufStats.accesses++;
+  desc.refbit = true;
+  desc.pinCnt++;
+  page = &bufPool[frameNo];
+  return true;
+}
+
+void BufMgr::unPinFrame(const Page* page, const bool dirty)
+{
+  std::lock_guard<std::mutex> guard(mutex);
+  BufDesc& desc = bufDescTable[page - bufPool];
+  if (dirty == true) desc.dirty = dirty;
+
+  // make sure the page is actually pinned
+  if (desc.pinCnt == 0)
+  {
+  	throw PageNotPinnedException(desc.file->filename(), desc.pageNo, desc.frameNo);
+  }
+  else desc.pinCnt--;
+}
+
+Page* BufMgr::peekFrame(const File* file, const PageId pageNo, const FrameId frameNo, unsigned long& version)
+{
+  if (frameNo >= numBufs)
+  {
+    return NULL;
+  }
+
+  // a frame changes hands with its latch held exclusive, so once the version is read the
+  // entry names the page in the frame until the version moves
+  version = frameLatches[frameNo].readVersion();
+  const BufDesc& desc = bufDescTable[frameNo];
+  if (!desc.valid || desc.file != file || desc.pageNo != pageNo)
+  {
+    return NULL;
+  }
+  return &bufPool[frameNo];
+}
+
 void BufMgr::disposePage(File* file, const PageId pageNo) 
 {
+  std::lock_guard<std::mutex> guard(mutex);
 	//Deallocate from file altogether
   //See if it is in the buffer pool
   FrameId frameNo = 0;
@@ -206,31 +344,55 @@ void BufMgr::disposePage(File* file, const PageId pageNo)
 	hashTable->remove(file, pageNo);
 
   // deallocate it in the file	
+  std::lock_guard<std::mutex> ioGuard(ioMutex);
   file->deletePage(pageNo);
 }
 
 
 void BufMgr::allocPage(File* file, PageId &pageNo, Page*& page) 
 {
+  std::unique_lock<std::mutex> guard(mutex);
+  bufStats.accesses++;
   FrameId frameNo;
 
-  // alloc a new frame
-  allocBuf(frameNo);
+  // alloc a new frame, pinned for no page yet so that the clock passes it by while the
+  // mutex is released
+  File* evictedFile;
+  PageId evictedPageNo;
+  allocBuf(frameNo, evictedFile, evictedPageNo);
+  bufDescTable[frameNo].Set(NULL, Page::INVALID_NUMBER);
+  bufDescTable[frameNo].ioPending = true;
 
   // allocate a new page in the file
 	//std::cerr << "buffer data size:" << bufPool[frameNo].data_.length() << "\n";
-  bufPool[frameNo] = file->allocatePage(pageNo);
+  guard.unlock();
+  try
+  {
+    std::lock_guard<std::mutex> ioGuard(ioMutex);
+    if (evictedFile != NULL)
+    {
+      evictedFile->writePage(evictedPageNo, bufPool[frameNo]);
+    }
+    bufPool[frameNo] = file->allocatePage(pageNo);
+  }
+  catch(...)
+  {
+    guard.lock();
+    finishIo(frameNo, evictedFile, evictedPageNo, false);
+    throw;
+  }
+  guard.lock();
   page = &bufPool[frameNo];
 
-  // set up the entry properly
+  // set up the entry properly and insert it in the hash table
   bufDescTable[frameNo].Set(file, pageNo);
-
-  // insert in the hash table
   hashTable->insert(file, pageNo, frameNo);
+  finishIo(frameNo, evictedFile, evictedPageNo, true);
 }
 
 void BufMgr::printSelf(void) 
 {
+  std::lock_guard<std::mutex> guard(mutex);
   BufDesc* tmpbuf;
 	int validFrames = 0;
   
@@ -9,7 +9,12 @@
 
 #include "file.h"
 #include "bufHashTbl.h"
+#include "latch.h"
 #include <iostream>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#include <utility>
 
 namespace badgerdb {
 
@@ -56,6 +61,12 @@ class BufDesc {
 	 */
   bool valid;
 
+	/**
+   * True while the page is being read into the frame, or the frame is being given to a new page,
+   * with the buffer manager mutex released
+	 */
+  bool ioPending;
+
 	/**
    * Has this buffer frame been reference recently
 	 */
@@ -72,6 +83,7 @@ class BufDesc {
     dirty = false;
     refbit = false;
 		valid = false;
+    ioPending = false;
   };
 
 	/**
@@ -89,6 +101,7 @@ class BufDesc {
     dirty = false;
     valid = true;
     refbit = true;
+    ioPending = false;
   }
 
   void Print()
@@ -123,7 +136,7 @@ class BufDesc {
 struct BufStats
 {
 	/**
-   * Total number of accesses to buffer pool
+   * Total number of accesses to buffer pool, one for every page pinned by readPage or allocPage
 	 */
   int accesses;
 
@@ -137,12 +150,17 @@ struct BufStats
 	 */
   int diskwrites;
 
+	/**
+   * Number of probes of the hash table made to pin or unpin a page
+	 */
+  int hashlookups;
+
 	/**
    * Clear all values 
 	 */
   void clear()
   {
-		accesses = diskreads = diskwrites = 0;
+		accesses = diskreads = diskwrites = hashlookups = 0;
   }
       
 	/**
@@ -157,6 +175,11 @@ struct BufStats
 
 /**
 * @brief The central class which manages the buffer pool including frame allocation and deallocation to pages in the file 
+* All public methods may be called concurrently: the frame table, hash table and clock are guarded by one mutex,
+* which readPage and allocPage release around the disk I/O they trigger, so that pins and unpins of pages in the
+* pool do not wait behind a miss. The page being read is published in the hash table as pending, and requests
+* for it wait until it is in. The content of a pinned page is not protected by the buffer manager; threads sharing
+* a page coordinate through the page's latch, see pageLatch().
 */
 class BufMgr 
 {
@@ -187,12 +210,58 @@ class BufMgr
   BufStats bufStats;
 
 	/**
-	 * Allocate a free frame.  
+   * Guards clockHand, hashTable, bufDescTable, bufStats and writingBack
+	 */
+  std::mutex mutex;
+
+	/**
+   * Serializes the file I/O done by the buffer manager. File objects of the same file share one stream,
+   * which is not thread-safe, so reads and writes cannot overlap even with the mutex released
+	 */
+  std::mutex ioMutex;
+
+	/**
+   * Signalled, with the mutex, whenever a frame's pending I/O completes
+	 */
+  std::condition_variable ioDone;
+
+	/**
+   * Dirty pages evicted from the pool whose write-back has not completed yet. They must not be read
+   * back in from disk before it has
+	 */
+  std::vector< std::pair<const File*, PageId> > writingBack;
+
+	/**
+   * Reader/writer latch of every frame in the buffer pool
+	 */
+  RWLatch *frameLatches;
+
+	/**
+	 * Allocate a free frame. Callers hold the mutex; the frame is returned latched exclusive.
+	 * A dirty page evicted from the frame is added to writingBack, and the caller writes it out.
 	 *
 	 * @param frame   	Frame reference, frame ID of allocated frame returned via this variable
+	 * @param evictedFile	File of the dirty page to write back is returned via this variable, NULL if there is none
+	 * @param evictedPageNo	Page number of the dirty page to write back is returned via this variable
 	 * @throws BufferExceededException If no such buffer is found which can be allocated
 	 */
-  void allocBuf(FrameId & frame);
+  void allocBuf(FrameId & frame, File*& evictedFile, PageId& evictedPageNo);
+
+	/**
+	 * Complete the I/O begun on a frame returned by allocBuf, with the mutex held again: drop the
+	 * evicted page from writingBack, release the frame latch and wake waiting requests.
+	 *
+	 * @param frame   	Frame the I/O was done for
+	 * @param evictedFile	File of the page written back, NULL if there was none
+	 * @param evictedPageNo	Page number of the page written back
+	 * @param succeeded	False if the I/O threw, in which case the frame is emptied again
+	 */
+  void finishIo(const FrameId frame, const File* evictedFile, const PageId evictedPageNo, const bool succeeded);
+
+	/**
+	 * True if the page is in writingBack. Callers hold the mutex.
+	 */
+  bool isWritingBack(const File* file, const PageId pageNo) const;
 
 	/**
    * Advance clock to next frame in the buffer pool
@@ -271,6 +340,69 @@ class BufMgr
   void disposePage(File* file, const PageId PageNo);
 
 	/**
+	 * Latch of the frame holding a pinned page. It stays with the page for as long as the page is
+	 * pinned, since a pinned frame is never reused; callers must release it before unpinning.
+	 *
+	 * @param page  	Page pointer returned by readPage or allocPage
+	 */
+  RWLatch& pageLatch(const Page* page)
+  {
+		return frameLatches[page - bufPool];
+  }
+
+	/**
+	 * Frame holding a page returned by readPage or allocPage, for peekFrame().
+	 *
+	 * @param page  	Page pointer returned by readPage or allocPage
+	 */
+  FrameId frameNumber(const Page* page) const
+  {
+		return page - bufPool;
+  }
+
+	/**
+	 * Pin a page in the frame it was last seen in, without probing the hash table. Callers
+	 * fall back to readPage if the frame holds another page by now.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file
+	 * @param frameNo	Frame the page was last seen in, see frameNumber()
+	 * @param page  	Reference to page pointer. The pinned page is returned via this reference.
+	 * @return True if the frame held the page and it was pinned
+	 */
+  bool pinFrame(const File* file, const PageId pageNo, const FrameId frameNo, Page*& page);
+
+	/**
+	 * Unpin a page like unPinPage, finding its frame from the page pointer rather than the hash table.
+	 *
+	 * @param page  	Page pointer returned by readPage, allocPage or pinFrame
+	 * @param dirty		True if the page to be unpinned needs to be marked dirty
+   * @throws  PageNotPinnedException If the page is not already pinned
+	 */
+  void unPinFrame(const Page* page, const bool dirty);
+
+	/**
+	 * Optimistic access to a page that was held by the given frame, without pinning it or taking
+	 * the mutex. The frame may take another page at any time: readers must validate everything
+	 * they read from the page against version with pageLatch(page).validate() before using it.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file
+	 * @param frameNo	Frame the page was last seen in, see frameNumber()
+	 * @param version	Latch version of the frame to validate reads against is returned via this variable
+	 * @return The page, or NULL if the frame does not hold it any more
+	 */
+  Page* peekFrame(const File* file, const PageId pageNo, const FrameId frameNo, unsigned long& version);
+
+	/**
+   * Number of frames in the buffer pool
+	 */
+  std::uint32_t getNumBufs() const
+  {
+		return numBufs;
+  }
+
+	/**
    * Print member variable values. 
 	 */
   void  printSelf();
@@ -5,6 +5,7 @@
  * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
  */
 
+#include <algorithm>
 #include "filescan.h"
 #include "exceptions/end_of_file_exception.h"
 
@@ -117,4 +118,80 @@ void FileScan::markDirty()
   curDirtyFlag = true;
 }
 
+// orders record ids by page, then by slot within the page
+static bool ridPageOrder(const RecordId& a, const RecordId& b)
+{
+  return a.page_number < b.page_number
+      || (a.page_number == b.page_number && a.slot_number < b.slot_number);
+}
+
+RidScan::RidScan(const std::string &name, BufMgr *bufferMgr)
+{
+  file = new PageFile(name, false);	//dont create new file
+	bufMgr = bufferMgr;
+  curPage = NULL;
+  curPageNo = Page::INVALID_NUMBER;
+  nextRid = 0;
+}
+
+RidScan::~RidScan()
+{
+  // unpin the page of the last record returned
+  if (curPage != NULL)
+  {
+    bufMgr->unPinPage(file, curPageNo, false);
+    curPage = NULL;
+  }
+  bufMgr->flushFile(file);
+  delete file;
+}
+
+void RidScan::addRids(const std::vector<RecordId>& newRids)
+{
+  // drop the record ids already returned, so the queue only holds those still to read
+  rids.erase(rids.begin(), rids.begin() + nextRid);
+  nextRid = 0;
+
+  // sort the new batch alone, behind the one being read
+  size_t oldSize = rids.size();
+  rids.insert(rids.end(), newRids.begin(), newRids.end());
+  std::sort(rids.begin() + oldSize, rids.end(), ridPageOrder);
+}
+
+void RidScan::scanNext(RecordId& outRid)
+{
+  if (nextRid == rids.size())
+  {
+    if (curPage != NULL)
+    {
+      bufMgr->unPinPage(file, curPageNo, false);
+      curPage = NULL;
+    }
+    throw EndOfFileException();
+  }
+
+  // keep the current page pinned while its records last
+  const RecordId& rid = rids[nextRid];
+  if (curPage == NULL || curPageNo != rid.page_number)
+  {
+    if (curPage != NULL)
+    {
+      bufMgr->unPinPage(file, curPageNo, false);
+      curPage = NULL;
+    }
+    bufMgr->readPage(file, rid.page_number, curPage);
+    curPageNo = rid.page_number;
+  }
+
+  curRid = rid;
+  outRid = rid;
+  nextRid++;
+}
+
+// returns the record last returned by scanNext, read off its pinned page
+std::string RidScan::getRecord()
+{
+  return curPage->getRecord(curRid);
+}
+
 }
@@ -9,6 +9,7 @@
 #pragma once
 
 #include <string>
+#include <vector>
 #include "types.h"
 #include "page.h"
 #include "buffer.h"
@@ -62,4 +63,68 @@ class FileScan
   bool  	      curDirtyFlag;
 };
 
+/**
+ * @brief This class is used to read the records of a set of record ids, such as those
+ * returned by an index range scan, in the order of the pages holding them.
+ *
+ * Record ids in key order bounce across the relation, so reading them one by one pins
+ * a page per record and, once the range outgrows the buffer pool, reads most pages
+ * from disk several times. Each batch of queued record ids is sorted by page instead, and
+ * each page is pinned once while the batch returns all of its records.
+ */
+class RidScan
+{
+ public:
+
+  RidScan(const std::string &name, BufMgr *bufMgr);
+
+  ~RidScan();
+
+  //queue record ids to be read, in any order; ones added after scanning
+  //has begun are read after those already queued
+  void addRids(const std::vector<RecordId>& rids);
+
+  //return the next queued RecordId, in page order within each batch
+  void scanNext(RecordId& outRid);
+
+  //read the record of the RecordId last returned by scanNext
+  std::string getRecord();
+
+ private:
+  /**
+   * File whose records are being read.
+   */
+  PageFile      *file;
+
+  /**
+   * Buffer Manager instance used to read/write pages into/from buffer pool.
+   */
+	BufMgr				*bufMgr;
+
+  /**
+   * Page holding the record last returned, pinned until the scan moves off it.
+   */
+  Page*         curPage;
+
+  /**
+   * Number of the page pinned in curPage.
+   */
+  PageId        curPageNo;
+
+  /**
+   * Record id last returned by scanNext, whose record getRecord reads.
+   */
+  RecordId      curRid;
+
+  /**
+   * Queued record ids, each batch sorted by page, those before nextRid having been returned.
+   */
+  std::vector<RecordId> rids;
+
+  /**
+   * Position in rids of the next record id to return.
+   */
+  size_t        nextRid;
+};
+
 }
@@ -0,0 +1,395 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+#include <thread>
+#include "index_builder.h"
+#include "filescan.h"
+#include "exceptions/end_of_file_exception.h"
+
+namespace badgerdb
+{
+
+	// -----------------------------------------------------------------------------
+	// Milliseconds since start
+	// -----------------------------------------------------------------------------
+
+	static double elapsedMs(const std::chrono::steady_clock::time_point& start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	// -----------------------------------------------------------------------------
+	// IndexBuilder::IndexBuilder -- Constructor
+	// -----------------------------------------------------------------------------
+
+	template <class KeyT>
+	IndexBuilder<KeyT>::IndexBuilder(const std::string& _relationName, BufMgr* _bufMgr, const int _attrByteOffset,
+			const std::string& _runFilePrefix, const IndexBuildOptions& options)
+	{
+		relationName = _relationName;
+		bufMgr = _bufMgr;
+		attrByteOffset = _attrByteOffset;
+		runFilePrefix = _runFilePrefix;
+		runFileCount = 0;
+		numThreads = std::max(1, options.numThreads);
+
+		//the buffer being filled plus one per worker share the budget, but a run
+		//is never shorter than a page
+		bufferEntries = std::max((size_t) RUN_PAGE_ENTRIES, options.memoryBudget / (numThreads + 1) / sizeof(Entry));
+
+		//a merge holds one page per input run and one for its output
+		int budgetPages = std::max(3, (int) (options.memoryBudget / Page::SIZE));
+		mergeFanIn = std::max(2, std::min(options.mergeFanIn, budgetPages - 1));
+		mergeThreads = std::max(1, std::min(numThreads, budgetPages / (mergeFanIn + 1)));
+	}
+
+	// -----------------------------------------------------------------------------
+	// IndexBuilder::build
+	// -----------------------------------------------------------------------------
+
+	template <class KeyT>
+	void IndexBuilder<KeyT>::build(typename BTreeIndex<KeyT>::BulkLoader& loader, IndexBuildStats& stats)
+	{
+		std::vector<Entry> entries;
+		std::vector<Run> runs;
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		bool spilled = generateRuns(entries, runs, stats);
+		stats.runMs = elapsedMs(start);
+
+		// Case: everything fitted in one buffer, load it straight from memory
+		if (!spilled) {
+			start = std::chrono::steady_clock::now();
+			for (size_t i = 0; i < entries.size(); i++) {
+				loader.append(entries[i].key, entries[i].rid);
+			}
+			stats.loadMs = elapsedMs(start);
+			return;
+		}
+		std::vector<Entry>().swap(entries);
+
+		// Case: too many runs to merge at once, reduce them in passes
+		start = std::chrono::steady_clock::now();
+		while ((int) runs.size() > mergeFanIn) {
+			mergePass(runs);
+			stats.mergePasses++;
+		}
+		stats.mergeMs = elapsedMs(start);
+
+		//the final merge streams into the leaf level
+		start = std::chrono::steady_clock::now();
+		std::vector<BlobFile*> files;
+		std::vector<RunReader*> readers;
+		for (size_t i = 0; i < runs.size(); i++) {
+			files.push_back(new BlobFile(runs[i].fileName, false));
+			readers.push_back(new RunReader(files[i], runs[i].numPages));
+		}
+		merge(readers, loader);
+		for (size_t i = 0; i < runs.size(); i++) {
+			delete readers[i];
+			delete files[i];
+			File::remove(runs[i].fileName);
+		}
+		stats.loadMs = elapsedMs(start);
+	}
+
+	// -----------------------------------------------------------------------------
+	// IndexBuilder::generateRuns
+	// -----------------------------------------------------------------------------
+
+	template <class KeyT>
+	bool IndexBuilder<KeyT>::generateRuns(std::vector<Entry>& entries, std::vector<Run>& runs, IndexBuildStats& stats)
+	{
+		//a run being sorted and written by a worker
+		struct Spill {
+			std::thread thread;
+			std::vector<Entry> entries;
+			BlobFile* file;
+			Run run;
+			double sortMs;
+		};
+		std::vector<Spill*> spills;
+		size_t nextJoin = 0;
+
+		entries.reserve(bufferEntries);
+		std::chrono::steady_clock::duration scanTime(0);
+		{
+			FileScan fileScanner(relationName, bufMgr);
+			RecordId scanRid;
+			Entry entry;
+			bool done = false;
+			while (!done) {
+				std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+				try {
+					while (entries.size() < bufferEntries) {
+						fileScanner.scanNext(scanRid);
+						std::string recordStr = fileScanner.getRecord();
+						entry.set(scanRid, KeyTraits<KeyT>::read(recordStr.c_str() + attrByteOffset));
+						entries.push_back(entry);
+					}
+				} catch (EndOfFileException e) {
+					done = true;
+				}
+				scanTime += std::chrono::steady_clock::now() - start;
+
+				// Case: the relation fitted in the first buffer, nothing to spill
+				if (done && spills.empty()) {
+					stats.numEntries = entries.size();
+					stats.scanMs = std::chrono::duration<double, std::milli>(scanTime).count();
+					start = std::chrono::steady_clock::now();
+					std::sort(entries.begin(), entries.end());
+					stats.sortMs = elapsedMs(start);
+					return false;
+				}
+				if (entries.empty()) {
+					break;
+				}
+
+				//waits for a worker to free up its buffer before handing out another
+				if (spills.size() - nextJoin == (size_t) numThreads) {
+					spills[nextJoin]->thread.join();
+					std::vector<Entry>().swap(spills[nextJoin]->entries);
+					nextJoin++;
+				}
+
+				Spill* spill = new Spill();
+				spill->entries.swap(entries);
+				spill->run.fileName = newRunFileName();
+				spill->file = new BlobFile(spill->run.fileName, true);
+				spill->thread = std::thread(&IndexBuilder<KeyT>::sortRun, &spill->entries, spill->file,
+						&spill->run.numPages, &spill->sortMs);
+				stats.numEntries += spill->entries.size();
+				spills.push_back(spill);
+
+				if (!done) {
+					entries.reserve(bufferEntries);
+				}
+			}
+		}
+
+		for (size_t i = 0; i < spills.size(); i++) {
+			if (i >= nextJoin) {
+				spills[i]->thread.join();
+			}
+			delete spills[i]->file;
+			runs.push_back(spills[i]->run);
+			stats.sortMs += spills[i]->sortMs;
+			delete spills[i];
+		}
+		stats.numRuns = runs.size();
+		stats.scanMs = std::chrono::duration<double, std::milli>(scanTime).count();
+		return true;
+	}
+
+	// -----------------------------------------------------------------------------
+	// IndexBuilder::mergePass
+	// -----------------------------------------------------------------------------
+
+	template <class KeyT>
+	void IndexBuilder<KeyT>::mergePass(std::vector<Run>& runs)
+	{
+		//a group of runs being merged into one by a worker
+		struct Merge {
+			std::thread thread;
+			std::vector<BlobFile*> files;
+			std::vector<RunReader*> readers;
+			BlobFile* out;
+			Run run;
+		};
+
+		std::vector<Run> merged;
+		size_t next = 0;
+		while (next < runs.size()) {
+			//starts as many merges as fit in the budget, each over up to mergeFanIn runs
+			std::vector<Merge*> merges;
+			for (int t = 0; t < mergeThreads && next < runs.size(); t++) {
+				Merge* m = new Merge();
+				size_t end = std::min(runs.size(), next + mergeFanIn);
+				for (; next < end; next++) {
+					m->files.push_back(new BlobFile(runs[next].fileName, false));
+					m->readers.push_back(new RunReader(m->files.back(), runs[next].numPages));
+				}
+				m->run.fileName = newRunFileName();
+				m->out = new BlobFile(m->run.fileName, true);
+				m->thread = std::thread(&IndexBuilder<KeyT>::mergeRuns, &m->readers, m->out, &m->run.numPages);
+				merges.push_back(m);
+			}
+
+			for (size_t i = 0; i < merges.size(); i++) {
+				Merge* m = merges[i];
+				m->thread.join();
+				for (size_t r = 0; r < m->readers.size(); r++) {
+					std::string fileName = m->files[r]->filename();
+					delete m->readers[r];
+					delete m->files[r];
+					File::remove(fileName);
+				}
+				delete m->out;
+				merged.push_back(m->run);
+				delete m;
+			}
+		}
+		runs.swap(merged);
+	}
+
+	// -----------------------------------------------------------------------------
+	// IndexBuilder::sortRun
+	// -----------------------------------------------------------------------------
+
+	template <class KeyT>
+	void IndexBuilder<KeyT>::sortRun(std::vector<Entry>* entries, File* file, PageId* numPages, double* sortMs)
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		std::sort(entries->begin(), entries->end());
+		*sortMs = elapsedMs(start);
+
+		RunWriter writer(file);
+		for (size_t i = 0; i < entries->size(); i++) {
+			writer.append((*entries)[i].key, (*entries)[i].rid);
+		}
+		writer.finish();
+		*numPages = writer.numPages;
+	}
+
+	// -----------------------------------------------------------------------------
+	// IndexBuilder::mergeRuns
+	// -----------------------------------------------------------------------------
+
+	template <class KeyT>
+	void IndexBuilder<KeyT>::mergeRuns(std::vector<RunReader*>* readers, File* out, PageId* numPages)
+	{
+		RunWriter writer(out);
+		merge(*readers, writer);
+		writer.finish();
+		*numPages = writer.numPages;
+	}
+
+	// -----------------------------------------------------------------------------
+	// IndexBuilder::merge
+	// -----------------------------------------------------------------------------
+
+	template <class KeyT>
+	template <class Sink>
+	void IndexBuilder<KeyT>::merge(std::vector<RunReader*>& readers, Sink& sink)
+	{
+		//min-heap of the readers that still have entries, keyed by their current entry
+		std::vector<RunReader*> heap;
+		for (size_t i = 0; i < readers.size(); i++) {
+			if (readers[i]->advance()) {
+				heap.push_back(readers[i]);
+			}
+		}
+		std::make_heap(heap.begin(), heap.end(), ReaderGreater());
+
+		while (!heap.empty()) {
+			std::pop_heap(heap.begin(), heap.end(), ReaderGreater());
+			RunReader* reader = heap.back();
+			sink.append(reader->current().key, reader->current().rid);
+			if (reader->advance()) {
+				std::push_heap(heap.begin(), heap.end(), ReaderGreater());
+			} else {
+				heap.pop_back();
+			}
+		}
+	}
+
+	template <class KeyT>
+	bool IndexBuilder<KeyT>::ReaderGreater::operator()(const RunReader* r1, const RunReader* r2) const
+	{
+		return r2->current() < r1->current();
+	}
+
+	// -----------------------------------------------------------------------------
+	// IndexBuilder::newRunFileName
+	// -----------------------------------------------------------------------------
+
+	template <class KeyT>
+	std::string IndexBuilder<KeyT>::newRunFileName()
+	{
+		std::ostringstream runStr;
+		runStr << runFilePrefix << ".run" << runFileCount++;
+		return runStr.str();
+	}
+
+	// -----------------------------------------------------------------------------
+	// IndexBuilder::RunWriter
+	// -----------------------------------------------------------------------------
+
+	template <class KeyT>
+	IndexBuilder<KeyT>::RunWriter::RunWriter(File* _file)
+	{
+		file = _file;
+		numPages = 0;
+		((RunPage*) &page)->numEntries = 0;
+	}
+
+	template <class KeyT>
+	void IndexBuilder<KeyT>::RunWriter::append(const KeyT& key, const RecordId& rid)
+	{
+		RunPage* runPage = (RunPage*) &page;
+		if (runPage->numEntries == RUN_PAGE_ENTRIES) {
+			finish();
+		}
+		runPage->entries[runPage->numEntries].set(rid, key);
+		runPage->numEntries++;
+	}
+
+	template <class KeyT>
+	void IndexBuilder<KeyT>::RunWriter::finish()
+	{
+		//run files are only read back by page number, so pages are written in
+		//sequence after the header rather than allocated one by one
+		RunPage* runPage = (RunPage*) &page;
+		if (runPage->numEntries > 0) {
+			numPages++;
+			file->writePage(numPages, page);
+			runPage->numEntries = 0;
+		}
+	}
+
+	// -----------------------------------------------------------------------------
+	// IndexBuilder::RunReader
+	// -----------------------------------------------------------------------------
+
+	template <class KeyT>
+	IndexBuilder<KeyT>::RunReader::RunReader(File* _file, const PageId _numPages)
+	{
+		file = _file;
+		numPages = _numPages;
+		pageNo = 0;
+		pos = 0;
+		((RunPage*) &page)->numEntries = 0;
+	}
+
+	template <class KeyT>
+	bool IndexBuilder<KeyT>::RunReader::advance()
+	{
+		pos++;
+		while (pos >= ((RunPage*) &page)->numEntries) {
+			if (pageNo == numPages) {
+				return false;
+			}
+			pageNo++;
+			page = file->readPage(pageNo);
+			pos = 0;
+		}
+		return true;
+	}
+
+	template <class KeyT>
+	const typename IndexBuilder<KeyT>::Entry& IndexBuilder<KeyT>::RunReader::current() const
+	{
+		return ((const RunPage*) &page)->entries[pos];
+	}
+
+	template class IndexBuilder<int>;
+	template class IndexBuilder<double>;
+	template class IndexBuilder<StringKey>;
+}
@@ -0,0 +1,169 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "btree.h"
+
+namespace badgerdb
+{
+
+/**
+ * @brief Feeds every (key, rid) pair of a relation to a BulkLoader in key order, for
+ * relations larger than the buffer pool or than memory.
+ *
+ * The relation is read with FileScan into a buffer sized from the memory budget. When
+ * the buffer fills, a worker thread sorts it and writes it as a run to a temporary
+ * BlobFile while the scan goes on into the next buffer. Runs are then merged, up to
+ * mergeFanIn at a time and by several workers in parallel, until a single merge can
+ * stream them straight into the leaf level. If the whole relation fits in one buffer
+ * it is sorted in memory and no run is written.
+ *
+ * Only the calling thread touches the buffer manager and opens, closes or removes
+ * files. Worker threads only sort and read or write the run files handed to them.
+ */
+template <class KeyT>
+class IndexBuilder {
+ public:
+  /**
+   * @param relationName	Relation to index
+   * @param bufMgr				Buffer manager the relation is scanned through
+   * @param attrByteOffset	Offset of the key inside each record
+   * @param runFilePrefix	Prefix of the names of the temporary run files
+   * @param options				Memory budget, threads and merge fan-in
+   */
+	IndexBuilder(const std::string& relationName, BufMgr* bufMgr, const int attrByteOffset,
+			const std::string& runFilePrefix, const IndexBuildOptions& options);
+
+  /**
+   * Append every entry of the relation to loader in key order, filling in stats.
+   * Removes the run files it created before returning.
+   */
+	void build(typename BTreeIndex<KeyT>::BulkLoader& loader, IndexBuildStats& stats);
+
+ private:
+	typedef RIDKeyPair<KeyT> Entry;
+
+  /**
+   * Number of entries stored on one run page.
+   */
+	static const int RUN_PAGE_ENTRIES = (Page::SIZE - (alignof(Entry) > sizeof(int) ? alignof(Entry) : sizeof(int))) / sizeof(Entry);
+
+  /**
+   * Layout of the pages of a run file.
+   */
+	struct RunPage {
+		int numEntries;
+		Entry entries[RUN_PAGE_ENTRIES];
+	};
+
+  /**
+   * A sorted run on disk. Its entries are on pages 1 .. numPages of the file.
+   */
+	struct Run {
+		std::string fileName;
+		PageId numPages;
+	};
+
+  /**
+   * Appends entries to a run file one page at a time.
+   */
+	class RunWriter {
+	 public:
+		RunWriter(File* file);
+		void append(const KeyT& key, const RecordId& rid);
+		void finish();
+		PageId numPages;
+	 private:
+		File* file;
+		Page page;
+	};
+
+  /**
+   * Reads back the entries of a run file one page at a time.
+   */
+	class RunReader {
+	 public:
+		RunReader(File* file, const PageId numPages);
+		/** Move to the next entry. Returns false once the run is exhausted. */
+		bool advance();
+		const Entry& current() const;
+	 private:
+		File* file;
+		PageId pageNo;
+		PageId numPages;
+		int pos;
+		Page page;
+	};
+
+  /**
+   * Orders merge inputs so that the reader with the smallest current entry is on top of the heap.
+   */
+	struct ReaderGreater {
+		bool operator()(const RunReader* r1, const RunReader* r2) const;
+	};
+
+  /**
+   * Worker body: sort entries and write them to file. Sort time goes to sortMs.
+   */
+	static void sortRun(std::vector<Entry>* entries, File* file, PageId* numPages, double* sortMs);
+
+  /**
+   * Worker body: merge the given runs into out, whose page count goes to numPages.
+   */
+	static void mergeRuns(std::vector<RunReader*>* readers, File* out, PageId* numPages);
+
+  /**
+   * Merge readers in key order into sink, which is a RunWriter or a BulkLoader.
+   */
+	template <class Sink>
+	static void merge(std::vector<RunReader*>& readers, Sink& sink);
+
+  /**
+   * Scan the relation into sorted runs. Returns false if the relation fitted in one
+   * buffer, which is then left sorted in entries and no run is written.
+   */
+	bool generateRuns(std::vector<Entry>& entries, std::vector<Run>& runs, IndexBuildStats& stats);
+
+  /**
+   * Merge groups of mergeFanIn runs in parallel until at most mergeFanIn are left.
+   */
+	void mergePass(std::vector<Run>& runs);
+
+  /**
+   * Name of a new temporary run file.
+   */
+	std::string newRunFileName();
+
+	std::string relationName;
+	BufMgr* bufMgr;
+	int attrByteOffset;
+	std::string runFilePrefix;
+	int runFileCount;
+
+  /**
+   * Number of entries held by each run buffer while scanning.
+   */
+	size_t bufferEntries;
+
+	int numThreads;
+
+  /**
+   * Number of runs merged at once, after fitting a page per input in the memory budget.
+   */
+	int mergeFanIn;
+
+  /**
+   * Number of merges of mergeFanIn runs that fit in the memory budget at the same time.
+   */
+	int mergeThreads;
+};
+
+}
@@ -0,0 +1,105 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <pthread.h>
+#include <sched.h>
+#include <atomic>
+
+namespace badgerdb {
+
+/**
+* @brief Reader/writer latch protecting an in-memory structure, such as the page held by a
+* buffer frame, for the duration of a single operation. Any number of threads may hold it
+* shared, or one thread exclusive. Waiting writers are preferred over new readers, so that
+* a steady stream of lookups cannot starve inserts. Latches are not reentrant.
+*
+* The latch also keeps a version counter, which is odd while the latch is held exclusive and
+* moves on every time it is. An optimistic reader takes no latch at all: it reads the version
+* with readVersion(), reads the structure, and trusts what it read only if validate() then
+* finds the version unchanged. Such a reader writes no shared memory, but may see the structure
+* halfway through a change, so it must not act on what it read before validating.
+*/
+class RWLatch {
+ public:
+	RWLatch()
+		: version(0)
+	{
+		pthread_rwlockattr_t attr;
+		pthread_rwlockattr_init(&attr);
+		pthread_rwlockattr_setkind_np(&attr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+		pthread_rwlock_init(&rwlock, &attr);
+		pthread_rwlockattr_destroy(&attr);
+	}
+
+	~RWLatch()
+	{
+		pthread_rwlock_destroy(&rwlock);
+	}
+
+	/**
+	 * Acquire the latch, exclusive if exclusive is true and shared otherwise.
+	 */
+	void lock(const bool exclusive)
+	{
+		if (exclusive) {
+			pthread_rwlock_wrlock(&rwlock);
+			version.store(version.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+			// the odd version must be visible before any write done under the latch
+			std::atomic_thread_fence(std::memory_order_release);
+		} else {
+			pthread_rwlock_rdlock(&rwlock);
+		}
+	}
+
+	/**
+	 * Release the latch, held in either mode.
+	 */
+	void unlock()
+	{
+		// only the exclusive holder can see an odd version here
+		unsigned long current = version.load(std::memory_order_relaxed);
+		if (current % 2 == 1) {
+			version.store(current + 1, std::memory_order_release);
+		}
+		pthread_rwlock_unlock(&rwlock);
+	}
+
+	/**
+	 * Version to validate an optimistic read against, waiting while the latch is held exclusive.
+	 */
+	unsigned long readVersion() const
+	{
+		unsigned long current = version.load(std::memory_order_acquire);
+		while (current % 2 == 1) {
+			sched_yield();
+			current = version.load(std::memory_order_acquire);
+		}
+		return current;
+	}
+
+	/**
+	 * True if nobody latched exclusive since readVersion() returned readVersion, so that what
+	 * was read in between is consistent.
+	 */
+	bool validate(const unsigned long readVersion) const
+	{
+		// the reads being validated must not move past the version check
+		std::atomic_thread_fence(std::memory_order_acquire);
+		return version.load(std::memory_order_relaxed) == readVersion;
+	}
+
+ private:
+	pthread_rwlock_t rwlock;
+	std::atomic<unsigned long> version;
+
+	RWLatch(const RWLatch&);
+	RWLatch& operator=(const RWLatch&);
+};
+
+}
@@ -19,6 +19,7 @@
 #include "exceptions/bad_opcodes_exception.h"
 #include "exceptions/scan_not_initialized_exception.h"
 #include "exceptions/end_of_file_exception.h"
+#include "exceptions/bad_index_info_exception.h"
 
 #define checkPassFail(a, b) 																				\
 {																																		\
@@ -68,7 +69,21 @@ void createRelationForward();
 void createRelationBackward();
 void createRelationRandom();
 void intTests();
-int intScan(BTreeIndex *index, int lowVal, Operator lowOp, int highVal, Operator highOp);
+int intScan(BTreeIndex<int> *index, int lowVal, Operator lowOp, int highVal, Operator highOp);
+int intScanBackward(BTreeIndex<int> *index, int lowVal, Operator lowOp, int highVal, Operator highOp);
+void doubleTests();
+int doubleScan(BTreeIndex<double> *index, double lowVal, Operator lowOp, double highVal, Operator highOp);
+void stringTests();
+int stringScan(BTreeIndex<StringKey> *index, int lowVal, Operator lowOp, int highVal, Operator highOp);
+void deleteTests();
+void cursorTests();
+void compressedTests();
+void reopenTests();
+void coveringTests();
+int coveredScan(BTreeIndex<int> *index, int lowVal, Operator lowOp, int highVal, Operator highOp, ScanDirection direction);
+void ridScanTests();
+int ridScan(BTreeIndex<int> *index, int lowVal, Operator lowOp, int highVal, Operator highOp, int numBatches);
+int ridScanBehind(BTreeIndex<int> *index, int split);
 void indexTests();
 void test1();
 void test2();
@@ -80,6 +95,8 @@ int main(int argc, char **argv)
 {
 	
   std::cout << "leaf size:" << INTARRAYLEAFSIZE << " non-leaf size:" << INTARRAYNONLEAFSIZE << std::endl;
+  std::cout << "double leaf size:" << DOUBLEARRAYLEAFSIZE << " non-leaf size:" << DOUBLEARRAYNONLEAFSIZE << std::endl;
+  std::cout << "string leaf size:" << STRINGARRAYLEAFSIZE << " non-leaf size:" << STRINGARRAYNONLEAFSIZE << std::endl;
 
   // Clean up from any previous runs that crashed.
   try
@@ -349,17 +366,86 @@ void createRelationRandom()
 
 void indexTests()
 {
-  if(testNum == 1)
-  {
-    intTests();
-		try
-		{
-			File::remove(intIndexName);
-		}
-  	catch(FileNotFoundException e)
-  	{
-  	}
-  }
+  intTests();
+	try
+	{
+		File::remove(intIndexName);
+	}
+	catch(FileNotFoundException e)
+	{
+	}
+
+  doubleTests();
+	try
+	{
+		File::remove(doubleIndexName);
+	}
+	catch(FileNotFoundException e)
+	{
+	}
+
+  stringTests();
+	try
+	{
+		File::remove(stringIndexName);
+	}
+	catch(FileNotFoundException e)
+	{
+	}
+
+  deleteTests();
+	try
+	{
+		File::remove(intIndexName);
+	}
+	catch(FileNotFoundException e)
+	{
+	}
+
+  cursorTests();
+	try
+	{
+		File::remove(intIndexName);
+	}
+	catch(FileNotFoundException e)
+	{
+	}
+
+  compressedTests();
+	try
+	{
+		File::remove(intIndexName);
+	}
+	catch(FileNotFoundException e)
+	{
+	}
+
+  reopenTests();
+	try
+	{
+		File::remove(intIndexName);
+	}
+	catch(FileNotFoundException e)
+	{
+	}
+
+  coveringTests();
+	try
+	{
+		File::remove(intIndexName);
+	}
+	catch(FileNotFoundException e)
+	{
+	}
+
+  ridScanTests();
+	try
+	{
+		File::remove(intIndexName);
+	}
+	catch(FileNotFoundException e)
+	{
+	}
 }
 
 // -----------------------------------------------------------------------------
@@ -369,7 +455,7 @@ void indexTests()
 void intTests()
 {
   std::cout << "Create a B+ Tree index on the integer field !!!!!!!!" << std::endl;
-  BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+  BTreeIndex<int> index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
 	std::cout << "Index Created" << std::endl;
 
 	// run some tests
@@ -380,9 +466,68 @@ void intTests()
 	checkPassFail(intScan(&index,0,GT,1,LT), 0)
 	checkPassFail(intScan(&index,300,GT,400,LT), 99)
 	checkPassFail(intScan(&index,3000,GTE,4000,LT), 1000)
+
+	// point lookups
+	RecordId lookupRid;
+	std::vector<RecordId> lookupRids;
+	int lookupKey = 25;
+	checkPassFail(index.lookup(&lookupKey, lookupRid), true)
+	checkPassFail(index.lookupAll(&lookupKey, lookupRids), 1)
+	lookupKey = 5000;
+	checkPassFail(index.lookup(&lookupKey, lookupRid), false)
+
+	// a batch of lookups, unsorted, with a repeated and a missing key
+	std::vector<int> batchKeys;
+	batchKeys.push_back(25);
+	batchKeys.push_back(5000);
+	batchKeys.push_back(3);
+	batchKeys.push_back(25);
+	batchKeys.push_back(4999);
+	std::vector<int> batchCounts;
+	checkPassFail(index.multiGet(batchKeys, lookupRids, batchCounts), 4)
+	checkPassFail(batchCounts[1], 0)
+	checkPassFail((lookupRids[2] == lookupRid), true)
+
+	// with the root pinned a lookup only asks the buffer manager for its leaf
+	int height = index.getHeight();
+	lookupKey = 2500;
+	bufMgr->clearBufStats();
+	index.lookup(&lookupKey, lookupRid);
+	checkPassFail(bufMgr->getBufStats().accesses, height - 1)
+	index.setPinnedLevels(0, 0);
+	bufMgr->clearBufStats();
+	index.lookup(&lookupKey, lookupRid);
+	checkPassFail(bufMgr->getBufStats().accesses, height)
+	// but pins the nodes above the leaf in the frames they were last read into, so only
+	// pinning and unpinning the leaf probe its hash table
+	checkPassFail(bufMgr->getBufStats().hashlookups, 2)
+
+	// a batch of every key pins each node once, like a scan of every key, even though the
+	// first key of each leaf is also the separator that sends it down the leaf to the left
+	bufMgr->clearBufStats();
+	checkPassFail(intScan(&index,0,GTE,relationSize,LT), relationSize)
+	int scanAccesses = bufMgr->getBufStats().accesses - relationSize;
+	std::vector<int> allKeys;
+	for(int i = 0; i < relationSize; i++)
+	{
+		allKeys.push_back(i);
+	}
+	bufMgr->clearBufStats();
+	checkPassFail(index.multiGet(allKeys, lookupRids, batchCounts), relationSize)
+	checkPassFail(bufMgr->getBufStats().accesses, scanAccesses)
+
+	// optimistic descents find the nodes above the leaf in the frames they were last read into
+	index.setReadMode(OPTIMISTIC_LOCK_COUPLING);
+	index.lookup(&lookupKey, lookupRid);
+	bufMgr->clearBufStats();
+	index.lookup(&lookupKey, lookupRid);
+	checkPassFail(bufMgr->getBufStats().accesses, 1)
+	index.setReadMode(LATCH_CRABBING);
+	index.setPinnedLevels(DEFAULT_PINNED_LEVELS, DEFAULT_PIN_MEMORY);
+	checkPassFail(intScan(&index,3000,GTE,4000,LT), 1000)
 }
 
-int intScan(BTreeIndex * index, int lowVal, Operator lowOp, int highVal, Operator highOp)
+int intScan(BTreeIndex<int> * index, int lowVal, Operator lowOp, int highVal, Operator highOp)
 {
   RecordId scanRid;
 	Page *curPage;
@@ -444,6 +589,976 @@ int intScan(BTreeIndex * index, int lowVal, Operator lowOp, int highVal, Operato
 	return numResults;
 }
 
+// Scan backward and return the number of entries found, or -1 if their keys are not in descending order
+int intScanBackward(BTreeIndex<int> * index, int lowVal, Operator lowOp, int highVal, Operator highOp)
+{
+  RecordId scanRid;
+	Page *curPage;
+
+  std::cout << "Backward scan for: ";
+  if( lowOp == GT ) { std::cout << "("; } else { std::cout << "["; }
+  std::cout << lowVal << "," << highVal;
+  if( highOp == LT ) { std::cout << ")"; } else { std::cout << "]"; }
+  std::cout << std::endl;
+
+  int numResults = 0;
+	bool ordered = true;
+	int previousKey = 0;
+	try
+	{
+  		index->startScan(&lowVal, lowOp, &highVal, highOp, BACKWARD);
+	}
+	catch(NoSuchKeyFoundException e)
+	{
+    std::cout << "No Key Found satisfying the scan criteria." << std::endl;
+		return 0;
+	}
+
+	while(1)
+	{
+		try
+		{
+			index->scanNext(scanRid);
+			bufMgr->readPage(file1, scanRid.page_number, curPage);
+			RECORD myRec = *(reinterpret_cast<const RECORD*>(curPage->getRecord(scanRid).data()));
+			bufMgr->unPinPage(file1, scanRid.page_number, false);
+
+			if( numResults > 0 && myRec.i >= previousKey )
+			{
+				ordered = false;
+			}
+			previousKey = myRec.i;
+		}
+		catch(IndexScanCompletedException e)
+		{
+			break;
+		}
+
+		numResults++;
+	}
+
+  std::cout << "Number of results: " << numResults << std::endl;
+  index->endScan();
+  std::cout << std::endl;
+
+	return ordered ? numResults : -1;
+}
+
+// -----------------------------------------------------------------------------
+// deleteTests
+// -----------------------------------------------------------------------------
+
+void deleteTests()
+{
+  std::cout << "Delete entries from a B+ Tree index on the integer field !!!!!!!!" << std::endl;
+  BTreeIndex<int> index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+	std::cout << "Index Created" << std::endl;
+
+	// delete every entry except the keys 1000 .. 1099, in relation order
+	{
+		FileScan fscan(relationName, bufMgr);
+		try
+		{
+			RecordId scanRid;
+			while(1)
+			{
+				fscan.scanNext(scanRid);
+				std::string recordStr = fscan.getRecord();
+				int key = *((int *)(recordStr.c_str() + offsetof (RECORD, i)));
+				if( key < 1000 || key >= 1100 )
+				{
+					index.deleteEntry(&key, scanRid);
+				}
+			}
+		}
+		catch(EndOfFileException e)
+		{
+		}
+	}
+
+	checkPassFail(intScan(&index,0,GTE,5000,LT), 100)
+	checkPassFail(intScan(&index,1050,GTE,1060,LT), 10)
+	checkPassFail(intScan(&index,900,GT,1001,LT), 1)
+	// the remaining entries fit in a single leaf, which is the root again
+	checkPassFail(index.getHeight(), 1)
+	// and leaves are never pinned, so the pinned root left with the inner nodes
+	checkPassFail(index.getPinnedNodes(), 0)
+
+	// deleting an entry that is no longer there
+	int missing = 5;
+	RecordId missingRid;
+	missingRid.page_number = 1;
+	missingRid.slot_number = 1;
+	int thrown = 0;
+	try
+	{
+		index.deleteEntry(&missing, missingRid);
+	}
+	catch(NoSuchKeyFoundException e)
+	{
+		thrown = 1;
+	}
+	checkPassFail(thrown, 1)
+
+	// put the keys below 1000 back, into the pages freed by the merges
+	{
+		FileScan fscan(relationName, bufMgr);
+		try
+		{
+			RecordId scanRid;
+			while(1)
+			{
+				fscan.scanNext(scanRid);
+				std::string recordStr = fscan.getRecord();
+				int key = *((int *)(recordStr.c_str() + offsetof (RECORD, i)));
+				if( key < 1000 )
+				{
+					index.insertEntry(&key, scanRid);
+				}
+			}
+		}
+		catch(EndOfFileException e)
+		{
+		}
+	}
+	checkPassFail(intScan(&index,0,GTE,5000,LT), 1100)
+	checkPassFail(intScan(&index,990,GT,1010,LT), 19)
+	checkPassFail(intScanBackward(&index,0,GTE,5000,LT), 1100)
+	// only the new root is pinned, not freed pages reused as leaves
+	checkPassFail(index.getHeight(), 2)
+	checkPassFail(index.getPinnedNodes(), 1)
+}
+
+// -----------------------------------------------------------------------------
+// cursorTests
+// -----------------------------------------------------------------------------
+
+void cursorTests()
+{
+  std::cout << "Scan a B+ Tree index on the integer field with several cursors !!!!!!!!" << std::endl;
+  BTreeIndex<int> index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+	std::cout << "Index Created" << std::endl;
+
+	// nested loop self join, the keys 0 .. 9 of the outer cursor each select 100 keys of the inner one
+	RecordId scanRid;
+	BTreeScanCursor<int> outer(&index);
+	BTreeScanCursor<int> inner(&index);
+	int outerLow = 0, outerHigh = 10;
+	outer.startScan(&outerLow, GTE, &outerHigh, LT);
+	int outerKey = outerLow;
+	int joined = 0;
+	try
+	{
+		while(1)
+		{
+			outer.scanNext(scanRid);
+			int innerLow = outerKey * 100, innerHigh = outerKey * 100 + 100;
+			inner.startScan(&innerLow, GTE, &innerHigh, LT);
+			try
+			{
+				while(1)
+				{
+					inner.scanNext(scanRid);
+					joined++;
+				}
+			}
+			catch(IndexScanCompletedException e)
+			{
+			}
+			outerKey++;
+		}
+	}
+	catch(IndexScanCompletedException e)
+	{
+	}
+	outer.endScan();
+	inner.endScan();
+	checkPassFail(joined, 1000)
+
+	// a cursor does not disturb the scan of the index itself
+	int low = 0, high = 5000;
+	int count = 0;
+	BTreeScanCursor<int> cursor(&index);
+	cursor.startScan(&low, GTE, &high, LT);
+	index.startScan(&low, GTE, &high, LT);
+	try
+	{
+		while(1)
+		{
+			cursor.scanNext(scanRid);
+			index.scanNext(scanRid);
+			count++;
+		}
+	}
+	catch(IndexScanCompletedException e)
+	{
+	}
+	index.endScan();
+	cursor.endScan();
+	checkPassFail(count, 5000)
+
+	int thrown = 0;
+	try
+	{
+		cursor.scanNext(scanRid);
+	}
+	catch(ScanNotInitializedException e)
+	{
+		thrown = 1;
+	}
+	checkPassFail(thrown, 1)
+
+	// batches of 64 record ids, and the first record ids of a scan fetched one at a time
+	std::vector<RecordId> rids;
+	count = 0;
+	cursor.startScan(&low, GTE, &high, LT);
+	cursor.scanNext(scanRid);
+	count++;
+	while(cursor.scanNextBatch(rids, 64))
+	{
+		count += rids.size();
+	}
+	cursor.endScan();
+	checkPassFail(count, 5000)
+
+	count = 0;
+	low = 300;
+	high = 400;
+	index.startScan(&low, GT, &high, LTE);
+	while(index.scanNextBatch(rids, 1000))
+	{
+		count += rids.size();
+	}
+	index.endScan();
+	checkPassFail(count, 100)
+
+	// an ended scan of the index itself gives its cursor back, and cannot be continued
+	thrown = 0;
+	try
+	{
+		index.scanNext(scanRid);
+	}
+	catch(ScanNotInitializedException e)
+	{
+		thrown = 1;
+	}
+	checkPassFail(thrown, 1)
+
+	// backward scans, across leaves, from a bound inside a leaf and past the last key
+	checkPassFail(intScanBackward(&index,0,GTE,5000,LT), 5000)
+	checkPassFail(intScanBackward(&index,300,GT,400,LTE), 100)
+	checkPassFail(intScanBackward(&index,4990,GTE,6000,LT), 10)
+
+	// duplicates of one key filling more than a leaf, found by a single lookup
+	int duplicateKey = 2500;
+	RecordId duplicateRid;
+	for(int i = 0; i < INTARRAYLEAFSIZE; i++)
+	{
+		duplicateRid.page_number = i + 1;
+		duplicateRid.slot_number = 1;
+		index.insertEntry(&duplicateKey, duplicateRid);
+	}
+	checkPassFail(index.lookupAll(&duplicateKey, rids), INTARRAYLEAFSIZE + 1)
+	checkPassFail(index.lookup(&duplicateKey, duplicateRid), true)
+
+	std::vector<int> batchKeys(1, duplicateKey);
+	batchKeys.push_back(duplicateKey - 1);
+	std::vector<int> batchCounts;
+	checkPassFail(index.multiGet(batchKeys, rids, batchCounts), INTARRAYLEAFSIZE + 2)
+
+	// a batch of new keys past those of the relation, shuffled, and of duplicates of a key present
+	std::vector< RIDKeyPair<int> > batch;
+	RIDKeyPair<int> entry;
+	for(int i = 0; i < 2000; i++)
+	{
+		duplicateRid.page_number = i + 1;
+		entry.set(duplicateRid, 5000 + (i * 7919) % 2000);
+		batch.push_back(entry);
+	}
+	for(int i = 0; i < 10; i++)
+	{
+		entry.set(duplicateRid, 100);
+		batch.push_back(entry);
+	}
+	index.insertBatch(batch);
+	count = 0;
+	low = 5000;
+	high = 7000;
+	cursor.startScan(&low, GTE, &high, LT);
+	while(cursor.scanNextBatch(rids, 1000))
+	{
+		count += rids.size();
+	}
+	cursor.endScan();
+	checkPassFail(count, 2000)
+	int batchKey = 100;
+	checkPassFail(index.lookupAll(&batchKey, rids), 11)
+}
+
+// -----------------------------------------------------------------------------
+// compressedTests
+// -----------------------------------------------------------------------------
+
+void compressedTests()
+{
+  std::cout << "Create a B+ Tree index with compressed leaves on the integer field !!!!!!!!" << std::endl;
+	IndexBuildOptions options;
+	options.compressLeaves = true;
+  BTreeIndex<int> index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+	std::cout << "Index Created" << std::endl;
+
+	checkPassFail(intScan(&index,25,GT,40,LT), 14)
+	checkPassFail(intScan(&index,3000,GTE,4000,LT), 1000)
+	checkPassFail(intScanBackward(&index,300,GT,400,LTE), 100)
+
+	// keys far outside the range of their leaf fall back to plain keys, or split it
+	RecordId wideRid;
+	wideRid.page_number = 1;
+	wideRid.slot_number = 0;
+	for(int i = 0; i < 100; i++)
+	{
+		int wideKey = 4000 + i * 100000;
+		index.insertEntry(&wideKey, wideRid);
+		wideKey = -1 - i * 1000;
+		index.insertEntry(&wideKey, wideRid);
+	}
+	std::vector<RecordId> rids;
+	int wideKey = 4000 + 50 * 100000;
+	checkPassFail(index.lookupAll(&wideKey, rids), 1)
+	wideKey = 4000;
+	checkPassFail(index.lookupAll(&wideKey, rids), 2)
+	int count = 0;
+	int low = -1000000, high = 5000;
+	index.startScan(&low, GTE, &high, LT);
+	while(index.scanNextBatch(rids, 1000))
+	{
+		count += rids.size();
+	}
+	index.endScan();
+	checkPassFail(count, 5101)
+
+	// record ids keep every bit of page and slot number when packed
+	RecordId farRid;
+	farRid.page_number = 0xfffffffe;
+	farRid.slot_number = 0xffff;
+	wideKey = 123456789;
+	index.insertEntry(&wideKey, farRid);
+	RecordId packedRid;
+	index.lookup(&wideKey, packedRid);
+	checkPassFail((packedRid == farRid), true)
+
+	// and deletes leave what is left findable
+	for(int i = 0; i < 100; i++)
+	{
+		int wideKey = -1 - i * 1000;
+		index.deleteEntry(&wideKey, wideRid);
+	}
+	checkPassFail(intScan(&index,0,GTE,4000,LT), 4000)
+	wideKey = -1;
+	checkPassFail(index.lookup(&wideKey, wideRid), false)
+
+	// a long run of duplicates fills leaves of its own that hold the key once
+	RecordId dupRid;
+	dupRid.slot_number = 1;
+	int dupKey = 2000;
+	for(int i = 0; i < 3000; i++)
+	{
+		dupRid.page_number = 100000 + i;
+		index.insertEntry(&dupKey, dupRid);
+	}
+	checkPassFail(index.lookupAll(&dupKey, rids), 3001)
+	for(int i = 0; i < 3000; i++)
+	{
+		dupRid.page_number = 100000 + i;
+		index.deleteEntry(&dupKey, dupRid);
+	}
+	checkPassFail(index.lookupAll(&dupKey, rids), 1)
+	checkPassFail(intScan(&index,1990,GTE,2010,LT), 20)
+}
+
+// -----------------------------------------------------------------------------
+// reopenTests
+// -----------------------------------------------------------------------------
+
+void reopenTests()
+{
+  std::cout << "Reopen a B+ Tree index on the integer field from its meta page !!!!!!!!" << std::endl;
+	RecordId rid;
+	{
+		IndexBuildOptions options;
+		options.compressLeaves = true;
+		BTreeIndex<int> index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+		int firstKey = 0;
+		index.lookup(&firstKey, rid);
+
+		// inserts move the root past the one bulk loaded, deletes put pages on the free list
+		for(int i = 0; i < 20000; i++)
+		{
+			int key = 5000 + i;
+			index.insertEntry(&key, rid);
+		}
+		for(int i = 0; i < 10000; i++)
+		{
+			int key = 5000 + i;
+			index.deleteEntry(&key, rid);
+		}
+	}
+
+	{
+		BTreeIndex<int> index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+		std::cout << "Index Reopened" << std::endl;
+
+		checkPassFail(intScan(&index,25,GT,40,LT), 14)
+		checkPassFail(intScan(&index,3000,GTE,4000,LT), 1000)
+		checkPassFail(intScan(&index,5000,GTE,30000,LT), 10000)
+
+		for(int i = 0; i < 10000; i++)
+		{
+			int key = 5000 + i;
+			index.insertEntry(&key, rid);
+		}
+		checkPassFail(intScan(&index,0,GTE,30000,LT), 25000)
+
+		// a scan of an index without included columns has none to return
+		bool noColumns = false;
+		int lowVal = 25;
+		int highVal = 40;
+		char payload[MAX_PAYLOAD_SIZE];
+		index.startScan(&lowVal, GT, &highVal, LT);
+		try
+		{
+			index.scanNext(rid, payload);
+		}
+		catch(BadIndexInfoException e)
+		{
+			noColumns = true;
+		}
+		index.endScan();
+		checkPassFail(noColumns, true)
+	}
+
+	// nor can it be reopened as a covering index
+	bool covering = true;
+	try
+	{
+		IndexBuildOptions options;
+		IncludedColumn doubleColumn = { offsetof(tuple,d), sizeof(double) };
+		options.includedColumns.push_back(doubleColumn);
+		BTreeIndex<int> index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+	}
+	catch(BadIndexInfoException e)
+	{
+		covering = false;
+	}
+	checkPassFail(covering, false)
+
+	// the meta page names the attribute type the file was built over
+	bool thrown = false;
+	try
+	{
+		std::string doubleName;
+		BTreeIndex<double> index(relationName, doubleName, bufMgr, offsetof(tuple,i), DOUBLE);
+	}
+	catch(BadIndexInfoException e)
+	{
+		thrown = true;
+	}
+	checkPassFail(thrown, true)
+}
+
+// -----------------------------------------------------------------------------
+// coveringTests
+// -----------------------------------------------------------------------------
+
+void coveringTests()
+{
+  std::cout << "Create a covering B+ Tree index on the integer field, including the double and string fields !!!!!!!!" << std::endl;
+	IndexBuildOptions options;
+	options.compressLeaves = true;
+	IncludedColumn doubleColumn = { offsetof(tuple,d), sizeof(double) };
+	IncludedColumn stringColumn = { offsetof(tuple,s), 16 };
+	options.includedColumns.push_back(doubleColumn);
+	options.includedColumns.push_back(stringColumn);
+	{
+		BTreeIndex<int> index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+		std::cout << "Index Created" << std::endl;
+
+		checkPassFail(index.getPayloadSize(), 24)
+		checkPassFail(coveredScan(&index,25,GT,40,LT,FORWARD), 14)
+		checkPassFail(coveredScan(&index,3000,GTE,4000,LT,FORWARD), 1000)
+		checkPassFail(coveredScan(&index,300,GT,400,LTE,BACKWARD), 100)
+
+		// a second entry for every record, half inserted one at a time and half in a batch,
+		// splits the leaves, and the deletes that follow merge them again
+		std::vector<RecordId> rids(relationSize);
+		std::vector< RIDKeyPair<int> > batch;
+		for(int i = 0; i < relationSize; i++)
+		{
+			index.lookup(&i, rids[i]);
+			if(i % 2 == 0)
+			{
+				index.insertEntry(&i, rids[i]);
+			}
+			else
+			{
+				RIDKeyPair<int> entry;
+				entry.set(rids[i], i);
+				batch.push_back(entry);
+			}
+		}
+		index.insertBatch(batch);
+		checkPassFail(coveredScan(&index,0,GTE,relationSize,LT,FORWARD), 2 * relationSize)
+
+		// as does a run of duplicates long enough to fill leaves of its own
+		int dupKey = 2000;
+		for(int i = 0; i < 3000; i++)
+		{
+			index.insertEntry(&dupKey, rids[dupKey]);
+		}
+		checkPassFail(coveredScan(&index,1990,GTE,2010,LT,BACKWARD), 3040)
+		for(int i = 0; i < 3000; i++)
+		{
+			index.deleteEntry(&dupKey, rids[dupKey]);
+		}
+		for(int i = 0; i < relationSize; i++)
+		{
+			index.deleteEntry(&i, rids[i]);
+		}
+		checkPassFail(coveredScan(&index,0,GTE,relationSize,LT,FORWARD), relationSize)
+	}
+
+	// the included columns are read back from the meta page
+	{
+		BTreeIndex<int> index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+		checkPassFail(index.getPayloadSize(), 24)
+		checkPassFail(coveredScan(&index,3000,GTE,4000,LT,FORWARD), 1000)
+	}
+
+	// or may be given again, as they were built
+	{
+		BTreeIndex<int> index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+		checkPassFail(index.getPayloadSize(), 24)
+	}
+
+	// only leaves over integer keys store included columns
+	bool thrown = false;
+	try
+	{
+		std::string doubleName;
+		BTreeIndex<double> index(relationName, doubleName, bufMgr, offsetof(tuple,d), DOUBLE, options);
+	}
+	catch(BadIndexInfoException e)
+	{
+		thrown = true;
+	}
+	checkPassFail(thrown, true)
+}
+
+// Scan returning the included columns, and return the number of entries found, or -1 if the
+// columns of any entry differ from those of the record it points at
+int coveredScan(BTreeIndex<int> * index, int lowVal, Operator lowOp, int highVal, Operator highOp, ScanDirection direction)
+{
+  RecordId scanRid;
+	Page *curPage;
+	char payload[MAX_PAYLOAD_SIZE];
+
+  std::cout << "Covered scan for: ";
+  if( lowOp == GT ) { std::cout << "("; } else { std::cout << "["; }
+  std::cout << lowVal << "," << highVal;
+  if( highOp == LT ) { std::cout << ")"; } else { std::cout << "]"; }
+  std::cout << std::endl;
+
+  int numResults = 0;
+	bool matching = true;
+	try
+	{
+  		index->startScan(&lowVal, lowOp, &highVal, highOp, direction);
+	}
+	catch(NoSuchKeyFoundException e)
+	{
+    std::cout << "No Key Found satisfying the scan criteria." << std::endl;
+		return 0;
+	}
+
+	while(1)
+	{
+		try
+		{
+			index->scanNext(scanRid, payload);
+			bufMgr->readPage(file1, scanRid.page_number, curPage);
+			RECORD myRec = *(reinterpret_cast<const RECORD*>(curPage->getRecord(scanRid).data()));
+			bufMgr->unPinPage(file1, scanRid.page_number, false);
+
+			if( memcmp(payload, &myRec.d, sizeof(double)) != 0 || memcmp(payload + sizeof(double), myRec.s, 16) != 0 )
+			{
+				matching = false;
+			}
+		}
+		catch(IndexScanCompletedException e)
+		{
+			break;
+		}
+
+		numResults++;
+	}
+
+  std::cout << "Number of results: " << numResults << std::endl;
+  index->endScan();
+  std::cout << std::endl;
+
+	return matching ? numResults : -1;
+}
+
+// -----------------------------------------------------------------------------
+// ridScanTests
+// -----------------------------------------------------------------------------
+
+void ridScanTests()
+{
+  std::cout << "Create a B+ Tree index on the integer field and read its ranges in page order !!!!!!!!" << std::endl;
+	{
+		BTreeIndex<int> index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+		std::cout << "Index Created" << std::endl;
+
+		checkPassFail(ridScan(&index,25,GT,40,LT,1), 14)
+		checkPassFail(ridScan(&index,3000,GTE,4000,LT,1), 1000)
+		checkPassFail(ridScan(&index,0,GTE,relationSize,LT,1), relationSize)
+		// record ids queued after the first ones have been read are sorted among themselves
+		checkPassFail(ridScan(&index,1000,GT,2000,LTE,3), 1000)
+		// and a batch queued halfway through another is read after all of it
+		checkPassFail(ridScanBehind(&index,1000), 1000)
+	}
+
+	// a scan with nothing queued ends at once
+	bool ended = false;
+	{
+		RidScan rscan(relationName, bufMgr);
+		try
+		{
+			RecordId scanRid;
+			rscan.scanNext(scanRid);
+		}
+		catch(EndOfFileException e)
+		{
+			ended = true;
+		}
+	}
+	checkPassFail(ended, true)
+}
+
+// Read the records of a range in page order, the record ids of the range being queued in
+// numBatches batches, each after the records of the one before have been read. Return the
+// number of records read, or -1 if a record lies outside the range, or a batch is not read
+// in page order
+int ridScan(BTreeIndex<int> * index, int lowVal, Operator lowOp, int highVal, Operator highOp, int numBatches)
+{
+  std::cout << "Rid scan for: ";
+  if( lowOp == GT ) { std::cout << "("; } else { std::cout << "["; }
+  std::cout << lowVal << "," << highVal;
+  if( highOp == LT ) { std::cout << ")"; } else { std::cout << "]"; }
+  std::cout << std::endl;
+
+	std::vector<RecordId> rids;
+	try
+	{
+  		index->startScan(&lowVal, lowOp, &highVal, highOp);
+	}
+	catch(NoSuchKeyFoundException e)
+	{
+    std::cout << "No Key Found satisfying the scan criteria." << std::endl;
+		return 0;
+	}
+	std::vector<RecordId> batch;
+	while(index->scanNextBatch(batch, 256))
+	{
+		rids.insert(rids.end(), batch.begin(), batch.end());
+	}
+	index->endScan();
+
+  int numResults = 0;
+	bool inOrder = true;
+	RidScan rscan(relationName, bufMgr);
+	for(int b = 0; b < numBatches; b++)
+	{
+		size_t first = rids.size() * b / numBatches;
+		size_t last = rids.size() * (b + 1) / numBatches;
+		rscan.addRids(std::vector<RecordId>(rids.begin() + first, rids.begin() + last));
+
+		RecordId scanRid;
+		RecordId prevRid;
+		prevRid.page_number = 0;
+		prevRid.slot_number = 0;
+		for(size_t i = first; i < last; i++)
+		{
+			rscan.scanNext(scanRid);
+			RECORD myRec = *(reinterpret_cast<const RECORD*>(rscan.getRecord().data()));
+
+			bool inRange = (lowOp == GT ? myRec.i > lowVal : myRec.i >= lowVal)
+				&& (highOp == LT ? myRec.i < highVal : myRec.i <= highVal);
+			bool afterPrev = scanRid.page_number > prevRid.page_number
+				|| (scanRid.page_number == prevRid.page_number && scanRid.slot_number > prevRid.slot_number);
+			if( !inRange || !afterPrev )
+			{
+				inOrder = false;
+			}
+			prevRid = scanRid;
+			numResults++;
+		}
+	}
+
+	// every queued record id has been returned
+	try
+	{
+		RecordId scanRid;
+		rscan.scanNext(scanRid);
+		inOrder = false;
+	}
+	catch(EndOfFileException e)
+	{
+	}
+
+  std::cout << "Number of results: " << numResults << std::endl;
+  std::cout << std::endl;
+
+	return inOrder ? numResults : -1;
+}
+
+// Queue the record ids of the keys [0,split), read half of their records, queue those of
+// [split,2*split) and read the rest. Return the number of records under split read before
+// the first one at or above it
+int ridScanBehind(BTreeIndex<int> * index, int split)
+{
+  std::cout << "Rid scan of [" << split << "," << 2 * split << ") queued halfway through [0," << split << ")" << std::endl;
+
+	std::vector<RecordId> first;
+	std::vector<RecordId> second;
+	std::vector<RecordId> batch;
+	int zero = 0;
+	int end = 2 * split;
+	index->startScan(&zero, GTE, &end, LT);
+	while(index->scanNextBatch(batch, 256))
+	{
+		for(size_t i = 0; i < batch.size(); i++)
+		{
+			(first.size() < (size_t) split ? first : second).push_back(batch[i]);
+		}
+	}
+	index->endScan();
+
+	int numBefore = 0;
+	bool secondSeen = false;
+	RidScan rscan(relationName, bufMgr);
+	rscan.addRids(first);
+	try
+	{
+		RecordId scanRid;
+		for(int i = 0; ; i++)
+		{
+			if( i == split / 2 )
+			{
+				rscan.addRids(second);
+			}
+			rscan.scanNext(scanRid);
+			RECORD myRec = *(reinterpret_cast<const RECORD*>(rscan.getRecord().data()));
+			if( myRec.i >= split )
+			{
+				secondSeen = true;
+			}
+			else if( !secondSeen )
+			{
+				numBefore++;
+			}
+		}
+	}
+	catch(EndOfFileException e)
+	{
+	}
+
+  std::cout << "Read before the later batch: " << numBefore << std::endl;
+  std::cout << std::endl;
+
+	return numBefore;
+}
+
+// -----------------------------------------------------------------------------
+// doubleTests
+// -----------------------------------------------------------------------------
+
+void doubleTests()
+{
+  std::cout << "Create a B+ Tree index on the double field" << std::endl;
+  BTreeIndex<double> index(relationName, doubleIndexName, bufMgr, offsetof(tuple,d), DOUBLE);
+
+	// run some tests
+	checkPassFail(doubleScan(&index,25,GT,40,LT), 14)
+	checkPassFail(doubleScan(&index,20,GTE,35,LTE), 16)
+	checkPassFail(doubleScan(&index,-3,GT,3,LT), 3)
+	checkPassFail(doubleScan(&index,996,GT,1001,LT), 4)
+	checkPassFail(doubleScan(&index,0,GT,1,LT), 0)
+	checkPassFail(doubleScan(&index,300,GT,400,LT), 99)
+	checkPassFail(doubleScan(&index,3000,GTE,4000,LT), 1000)
+	checkPassFail(doubleScan(&index,2.5,GT,7.5,LTE), 5)
+}
+
+int doubleScan(BTreeIndex<double> * index, double lowVal, Operator lowOp, double highVal, Operator highOp)
+{
+  RecordId scanRid;
+	Page *curPage;
+
+  std::cout << "Scan for: ";
+  if( lowOp == GT ) { std::cout << "("; } else { std::cout << "["; }
+  std::cout << lowVal << "," << highVal;
+  if( highOp == LT ) { std::cout << ")"; } else { std::cout << "]"; }
+  std::cout << std::endl;
+
+  int numResults = 0;
+
+	try
+	{
+  	index->startScan(&lowVal, lowOp, &highVal, highOp);
+	}
+	catch(NoSuchKeyFoundException e)
+	{
+    std::cout << "No Key Found satisfying the scan criteria." << std::endl;
+		return 0;
+	}
+
+	while(1)
+	{
+		try
+		{
+			index->scanNext(scanRid);
+			bufMgr->readPage(file1, scanRid.page_number, curPage);
+			RECORD myRec = *(reinterpret_cast<const RECORD*>(curPage->getRecord(scanRid).data()));
+			bufMgr->unPinPage(file1, scanRid.page_number, false);
+
+			if( numResults < 5 )
+			{
+				std::cout << "rid:" << scanRid.page_number << "," << scanRid.slot_number;
+				std::cout << " -->:" << myRec.i << ":" << myRec.d << ":" << myRec.s << ":" <<std::endl;
+			}
+			else if( numResults == 5 )
+			{
+				std::cout << "..." << std::endl;
+			}
+		}
+		catch(IndexScanCompletedException e)
+		{
+			break;
+		}
+
+		numResults++;
+	}
+
+  if( numResults >= 5 )
+  {
+    std::cout << "Number of results: " << numResults << std::endl;
+  }
+  index->endScan();
+  std::cout << std::endl;
+
+	return numResults;
+}
+
+// -----------------------------------------------------------------------------
+// stringTests
+// -----------------------------------------------------------------------------
+
+void stringTests()
+{
+  std::cout << "Create a B+ Tree index on the String field" << std::endl;
+  BTreeIndex<StringKey> index(relationName, stringIndexName, bufMgr, offsetof(tuple,s), STRING);
+
+	// run some tests
+	checkPassFail(stringScan(&index,10,GT,20,LT), 9)
+	checkPassFail(stringScan(&index,20,GTE,35,LTE), 16)
+	checkPassFail(stringScan(&index,996,GT,1001,LT), 4)
+	checkPassFail(stringScan(&index,0,GT,1,LT), 0)
+	checkPassFail(stringScan(&index,300,GT,400,LT), 99)
+	checkPassFail(stringScan(&index,3000,GTE,4000,LT), 1000)
+
+	// keys that differ early need only a few bytes of separator each, so the
+	// root takes every leaf of twelve thousand more inserted in order
+	char extraKey[STRINGSIZE + 1];
+	RecordId extraRid;
+	extraRid.page_number = 1;
+	extraRid.slot_number = 0;
+	for (int i = relationSize; i < relationSize + 12000; i++)
+	{
+		sprintf(extraKey, "%05d string record", i);
+		index.insertEntry(extraKey, extraRid);
+	}
+	checkPassFail(index.getHeight(), 2)
+	sprintf(extraKey, "%05d string record", relationSize + 6000);
+	std::vector<RecordId> extraRids;
+	checkPassFail(index.lookupAll(extraKey, extraRids), 1)
+	checkPassFail(stringScan(&index,4990,GTE,5000,LT), 10)
+}
+
+int stringScan(BTreeIndex<StringKey> * index, int lowVal, Operator lowOp, int highVal, Operator highOp)
+{
+  RecordId scanRid;
+	Page *curPage;
+
+  std::cout << "Scan for: ";
+  if( lowOp == GT ) { std::cout << "("; } else { std::cout << "["; }
+  std::cout << lowVal << "," << highVal;
+  if( highOp == LT ) { std::cout << ")"; } else { std::cout << "]"; }
+  std::cout << std::endl;
+
+	char lowValStr[100];
+	sprintf(lowValStr,"%05d string record",lowVal);
+	char highValStr[100];
+	sprintf(highValStr,"%05d string record",highVal);
+
+  int numResults = 0;
+
+	try
+	{
+  	index->startScan(lowValStr, lowOp, highValStr, highOp);
+	}
+	catch(NoSuchKeyFoundException e)
+	{
+    std::cout << "No Key Found satisfying the scan criteria." << std::endl;
+		return 0;
+	}
+
+	while(1)
+	{
+		try
+		{
+			index->scanNext(scanRid);
+			bufMgr->readPage(file1, scanRid.page_number, curPage);
+			RECORD myRec = *(reinterpret_cast<const RECORD*>(curPage->getRecord(scanRid).data()));
+			bufMgr->unPinPage(file1, scanRid.page_number, false);
+
+			if( numResults < 5 )
+			{
+				std::cout << "rid:" << scanRid.page_number << "," << scanRid.slot_number;
+				std::cout << " -->:" << myRec.i << ":" << myRec.d << ":" << myRec.s << ":" <<std::endl;
+			}
+			else if( numResults == 5 )
+			{
+				std::cout << "..." << std::endl;
+			}
+		}
+		catch(IndexScanCompletedException e)
+		{
+			break;
+		}
+
+		numResults++;
+	}
+
+  if( numResults >= 5 )
+  {
+    std::cout << "Number of results: " << numResults << std::endl;
+  }
+  index->endScan();
+  std::cout << std::endl;
+
+	return numResults;
+}
 
 // -----------------------------------------------------------------------------
 // errorTests
@@ -495,7 +1610,7 @@ void errorTests()
 
 	file1->writePage(new_page_number, new_page);
 
-  BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+  BTreeIndex<int> index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
 	
 	int int2 = 2;
 	int int5 = 5;
@@ -0,0 +1,163 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "node_search.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BTREE_X86_SIMD
+#endif
+
+namespace badgerdb
+{
+
+/**
+ * Window of keys the vectorised count runs over once binary search has narrowed it down.
+ */
+static const int SIMD_SEARCH_BLOCK = 64;
+
+#ifdef BTREE_X86_SIMD
+
+	//--------------------------------------------------------------------
+	// Count the keys in keys[0..numKeys) greater than key, 4 at a time
+	//--------------------------------------------------------------------
+	static int countGreaterSse(const int* keys, const int numKeys, const int key)
+	{
+		__m128i needle = _mm_set1_epi32(key);
+		int count = 0;
+		int i = 0;
+		for (; i + 4 <= numKeys; i += 4) {
+			__m128i block = _mm_loadu_si128((const __m128i*) (keys + i));
+			int mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(block, needle)));
+			count += __builtin_popcount(mask);
+		}
+		for (; i < numKeys; i++) {
+			count += keys[i] > key;
+		}
+		return count;
+	}
+
+	//--------------------------------------------------------------------
+	// Count the keys in keys[0..numKeys) less than key, 4 at a time
+	//--------------------------------------------------------------------
+	static int countLessSse(const int* keys, const int numKeys, const int key)
+	{
+		__m128i needle = _mm_set1_epi32(key);
+		int count = 0;
+		int i = 0;
+		for (; i + 4 <= numKeys; i += 4) {
+			__m128i block = _mm_loadu_si128((const __m128i*) (keys + i));
+			int mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmplt_epi32(block, needle)));
+			count += __builtin_popcount(mask);
+		}
+		for (; i < numKeys; i++) {
+			count += keys[i] < key;
+		}
+		return count;
+	}
+
+	//--------------------------------------------------------------------
+	// Count the keys in keys[0..numKeys) greater than key, 8 at a time
+	//--------------------------------------------------------------------
+	__attribute__((target("avx2")))
+	static int countGreaterAvx2(const int* keys, const int numKeys, const int key)
+	{
+		__m256i needle = _mm256_set1_epi32(key);
+		int count = 0;
+		int i = 0;
+		for (; i + 8 <= numKeys; i += 8) {
+			__m256i block = _mm256_loadu_si256((const __m256i*) (keys + i));
+			int mask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(block, needle)));
+			count += __builtin_popcount(mask);
+		}
+		for (; i < numKeys; i++) {
+			count += keys[i] > key;
+		}
+		return count;
+	}
+
+	//--------------------------------------------------------------------
+	// Count the keys in keys[0..numKeys) less than key, 8 at a time
+	//--------------------------------------------------------------------
+	__attribute__((target("avx2")))
+	static int countLessAvx2(const int* keys, const int numKeys, const int key)
+	{
+		__m256i needle = _mm256_set1_epi32(key);
+		int count = 0;
+		int i = 0;
+		for (; i + 8 <= numKeys; i += 8) {
+			__m256i block = _mm256_loadu_si256((const __m256i*) (keys + i));
+			int mask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(needle, block)));
+			count += __builtin_popcount(mask);
+		}
+		for (; i < numKeys; i++) {
+			count += keys[i] < key;
+		}
+		return count;
+	}
+
+	//--------------------------------------------------------------------
+	// The CPU is probed once, the first time a search runs
+	//--------------------------------------------------------------------
+	static bool hasAvx2()
+	{
+		static const bool avx2 = __builtin_cpu_supports("avx2");
+		return avx2;
+	}
+
+	int simdLowerBound(const int* keys, const int numKeys, const int& key)
+	{
+		// narrow the window branchlessly until it fits a block, every key
+		// left of base is less than key and every key past base + len is not
+		const int* base = keys;
+		int len = numKeys;
+		while (len > SIMD_SEARCH_BLOCK) {
+			int half = len / 2;
+			base = (base[half - 1] < key) ? base + half : base;
+			len -= half;
+		}
+		// keys are sorted, so the count of smaller keys is the offset of key
+		return (base - keys) + (hasAvx2() ? countLessAvx2(base, len, key) : countLessSse(base, len, key));
+	}
+
+	int simdUpperBound(const int* keys, const int numKeys, const int& key)
+	{
+		const int* base = keys;
+		int len = numKeys;
+		while (len > SIMD_SEARCH_BLOCK) {
+			int half = len / 2;
+			base = (key < base[half - 1]) ? base : base + half;
+			len -= half;
+		}
+		return (base - keys) + len - (hasAvx2() ? countGreaterAvx2(base, len, key) : countGreaterSse(base, len, key));
+	}
+
+	const char* simdSearchIsa()
+	{
+		return hasAvx2() ? "avx2" : "sse2";
+	}
+
+#else
+
+	int simdLowerBound(const int* keys, const int numKeys, const int& key)
+	{
+		return NodeSearch<int>::binaryLowerBound(keys, numKeys, key);
+	}
+
+	int simdUpperBound(const int* keys, const int numKeys, const int& key)
+	{
+		return NodeSearch<int>::binaryUpperBound(keys, numKeys, key);
+	}
+
+	const char* simdSearchIsa()
+	{
+		return "none";
+	}
+
+#endif
+
+}
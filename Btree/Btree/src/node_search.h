@@ -0,0 +1,144 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+namespace badgerdb
+{
+
+/**
+ * @brief Strategies for locating a key inside the sorted keyArray of a B+Tree node.
+ */
+enum SearchStrategy
+{
+	LINEAR_SEARCH = 0,	/* Scan keys from the left */
+	BINARY_SEARCH = 1,	/* Branchless binary search */
+	SIMD_SEARCH = 2		/* Binary search down to a small block, then a vectorised count. Falls back to BINARY_SEARCH for keys other than int */
+};
+
+/**
+ * @brief Signature shared by all in-node search functions.
+ * Returns the position of key in the first numKeys slots of keys: the number of keys
+ * that are less than key (lower bound), or less than or equal to key (upper bound).
+ */
+template <class KeyT>
+struct NodeSearch{
+	typedef int (*SearchFn)( const KeyT* keys, const int numKeys, const KeyT& key );
+
+  /**
+   * Lower bound by scanning keys from the left.
+   */
+	static int linearLowerBound( const KeyT* keys, const int numKeys, const KeyT& key )
+	{
+		int i = 0;
+		while( i < numKeys && keys[i] < key ) i++;
+		return i;
+	}
+
+  /**
+   * Upper bound by scanning keys from the left.
+   */
+	static int linearUpperBound( const KeyT* keys, const int numKeys, const KeyT& key )
+	{
+		int i = 0;
+		while( i < numKeys && !( key < keys[i] ) ) i++;
+		return i;
+	}
+
+  /**
+   * Lower bound by binary search. The loop halves the window a fixed number of times
+   * for a given numKeys and only ever moves its base, so the compiler can turn the
+   * comparison into a conditional move instead of an unpredictable branch.
+   */
+	static int binaryLowerBound( const KeyT* keys, const int numKeys, const KeyT& key )
+	{
+		if( numKeys == 0 ) return 0;
+		const KeyT* base = keys;
+		int len = numKeys;
+		while( len > 1 )
+		{
+			int half = len / 2;
+			base = ( base[half - 1] < key ) ? base + half : base;
+			len -= half;
+		}
+		return ( base - keys ) + ( *base < key );
+	}
+
+  /**
+   * Upper bound by branchless binary search.
+   */
+	static int binaryUpperBound( const KeyT* keys, const int numKeys, const KeyT& key )
+	{
+		if( numKeys == 0 ) return 0;
+		const KeyT* base = keys;
+		int len = numKeys;
+		while( len > 1 )
+		{
+			int half = len / 2;
+			base = ( key < base[half - 1] ) ? base : base + half;
+			len -= half;
+		}
+		return ( base - keys ) + !( key < *base );
+	}
+
+  /**
+   * Lower bound function implementing the given strategy for this key type.
+   */
+	static SearchFn lowerBound( const SearchStrategy strategy )
+	{
+		return strategy == LINEAR_SEARCH ? &linearLowerBound : &binaryLowerBound;
+	}
+
+  /**
+   * Upper bound function implementing the given strategy for this key type.
+   */
+	static SearchFn upperBound( const SearchStrategy strategy )
+	{
+		return strategy == LINEAR_SEARCH ? &linearUpperBound : &binaryUpperBound;
+	}
+};
+
+/**
+ * Lower bound over int keys: branchless binary search down to a block of at most
+ * SIMD_SEARCH_BLOCK keys, then a count of the keys less than key using AVX2 when the
+ * CPU supports it and SSE2 otherwise. Plain binary search on other architectures.
+ */
+int simdLowerBound( const int* keys, const int numKeys, const int& key );
+
+/**
+ * Upper bound over int keys, counterpart of simdLowerBound.
+ */
+int simdUpperBound( const int* keys, const int numKeys, const int& key );
+
+/**
+ * Name of the vector instruction set simdLowerBound and simdUpperBound run on this CPU.
+ */
+const char* simdSearchIsa();
+
+template <>
+inline NodeSearch<int>::SearchFn NodeSearch<int>::lowerBound( const SearchStrategy strategy )
+{
+	switch( strategy )
+	{
+		case LINEAR_SEARCH: return &linearLowerBound;
+		case SIMD_SEARCH: return &simdLowerBound;
+		default: return &binaryLowerBound;
+	}
+}
+
+template <>
+inline NodeSearch<int>::SearchFn NodeSearch<int>::upperBound( const SearchStrategy strategy )
+{
+	switch( strategy )
+	{
+		case LINEAR_SEARCH: return &linearUpperBound;
+		case SIMD_SEARCH: return &simdUpperBound;
+		default: return &binaryUpperBound;
+	}
+}
+
+}